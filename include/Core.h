@@ -13,6 +13,8 @@
 
 #include "Physics/PhysicsManager.h"
 
+#include "Jobs/JobSystem.h"
+
 #include "Video/VideoManager.h"
 
 class Core
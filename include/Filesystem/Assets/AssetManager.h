@@ -3,6 +3,8 @@
 
 #include "Utils.h"
 
+#include "Filesystem/Assets/TextureAtlas.h"
+
 #include <SFML/Graphics/Image.hpp>
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/Graphics/Font.hpp>
@@ -33,6 +35,13 @@ public:
 	static sf::Sound* loadSound(const std::string& id, const std::string& path);
 	static sf::Music* loadMusic(const std::string& id, const std::string& path);
 
+	// small images are packed into the texture atlas, bigger ones are loaded as textures
+	static bool loadTextureRegion(const std::string& id, const std::string& path, TextureRegion& region);
+
+	// adds the entries of an atlas baked with saveAtlas
+	static bool loadAtlas(const std::string& path);
+	static bool saveAtlas(const std::string& path);
+
 	static sf::Image* getImage(const std::string& id);
 	static sf::Texture* getTexture(const std::string& id);
 	static sf::Font* getFont(const std::string& id);
@@ -40,6 +49,14 @@ public:
 	static sf::Sound* getSound(const std::string& id);
 	static sf::Music* getMusic(const std::string& id);
 
+	// atlas entry or the whole texture of the id
+	static bool getTextureRegion(const std::string& id, TextureRegion& region);
+
+	static inline TextureAtlas* getAtlas() { return s_atlas; }
+
+	// file a texture or atlas entry was loaded from, empty for added and baked ones
+	static std::string getTexturePath(const std::string& id);
+
 	static std::vector<std::string>* getShaderUniforms(const std::string& id);
 
 	static inline sf::Texture* getDefaultTexture() { return s_defaultTexture; }
@@ -50,6 +67,7 @@ public:
 	static std::string findShader(const sf::Shader* ptr);
 	static std::string findSound(const sf::Sound* ptr);
 	static std::string findMusic(const sf::Music* ptr);
+	static std::string findTextureRegion(const TextureRegion& region);
 
 	static void releaseImage(const std::string& id);
 	static void releaseTexture(const std::string& id);
@@ -87,6 +105,8 @@ private:
 	static std::map<std::string, std::vector<std::string>> s_shadersUniforms;
 
 	static sf::Texture* s_defaultTexture;
+
+	static TextureAtlas* s_atlas;
 };
 
 #endif
@@ -0,0 +1,122 @@
+#ifndef _TEXTURE_ATLAS_H_
+#define _TEXTURE_ATLAS_H_
+
+#include "Utils.h"
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+// part of a texture used by a sprite, either a whole texture or a packed atlas entry
+struct TextureRegion
+{
+	TextureRegion() :
+		texture(0)
+	{}
+
+	TextureRegion(sf::Texture* t, const sf::IntRect& r) :
+		texture(t),
+		rect(r)
+	{}
+
+	sf::Texture* texture;
+	sf::IntRect rect;
+};
+
+// bottom left skyline packer, places rectangles at the lowest free position
+class SkylinePacker
+{
+public:
+
+	SkylinePacker();
+
+	void init(uint32 width, uint32 height);
+
+	bool insert(uint32 width, uint32 height, sf::Vector2u& pos);
+
+private:
+
+	// lowest y at which a rectangle fits starting at the node, -1 if it does not fit
+	int32 fit(uint32 index, uint32 width, uint32 height) const;
+
+	void addLevel(uint32 index, uint32 x, uint32 y, uint32 width, uint32 height);
+
+private:
+
+	struct Node
+	{
+		uint32 x;
+		uint32 y;
+		uint32 width;
+	};
+
+	uint32 m_width;
+	uint32 m_height;
+	std::vector<Node> m_nodes;
+
+};
+
+// packs images into large texture pages so sprites using them share one texture.
+// Entries are surrounded by bleed pixels repeating their edges, so filtering does
+// not sample the neighbours, and kept padding pixels apart.
+class TextureAtlas
+{
+public:
+
+	TextureAtlas(uint32 pageSize = 1024, uint32 padding = 2, uint32 bleed = 1);
+
+	~TextureAtlas();
+
+	// copies the image to a page, returns false if it is bigger than a page
+	bool add(const std::string& id, const sf::Image& image, TextureRegion& region);
+
+	bool find(const std::string& id, TextureRegion& region) const;
+
+	// id of the entry covering the rect of the texture, empty if there is none
+	std::string find(const sf::Texture* texture, const sf::IntRect& rect) const;
+
+	bool contains(const sf::Texture* texture) const;
+
+	// writes the pages as png files next to an xml description, which
+	// loadFromFile reads back without packing the images again
+	bool saveToFile(const std::string& path) const;
+
+	bool loadFromFile(const std::string& path);
+
+	void clear();
+
+	inline uint32 getPageCount() const { return m_pages.size(); }
+
+	inline uint32 getEntryCount() const { return m_entries.size(); }
+
+private:
+
+	struct Page
+	{
+		sf::Image image;
+		sf::Texture* texture;
+		SkylinePacker packer;
+	};
+
+	struct Entry
+	{
+		uint32 page;
+		sf::IntRect rect;
+	};
+
+	Page* addPage();
+
+	// image extended by bleed pixels repeating its edges
+	void makeBleed(const sf::Image& image, sf::Image& out) const;
+
+private:
+
+	uint32 m_pageSize;
+	uint32 m_padding;
+	uint32 m_bleed;
+
+	std::vector<Page*> m_pages;
+	std::map<std::string, Entry> m_entries;
+
+};
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef _CONFIGURATION_H_
 #define _CONFIGURATION_H_
 
+#include <string>
+
 class ConfigFile;
 
 class Configuration
@@ -27,6 +29,21 @@ public:
 		static int StencilBuffer;
 	};
 
+	struct Jobs
+	{
+		static int Workers;
+		static bool Deterministic;
+	};
+
+	struct Atlas
+	{
+		static int PageSize;
+		static int MaxImageSize;
+		static int Padding;
+		static int Bleed;
+		static std::string File;
+	};
+
 };
 
 #endif
@@ -0,0 +1,153 @@
+#ifndef _JOB_SYSTEM_H_
+#define _JOB_SYSTEM_H_
+
+#include "Utils.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+// unit of work executed by JobSystem, created with JobSystem::createJob.
+// A job is finished when its function and all its children have finished.
+class Job
+{
+	friend class JobSystem;
+
+public:
+
+	typedef std::shared_ptr<Job> Ptr;
+	typedef std::function<void()> Function;
+
+	Job(const Function& function, const Ptr& parent);
+
+	inline bool isFinished() const { return m_unfinished.load() == 0; }
+
+private:
+
+	Function m_function;
+	Ptr m_parent;
+
+	// the job itself and its unfinished children
+	std::atomic<int32> m_unfinished;
+
+	// unfinished dependencies, plus one until the job is run
+	std::atomic<int32> m_waiting;
+
+	// jobs depending on this one, guarded by m_mutex
+	std::mutex m_mutex;
+	std::vector<Ptr> m_continuations;
+	bool m_finished;
+
+};
+
+// work-stealing job scheduler, every worker thread owns a queue, takes its
+// newest jobs first and steals the oldest jobs of other workers when idle.
+// The main thread is worker 0 and executes jobs while waiting.
+// In deterministic mode or without worker threads jobs run inline on the
+// calling thread in the order they become ready.
+class JobSystem
+{
+public:
+
+	// negative worker count uses one thread per core besides the main thread
+	static bool init(int32 workerCount = -1, bool deterministic = false);
+
+	static void shutdown();
+
+	static uint32 getWorkerCount();
+
+	static bool isDeterministic();
+
+	static void setDeterministic(bool flag);
+
+	static Job::Ptr createJob(const Job::Function& function, const Job::Ptr& parent = Job::Ptr());
+
+	// job is not started before dependency finishes, call before running the job
+	static void addDependency(const Job::Ptr& job, const Job::Ptr& dependency);
+
+	// every job has to be run exactly once
+	static void run(const Job::Ptr& job);
+
+	static void wait(const Job::Ptr& job);
+
+	// calls function(begin, end) for batches of the range [0, count) and waits for all of them
+	template <typename F>
+	static void parallelFor(uint32 count, uint32 batchSize, F function);
+
+private:
+
+	class WorkQueue
+	{
+	public:
+
+		void push(const Job::Ptr& job);
+
+		bool pop(Job::Ptr& job);
+
+		bool steal(Job::Ptr& job);
+
+	private:
+
+		std::mutex m_mutex;
+		std::deque<Job::Ptr> m_jobs;
+
+	};
+
+	static bool isInline();
+
+	static void workerLoop(uint32 index);
+
+	static void schedule(const Job::Ptr& job);
+
+	static void execute(const Job::Ptr& job);
+
+	static void finish(const Job::Ptr& job);
+
+	static bool findJob(Job::Ptr& job);
+
+private:
+
+	static std::vector<std::thread*> s_threads;
+	static std::vector<WorkQueue*> s_queues;
+
+	static std::atomic<int32> s_queuedJobs;
+	static std::atomic<bool> s_quit;
+
+	static std::mutex s_sleepMutex;
+	static std::condition_variable s_sleepCondition;
+
+	static bool s_deterministic;
+
+	static thread_local uint32 t_workerIndex;
+
+};
+
+template <typename F>
+void JobSystem::parallelFor(uint32 count, uint32 batchSize, F function)
+{
+	if (count == 0)
+		return;
+
+	if (batchSize == 0)
+		batchSize = 1;
+
+	if (isInline() || count <= batchSize)
+	{
+		for (uint32 begin = 0; begin < count; begin += batchSize)
+			function(begin, std::min(begin + batchSize, count));
+		return;
+	}
+
+	Job::Ptr root = createJob(Job::Function());
+	for (uint32 begin = 0; begin < count; begin += batchSize)
+	{
+		uint32 end = std::min(begin + batchSize, count);
+		run(createJob([=]() { function(begin, end); }, root));
+	}
+
+	run(root);
+	wait(root);
+}
+
+#endif
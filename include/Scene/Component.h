@@ -8,6 +8,9 @@
 #include "Filesystem/Serialization.h"
 #include "Filesystem/Archive.h"
 
+#include "Scene/ComponentPool.h"
+#include "Scene/ComponentRegistry.h"
+
 #include "Utils.h"
 
 class GameObject;
@@ -15,6 +18,9 @@ class GameObject;
 class Component
 {
 	friend class GameObject;
+	friend class ComponentRegistry;
+	friend class ComponentUpdateSystem;
+	friend class Scene;
 
 public:
 
@@ -53,6 +59,10 @@ private:
 
 	GameObject* m_owner;
 
+	// position in the registry array of this component type
+	uint32 m_typeId;
+	uint32 m_registryIndex;
+
 private:
 
 	friend class boost::serialization::access;
@@ -0,0 +1,78 @@
+#ifndef _COMPONENT_POOL_H_
+#define _COMPONENT_POOL_H_
+
+#include "Utils.h"
+
+// fixed size allocator handing out objects from contiguous chunks,
+// freed objects are kept on an intrusive free list and reused first
+class PoolAllocator
+{
+public:
+
+	PoolAllocator(std::size_t objectSize, uint32 objectsPerChunk = 256);
+
+	~PoolAllocator();
+
+	void* allocate();
+
+	void deallocate(void* ptr);
+
+	inline uint32 getCount() const { return m_count; }
+
+	inline uint32 getCapacity() const { return m_chunks.size() * m_objectsPerChunk; }
+
+private:
+
+	void addChunk();
+
+private:
+
+	std::size_t m_objectSize;
+	uint32 m_objectsPerChunk;
+
+	std::vector<uint8*> m_chunks;
+	void* m_freeList;
+	uint32 m_count;
+
+};
+
+// per type storage of components, used through DECLARE_COMPONENT_POOL
+// so every new/delete of the component goes to the pool
+template <typename T>
+class ComponentPool
+{
+public:
+
+	static void* allocate(std::size_t size)
+	{
+		// classes derived from T are bigger than the pool slots
+		if (size != sizeof(T))
+			return ::operator new(size);
+
+		return getAllocator().allocate();
+	}
+
+	static void deallocate(void* ptr, std::size_t size)
+	{
+		if (!ptr)
+			return;
+
+		if (size != sizeof(T))
+			::operator delete(ptr);
+		else
+			getAllocator().deallocate(ptr);
+	}
+
+	static PoolAllocator& getAllocator()
+	{
+		static PoolAllocator allocator(sizeof(T));
+		return allocator;
+	}
+
+};
+
+#define DECLARE_COMPONENT_POOL(T)																	\
+	static void* operator new(std::size_t size) { return ComponentPool<T>::allocate(size); }		\
+	static void operator delete(void* ptr, std::size_t size) { ComponentPool<T>::deallocate(ptr, size); }
+
+#endif
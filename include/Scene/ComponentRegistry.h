@@ -0,0 +1,60 @@
+#ifndef _COMPONENT_REGISTRY_H_
+#define _COMPONENT_REGISTRY_H_
+
+#include "Utils.h"
+
+class Component;
+
+// keeps components attached to game objects grouped by their type in dense
+// arrays, so all components of one type can be walked linearly
+class ComponentRegistry
+{
+public:
+
+	typedef std::vector<Component*> ComponentArray;
+
+	static const uint32 INVALID_INDEX = 0xffffffff;
+
+	// sequential id of the component type, used to index per type tables
+	static uint32 getTypeId(std::type_index type);
+	template <typename T>
+	static uint32 getTypeId();
+
+	static bool findTypeId(std::type_index type, uint32& id);
+
+	static std::type_index getType(uint32 typeId);
+
+	static uint32 getTypeCount();
+
+	static const ComponentArray& getComponents(uint32 typeId);
+	template <typename T>
+	static const ComponentArray& getComponents();
+
+	static void attach(Component* c);
+
+	static void detach(Component* c);
+
+private:
+
+	static std::unordered_map<std::type_index, uint32> s_typeIds;
+	static std::vector<std::type_index> s_types;
+
+	// deque keeps the arrays in place when new types are registered during iteration
+	static std::deque<ComponentArray> s_components;
+
+};
+
+template <typename T>
+uint32 ComponentRegistry::getTypeId()
+{
+	static const uint32 id = getTypeId(typeid(T));
+	return id;
+}
+
+template <typename T>
+const ComponentRegistry::ComponentArray& ComponentRegistry::getComponents()
+{
+	return getComponents(getTypeId<T>());
+}
+
+#endif
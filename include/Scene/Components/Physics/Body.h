@@ -15,6 +15,8 @@ public:
 
 	inline static Component* onBuildComponent() { return new Body(); }
 
+	DECLARE_COMPONENT_POOL(Body)
+
 	Body();
 
 	virtual ~Body();
@@ -89,6 +91,9 @@ public:
 
 	float getAngle();
 
+	// copies the body position and angle to the owner Transform
+	void syncTransform();
+
 protected:
 
 	virtual void onCreate();
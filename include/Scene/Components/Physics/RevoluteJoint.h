@@ -13,6 +13,8 @@ public:
 
 	inline static Component* onBuildComponent() { return new RevoluteJoint(); }
 
+	DECLARE_COMPONENT_POOL(RevoluteJoint)
+
 	RevoluteJoint();
 
 	virtual ~RevoluteJoint();
@@ -3,16 +3,18 @@
 
 #include "Scene/Component.h"
 
+#include "Video/RenderQueue.h"
+
 #include <SFML/Graphics.hpp>
 
 class Camera : public Component
 {
-	friend class Scene;
-
 public:
 
 	inline static Component* onBuildComponent() { return new Camera(); }
 
+	DECLARE_COMPONENT_POOL(Camera)
+
 	Camera();
 
 	virtual ~Camera();
@@ -43,17 +45,20 @@ public:
 
 	void setApplyViewToRenderTexture(bool value);
 
+	// moves the view to the owner Transform
+	void updateView();
+
+	// render pass drawing through this camera, to its render texture if it has one
+	void setupPass(sf::RenderTarget* defaultTarget, RenderQueue::Pass& pass);
+
 protected:
 
 	virtual void onCreate();
 	virtual void onDuplicate(Component* dest);
 	virtual void onUpdate(const sf::Time& dt);
-	virtual void onRender(sf::RenderTarget*& target);
 
 private:
 
-	static sf::RenderTexture* s_currentRT;
-
 	sf::View* m_view;
 	sf::Vector2f m_size;
 	float m_zoom;
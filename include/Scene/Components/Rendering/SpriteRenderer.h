@@ -3,6 +3,7 @@
 
 #include "Scene/Component.h"
 #include "Scene/Material.h"
+#include "Filesystem/Assets/TextureAtlas.h"
 
 #include <SFML/Graphics/RectangleShape.hpp>
 #include <SFML/Graphics/Texture.hpp>
@@ -10,20 +11,33 @@
 
 class SpriteRenderer : public Component
 {
+	friend class SpriteGrid;
+
 public:
 
 	inline static Component* onBuildComponent() { return new SpriteRenderer(); }
 
+	DECLARE_COMPONENT_POOL(SpriteRenderer)
+
 	SpriteRenderer();
 
 	virtual ~SpriteRenderer();
 
+	// the quad is rebuilt after the shape was accessed here
 	sf::RectangleShape* getRenderer();
 
 	void setTexture(sf::Texture* tex);
 
 	sf::Texture* getTexture() const;
 
+	// uses a part of the texture, e.g. an entry of the texture atlas
+	void setTextureRegion(const TextureRegion& region);
+
+	TextureRegion getTextureRegion() const;
+
+	// loads the image through AssetManager::loadTextureRegion, small images share an atlas page
+	bool loadTexture(const std::string& id, const std::string& path);
+
 	void setSize(sf::Vector2f size);
 
 	sf::Vector2f getSize();
@@ -44,6 +58,8 @@ public:
 
 	sf::RenderStates getRenderStates();
 
+	void setTransform(const sf::Transform& trans);
+
 	void setMaterial(Material m);
 
 	Material getMaterial();
@@ -52,10 +68,24 @@ public:
 
 	bool getMaterialValidation();
 
+	// sprites of lower layers are drawn first, see RenderQueue
+	void setLayer(int32 layer);
+
+	int32 getLayer();
+
+	// rebuilds the world space quad when the shape or the global transform changed,
+	// returns true when the bounds have to be updated in SpriteGrid
+	bool updateQuad();
+
+	inline const sf::FloatRect& getBounds() const { return m_bounds; }
+
+	// writes the world space quad of the sprite to the render queue slot,
+	// for the passes SpriteGrid found the sprite visible in
+	void submit(uint32 slot);
+
 protected:
 
 	virtual void onDuplicate(Component* dest);
-	virtual void onRender(sf::RenderTarget*& target);
 	virtual void onTransform(const sf::Transform& inTrans, sf::Transform& outTrans);
 
 private:
@@ -66,6 +96,23 @@ private:
 	Material m_material;
 	bool m_materialValidation;
 
+	int32 m_layer;
+
+	// world space quad and its bounds
+	sf::Vertex m_quad[4];
+	sf::FloatRect m_bounds;
+	bool m_quadDirty;
+	uint32 m_transformVersion;
+
+	// hierarchy depth used by the render key, taken from the transform level
+	uint32 m_depth;
+
+	// SpriteGrid bookkeeping
+	bool m_inGrid;
+	sf::IntRect m_cells;
+	uint32 m_queryStamp;
+	uint32 m_passMask;
+
 private:
 
 	friend class boost::serialization::access;
@@ -79,7 +126,7 @@ private:
 	BOOST_SERIALIZATION_SPLIT_MEMBER()
 };
 
-BOOST_CLASS_VERSION(SpriteRenderer, 1)
+BOOST_CLASS_VERSION(SpriteRenderer, 3)
 
 BOOST_CLASS_EXPORT_KEY(SpriteRenderer)
 
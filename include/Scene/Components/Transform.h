@@ -5,12 +5,18 @@
 
 #include <SFML/Graphics/Transform.hpp>
 
+#include <atomic>
+
 class Transform : public Component
 {
+	friend class TransformSystem;
+
 public:
 
 	inline static Component* onBuildComponent() { return new Transform(); }
 
+	DECLARE_COMPONENT_POOL(Transform)
+
 	enum ModeType
 	{
 		Hierarchy,
@@ -36,14 +42,29 @@ public:
 
 	inline ModeType getMode() { return m_mode; }
 
-	inline void setMode(ModeType mode) { m_mode = mode; }
+	void setMode(ModeType mode);
 
 	const sf::Transform& getTransform();
 
-	const sf::Transform& getGlobalTransform();
+	// cached result of the last update, does not walk the hierarchy
+	inline const sf::Transform& getGlobalTransform() { return m_globalTransform; }
+
+	inline bool isDirty() const { return m_localDirty || m_globalDirty; }
 
+	// changes every time the global transform is recomputed
+	inline uint32 getVersion() const { return m_version; }
+
+	// number of transformed ancestors as counted by the last TransformSystem update,
+	// -1 while the transform is not part of the hierarchy
+	inline int32 getHierarchyLevel() const { return m_nodeLevel; }
+
+	// brings the global transform up to date right away, updating dirty parents first
 	void recomputeTransform();
 
+	// recomputes the global transform only when the local one or the parent changed,
+	// parent is the nearest active Transform above this one, returns true on change
+	bool updateGlobalTransform(const Transform* parent);
+
 protected:
 
 	virtual void onDuplicate(Component* dest);
@@ -51,6 +72,15 @@ protected:
 
 private:
 
+	// result of the TransformSystem pass
+	void applyGlobalTransform(const sf::Transform& global, const Transform* parent);
+
+	void computeGlobalTransform(const sf::Transform& parent);
+
+private:
+
+	static std::atomic<uint32> s_version;
+
 	sf::Vector2f m_position;
 	float m_rotation;
 	sf::Vector2f m_scale;
@@ -59,6 +89,18 @@ private:
 	sf::Transform m_transform;
 	sf::Transform m_globalTransform;
 
+	bool m_localDirty;
+	bool m_globalDirty;
+	uint32 m_version;
+
+	// parent and its version the global transform was computed from
+	const Transform* m_parent;
+	uint32 m_parentVersion;
+
+	// position in the levels of TransformSystem, level is -1 outside of them
+	int32 m_nodeLevel;
+	uint32 m_nodeIndex;
+
 private:
 
 	friend class boost::serialization::access;
@@ -4,6 +4,7 @@
 #include <SFML/Graphics.hpp>
 
 #include "Scene/Component.h"
+#include "Scene/SlotMap.h"
 
 #include "Utils.h"
 
@@ -17,7 +18,7 @@ public:
 
 	typedef std::list<GameObject*> List;
 	typedef std::pair<std::type_index, Component*> ComponentPair;
-	typedef std::list<ComponentPair> Components;
+	typedef std::vector<ComponentPair> Components;
 
 	inline static GameObject* buildGameObject(const std::string& name) { return new GameObject(name); }
 
@@ -27,7 +28,9 @@ public:
 
 	std::string getId();
 
-	void setId(std::string id);
+	// keeps the old id and returns false when another object of the scene,
+	// or one waiting to be added, already uses id
+	bool setId(std::string id);
 
 	uint32 getOrder();
 
@@ -39,6 +42,9 @@ public:
 
 	bool isPrefab();
 
+	// object is in the scene and it and all its parents are active
+	bool isUpdating();
+
 	GameObject* getParent();
 
 	bool isDestroying();
@@ -85,20 +91,22 @@ public:
 
 	uint32 getChildrenCount();
 
+	inline const List& getChildrenList() { return m_childrens; }
+
 	void processAdding();
 	void processRemoving();
 
 	bool isWaitingToAdd(GameObject* o);
 	bool isWaitingToRemove(GameObject* o);
 
+	bool hasPendingChanges();
+
 protected:
 
 	void onCreate();
 	void onDestroy();
 	void onDuplicate(GameObject* dest);
-	void onUpdate(const sf::Time& dt, const sf::Transform& trans, bool sort = false);
 	void onEvent(const sf::Event& event);
-	void onRender(sf::RenderTarget*& target);
 	void onCollide(GameObject* other, bool beginOrEnd, b2Contact* contact);
 
 private:
@@ -109,12 +117,25 @@ private:
 
 	void setPrefab(bool flag);
 
+	void updateActiveInHierarchy();
+
+	// queued children and delayed components, called by the scene only for changed objects
+	void processPendingChanges(bool sort);
+
 	GameObject* findChildrenInPartOfPath(const std::string& path, uint32 from);
 
+	void detachComponent(Components::iterator it);
+
+	void setComponentSlot(Component* c);
+	void resetComponentSlot(Component* c);
+
 private:
 
 	GameObject* m_parent;
 
+	// handle in the scene storage, valid only for root objects and prefabs
+	SlotHandle m_handle;
+
 	std::string m_id;
 	uint32 m_order;
 
@@ -122,9 +143,19 @@ private:
 	bool m_prefab;
 	bool m_isDestroying;
 
+	bool m_inScene;
+	bool m_activeInHierarchy;
+	bool m_childrenUnsorted;
+
+	// position in the scene queue of objects with pending changes
+	uint32 m_pendingIndex;
+
 	Components m_components;
 	Components m_componentsToDestroyDelayed;
 
+	// first component of each type indexed by ComponentRegistry type id
+	std::vector<Component*> m_componentsByType;
+
 	List m_childrens;
 	List m_childrensToAdd;
 	List m_childrensToRemove;
@@ -146,19 +177,20 @@ private:
 template <typename T>
 void GameObject::removeComponent(bool delayed)
 {
-	removeComponent(typeid(T));
+	removeComponent(typeid(T), delayed);
 }
 
 template <typename T>
 bool GameObject::hasComponent()
 {
-	hasComponent(typeid(T));
+	return getComponent<T>() != 0;
 }
 
 template <typename T>
 T* GameObject::getComponent()
 {
-	return (T*)(getComponent(typeid(T)));
+	uint32 id = ComponentRegistry::getTypeId<T>();
+	return id < m_componentsByType.size() ? (T*)(m_componentsByType[id]) : 0;
 }
 
 template <typename T>
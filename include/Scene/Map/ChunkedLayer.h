@@ -0,0 +1,147 @@
+#ifndef _CHUNKED_LAYER_H_
+#define _CHUNKED_LAYER_H_
+
+#include <Utils.h>
+
+#include <Jobs/JobSystem.h>
+
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+#include <SFML/Graphics/VertexBuffer.hpp>
+
+// square block of tiles of a streamed layer, its vertices exist only while loaded
+struct TileChunk
+{
+	enum State
+	{
+		Unloaded,
+		Loading,
+		Loaded
+	};
+
+	// vertices of the chunk grouped by tileset
+	struct Data
+	{
+		Data() :
+			memory(0),
+			uploaded(false),
+			animationsCurrent(false)
+		{}
+
+		// quad of an animated tile, first is its first vertex in vertices[tileset]
+		struct AnimatedTile
+		{
+			sf::Uint16 tileset;
+			uint32 first;
+			uint32 animation;
+			sf::Uint32 gid;
+		};
+
+		// replaces the texture coordinates of the quad of the tile
+		void setTexCoords(const AnimatedTile& tile, const sf::Vector2f* texCoords);
+
+		std::map<sf::Uint16, std::vector<sf::Vertex>> vertices;
+		sf::FloatRect bounds;
+		std::size_t memory;
+
+		// vertices uploaded on the first draw, only animated tiles change once built
+		std::map<sf::Uint16, sf::VertexBuffer> buffers;
+		bool uploaded;
+
+		// chunks are built with the first frame, animations show the current one once loaded
+		std::vector<AnimatedTile> animated;
+		bool animationsCurrent;
+	};
+
+	TileChunk() :
+		state(Unloaded)
+	{}
+
+	State state;
+
+	// world area the tiles of the chunk can cover, known without loading it
+	sf::FloatRect area;
+
+	std::shared_ptr<Data> data;
+	Job::Ptr job;
+};
+
+// tile layer split into chunks of chunkSize x chunkSize tiles. Only the tile ids
+// are kept for the whole layer, vertices of a chunk are built by a job on load
+// and dropped on unload, MapLoader::updateStreaming decides which chunks are loaded.
+class ChunkedLayer : public sf::Drawable
+{
+public:
+
+	typedef std::function<void(const ChunkedLayer& layer, uint32 chunkX, uint32 chunkY, TileChunk::Data& data)> BuildFunction;
+
+	ChunkedLayer(uint32 width, uint32 height, uint32 chunkSize, const std::vector<sf::Texture>& textures);
+
+	// waits for chunks still being built
+	~ChunkedLayer();
+
+	void setTile(uint32 x, uint32 y, sf::Uint32 gid);
+
+	// copies width x height raw tile ids, the data does not have to be aligned
+	void setTiles(const uint8* tileData);
+
+	inline sf::Uint32 getTile(uint32 x, uint32 y) const { return m_tiles[y * m_width + x]; }
+
+	inline const std::vector<sf::Uint32>& getTiles() const { return m_tiles; }
+
+	inline uint32 getWidth() const { return m_width; }
+	inline uint32 getHeight() const { return m_height; }
+	inline uint32 getChunkSize() const { return m_chunkSize; }
+	inline uint32 getChunksX() const { return m_chunksX; }
+	inline uint32 getChunksY() const { return m_chunksY; }
+
+	inline uint32 getChunkCount() const { return m_chunks.size(); }
+
+	inline TileChunk& getChunk(uint32 index) { return m_chunks[index]; }
+	inline const TileChunk& getChunk(uint32 index) const { return m_chunks[index]; }
+
+	// starts a job building the chunk, the chunk is loaded once update sees it finished
+	void load(uint32 index, const BuildFunction& build);
+
+	void unload(uint32 index);
+
+	// takes over chunks whose jobs finished
+	void update();
+
+	void waitForJobs();
+
+	// bytes of vertex data of loaded chunks
+	inline std::size_t getMemory() const { return m_memory; }
+
+	inline uint32 getLoadedCount() const { return m_loadedCount; }
+
+private:
+
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+
+	void _upload(TileChunk::Data& data) const;
+
+private:
+
+	uint32 m_width;
+	uint32 m_height;
+	uint32 m_chunkSize;
+	uint32 m_chunksX;
+	uint32 m_chunksY;
+
+	std::vector<sf::Uint32> m_tiles;
+	std::vector<TileChunk> m_chunks;
+
+	// chunks waiting for their jobs
+	std::vector<uint32> m_loading;
+
+	const std::vector<sf::Texture>& m_textures;
+
+	std::size_t m_memory;
+	uint32 m_loadedCount;
+
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef _MAP_BINARY_H_
+#define _MAP_BINARY_H_
+
+#include <Utils.h>
+
+// layout of precompiled .tmxb maps, written by MapLoader::saveBinary.
+// All values are little endian, arrays are stored as a count followed by
+// the raw elements so vertex data can be copied straight out of the file.
+struct MapBinary
+{
+	static const uint32 MAGIC = 0x42584d54; // "TMXB"
+	static const uint32 VERSION = 6;
+
+	static const char* EXTENSION;
+
+	// leading part of every file, the rest is only read when it matches the build
+	struct Header
+	{
+		uint32 magic;
+		uint32 version;
+		uint32 vertexSize;
+		uint32 sourceCount;
+	};
+};
+
+// appends plain values to a growing byte buffer
+class BinaryWriter
+{
+public:
+
+	template <typename T>
+	void write(const T& value);
+
+	template <typename T>
+	void writeArray(const T* values, uint32 count);
+
+	void writeString(const std::string& value);
+
+	inline const std::vector<uint8>& getData() const { return m_data; }
+
+private:
+
+	std::vector<uint8> m_data;
+
+};
+
+// reads plain values from a memory block, every read past the end fails
+// and leaves the reader in the failed state
+class BinaryReader
+{
+public:
+
+	BinaryReader(const uint8* data, std::size_t size);
+
+	template <typename T>
+	bool read(T& value);
+
+	// returns a pointer into the block, the elements may be unaligned
+	template <typename T>
+	const uint8* readArray(uint32& count);
+
+	bool readString(std::string& value);
+
+	inline bool failed() const { return m_failed; }
+
+private:
+
+	bool skip(std::size_t size);
+
+private:
+
+	const uint8* m_data;
+	std::size_t m_size;
+	std::size_t m_offset;
+	bool m_failed;
+
+};
+
+template <typename T>
+void BinaryWriter::write(const T& value)
+{
+	const uint8* bytes = reinterpret_cast<const uint8*>(&value);
+	m_data.insert(m_data.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+void BinaryWriter::writeArray(const T* values, uint32 count)
+{
+	write(count);
+	if (count == 0)
+		return;
+
+	const uint8* bytes = reinterpret_cast<const uint8*>(values);
+	m_data.insert(m_data.end(), bytes, bytes + sizeof(T) * count);
+}
+
+template <typename T>
+bool BinaryReader::read(T& value)
+{
+	const uint8* src = m_data + m_offset;
+	if (!skip(sizeof(T)))
+		return false;
+
+	std::memcpy(&value, src, sizeof(T));
+	return true;
+}
+
+template <typename T>
+const uint8* BinaryReader::readArray(uint32& count)
+{
+	count = 0;
+	if (!read(count))
+		return 0;
+
+	const uint8* src = m_data + m_offset;
+	if (!skip(sizeof(T) * (std::size_t)(count)))
+	{
+		count = 0;
+		return 0;
+	}
+
+	return src;
+}
+
+#endif
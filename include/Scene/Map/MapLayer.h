@@ -4,54 +4,136 @@
 #include <Utils.h>
 
 #include <Scene/Map/MapObject.h>
+#include <Scene/Map/ChunkedLayer.h>
+#include <Scene/Map/TileQuad.h>
+#include <Scene/Map/TileTable.h>
+
+#include <SFML/Graphics/VertexBuffer.hpp>
+
+// drawable composed of vertices representing a set of tiles on a layer.
+// Quads are kept sorted by the world cell they start in, so a draw only sends
+// the vertex ranges of the cells intersecting the view. The vertices are
+// uploaded once to a vertex buffer, moved quads only update their own range.
+// Quads are stored in a pool by the index they were added with, moving one
+// puts it on a dirty list so a draw only touches the quads that changed.
+// Quads showing animated tiles are listed so their frames can be swapped
+// without touching the other quads.
+class LayerSet : public sf::Drawable
+{
+public:
 
-class LayerSet;
+	// size of the cells in world units
+	static const uint32 CELL_SIZE = 512;
 
-class TileQuad
-{
-	friend class LayerSet;
+	LayerSet(const sf::Texture& texture);
 
-public:
+	TileQuad addTile(sf::Vertex v0, sf::Vertex v1, sf::Vertex v2, sf::Vertex v3);
 
-	typedef std::shared_ptr<TileQuad> Ptr;
+	// adds quads from raw vertex data, e.g. read from a precompiled map,
+	// the data does not have to be aligned
+	void addTiles(const uint8* vertexData, uint32 vertexCount);
 
-	TileQuad(sf::Uint16 i0, sf::Uint16 i1, sf::Uint16 i2, sf::Uint16 i3);
+	// quad drawn by the vertices starting at position * 4 in getVertices
+	TileQuad getQuad(uint32 position);
 
-	void move(const sf::Vector2f& distance);
+	// position of the quad in getVertices as used by getQuad, -1 if it belongs to another set
+	int32 findQuad(const TileQuad& quad) const;
 
-private:
+	// adds distance to the pending movement of the quad
+	void moveQuad(uint32 index, const sf::Vector2f& distance);
 
-	std::array<sf::Uint16, 4u> m_indices;
-	sf::Vector2f m_movement;
-	bool m_needsUpdate;
+	// quad showing an animated tile, gid keeps the flip flags of the placed tile
+	struct AnimatedQuad
+	{
+		uint32 quad;
+		uint32 animation;
+		sf::Uint32 gid;
+	};
 
-};
+	void addAnimatedQuad(uint32 index, uint32 animation, sf::Uint32 gid);
 
-// drawable composed of vertices representing a set of tiles on a layer
-class LayerSet : public sf::Drawable
-{
-public:
+	inline const std::vector<AnimatedQuad>& getAnimatedQuads() const { return m_animatedQuads; }
 
-	LayerSet(const sf::Texture& texture);
+	// replaces the texture coordinates of the four vertices of the quad
+	void setQuadTexCoords(uint32 index, const sf::Vector2f* texCoords);
 
-	TileQuad::Ptr addTile(sf::Vertex v0, sf::Vertex v1, sf::Vertex v2, sf::Vertex v3);
+	// vertices in cell order with all pending quad movement applied
+	const std::vector<sf::Vertex>& getVertices() const;
 
+	// limits the next draw to the given bounds instead of the view of the target
 	void cull(const sf::FloatRect& bounds);
 
+	const sf::FloatRect& getBoundingBox() const;
+
+	// vertices sent to render targets by map layers since the last reset
+	static inline uint32 getDrawnVertexCount() { return s_drawnVertices; }
+	static inline void resetDrawnVertexCount() { s_drawnVertices = 0; }
+	static inline void addDrawnVertices(uint32 count) { s_drawnVertices += count; }
+
+	// map layers draw from client side vertex arrays when disabled or not supported,
+	// checked when a set uploads its vertices
+	static void setVertexBuffersEnabled(bool enabled);
+	static bool vertexBuffersEnabled();
+
 private:
 
+	// 8 bytes per quad next to its 80 bytes of vertices, movement is kept
+	// only for the few quads that moved since the last draw
+	struct Quad
+	{
+		// the four vertices of a quad are next to each other
+		uint32 first;
+
+		// 1 + index of the pending movement in m_moves, 0 when the quad did not move
+		uint32 move;
+	};
+
+	struct Move
+	{
+		uint32 quad;
+		sf::Vector2f distance;
+	};
+
+	// range of vertices whose quads start in the same cell
+	struct Cell
+	{
+		sf::FloatRect bounds;
+		uint32 first;
+		uint32 count;
+	};
+
 	void draw(sf::RenderTarget& target, sf::RenderStates states) const;
 
-	void _updateAABB(sf::Vector2f position, sf::Vector2f size);
+	void _drawRange(sf::RenderTarget& target, const sf::RenderStates& states, uint32 first, uint32 count) const;
+
+	void _updateQuads() const;
+
+	// uploads all vertices after the cells were rebuilt
+	void _updateBuffer() const;
+
+	// sorts quads by cell and rebuilds the cell ranges after tiles were added
+	void _buildCells() const;
 
 private:
 
 	const sf::Texture& m_texture;
-	mutable std::vector<TileQuad::Ptr> m_quads;
+	mutable std::vector<Quad> m_quads;
+	mutable std::vector<Move> m_moves;
 	mutable std::vector<sf::Vertex> m_vertices;
+	std::vector<AnimatedQuad> m_animatedQuads;
+
+	mutable std::vector<Cell> m_cells;
+	mutable bool m_cellsDirty;
+	mutable sf::FloatRect m_boundingBox;
+
+	mutable sf::VertexBuffer m_buffer;
+	mutable bool m_bufferDirty;
 
-	sf::FloatRect m_boundingBox;
-	bool m_visible;
+	mutable sf::FloatRect m_cullBounds;
+	mutable bool m_culled;
+
+	static uint32 s_drawnVertices;
+	static bool s_vertexBuffersEnabled;
 };
 
 // used to query the type of layer, for example when looking for layers containing collision objects
@@ -87,6 +169,13 @@ public:
 	std::map<std::string, std::string> properties;
 
 	std::map<sf::Uint16, std::shared_ptr<LayerSet>> layerSets;
+
+	// tiles of streamed layers, drawn instead of layer sets
+	std::shared_ptr<ChunkedLayer> chunks;
+
+	// solid tiles of tile layers, empty for other layers
+	CollisionMap collision;
+
 	void setShader(const sf::Shader& shader);
 	void cull(const sf::FloatRect& bounds);
 
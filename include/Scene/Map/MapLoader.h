@@ -4,7 +4,10 @@
 #include <Utils.h>
 
 #include <Scene/Map/QuadTreeNode.h>
+#include <Scene/Map/SpatialHash.h>
 #include <Scene/Map/MapLayer.h>
+#include <Scene/Map/MapBinary.h>
+#include <Scene/Map/ChunkedLayer.h>
 
 #include <Filesystem/Xml/pugixml.h>
 
@@ -21,16 +24,120 @@ class MapLoader : public sf::Drawable, private sf::NonCopyable
 {
 public:
 
+	// controls splitting tile layers into chunks loaded around the view
+	struct StreamingSettings
+	{
+		StreamingSettings();
+
+		// streams every map, otherwise only maps with the "streaming" property set to true
+		bool enabled;
+
+		// tiles per chunk side, maps can override it with the "chunksize" property
+		uint32 chunkSize;
+
+		// chunks within loadRadius chunks of the view are loaded, loaded chunks
+		// are kept until they are further than loadRadius + hysteresis chunks
+		uint32 loadRadius;
+		uint32 hysteresis;
+
+		// bytes of chunk vertex data, far chunks are unloaded early to stay below it
+		std::size_t memoryBudget;
+	};
+
+	// time spent in the steps of the last load
+	struct LoadTimings
+	{
+		// reading a precompiled map, the other steps are skipped
+		sf::Time binary;
+
+		// parsing the xml document and the map properties
+		sf::Time parse;
+
+		// decoding tileset images in parallel, then creating textures and tile info
+		sf::Time tilesets;
+
+		// decoding tile layers and object groups in parallel
+		sf::Time layers;
+
+		// parsing image layers and adding all layers in document order
+		sf::Time assembly;
+	};
+
+	// largest width x height of a map, four vertices of every tile have to be
+	// addressable by 32 bit indices
+	static const uint32 MAX_TILES = 1u << 28;
+
+	// map of width x height tiles is not above MAX_TILES, the product does not wrap around
+	static inline bool fitsTileLimit(uint32 width, uint32 height) { return (uint64_t)(width) * height <= MAX_TILES; }
+
 	MapLoader(const std::string& mapDirectory);
 
-	bool load(const std::string& mapFile);
+	~MapLoader();
+
+	// loads a tmx map, or a precompiled .tmxb map. A tmx map is taken from the
+	// .tmxb file next to it when useBinary is set and the file is up to date.
+	bool load(const std::string& mapFile, bool useBinary = true);
+
+	// writes the loaded map to a precompiled .tmxb file
+	bool saveBinary(const std::string& path) const;
 
 	void addSearchPath(const std::string& path);
 
+	// rebuilds the quad tree when the root area or the number of objects changes,
+	// otherwise only reinserts objects that moved. Maps using the spatial hash
+	// index all their objects, whatever the root area.
 	void updateQuadTree(const sf::FloatRect& rootArea);
 
+	// default limits of the quad tree, maps override them with their quad tree properties
+	void setQuadTreeSettings(const QuadTreeSettings& settings);
+
+	const QuadTreeSettings& getQuadTreeSettings() const;
+
+	void setStreamingSettings(const StreamingSettings& settings);
+
+	const StreamingSettings& getStreamingSettings() const;
+
+	bool isStreamed() const;
+
+	// loads chunks of streamed layers around the view and unloads the far ones
+	void updateStreaming(const sf::View& view);
+
+	// advances tile animations, only quads of tiles whose frame changed are updated
+	void updateAnimations(const sf::Time& elapsed);
+
 	std::vector<MapObject*> queryQuadTree(const sf::FloatRect& testArea);
 
+	// appends the objects whose AABB intersects testArea to results, reusing
+	// results between queries avoids allocating
+	void queryQuadTree(const sf::FloatRect& testArea, std::vector<MapObject*>& results);
+
+	// calls visitor with every object whose AABB intersects testArea
+	template <typename Visitor>
+	void visitQuadTree(const sf::FloatRect& testArea, Visitor&& visitor)
+	{
+		assert(m_quadTreeAvailable);
+		if (m_useSpatialHash)
+			m_spatialHash.visit(testArea, visitor);
+		else
+			m_rootNode.visit(testArea, visitor);
+	}
+
+	// appends the objects whose AABB contains point
+	void queryPoint(const sf::Vector2f& point, std::vector<MapObject*>& results);
+
+	// appends the objects whose AABB the ray hits within length, nearest first
+	void raycast(const sf::Vector2f& origin, const sf::Vector2f& direction, float length, std::vector<MapObject*>& results);
+
+	// appends up to count objects with the closest AABBs to point, nearest first
+	void queryNearest(const sf::Vector2f& point, uint32 count, std::vector<MapObject*>& results);
+
+	// the map set its "spatialindex" property to "hash", queries use the spatial hash instead of the quad tree
+	bool usesSpatialHash() const;
+
+	// game objects can be indexed here with their bounds, they are kept when maps are loaded
+	// and removed when they are destroyed
+	SpatialHash& getSpatialHash();
+
 	std::vector<MapLayer>& getLayers();
 
 	const std::vector<MapLayer>& getLayers() const;
@@ -51,6 +158,14 @@ public:
 
 	bool quadTreeAvailable() const;
 
+	const LoadTimings& getLoadTimings() const;
+
+	// properties and collision shapes of tiles by gid
+	const TileTable& getTileTable() const;
+
+	// a tile layer has a solid tile at the tile coordinates
+	bool isSolid(uint32 x, uint32 y) const;
+
 private:
 
 	struct TileInfo
@@ -63,47 +178,113 @@ private:
 		sf::Uint16 tilesetId;
 	};
 
+	// image of a tileset or image layer, kept to reload precompiled maps
+	struct ImageSource
+	{
+		std::string name;
+		bool hasTrans;
+		sf::Color trans;
+	};
+
+	// frames of an animated tile, quads of the tile show the frame at the current time
+	struct TileAnimation
+	{
+		struct Frame
+		{
+			sf::Uint32 gid;
+
+			// milliseconds
+			sf::Int32 duration;
+		};
+
+		std::vector<Frame> frames;
+		sf::Int32 length;
+		uint32 currentFrame;
+		bool changed;
+	};
+
+	// layer node of the map, tile layers and object groups are parsed by jobs
+	struct LayerSlot
+	{
+		LayerSlot(const pugi::xml_node& n);
+
+		pugi::xml_node node;
+		std::unique_ptr<MapLayer> layer;
+		bool parsed;
+	};
+
 	void _unload();
 
 	void _setDrawingBounds(const sf::View& view);
 
 	bool _parseMapNode(const pugi::xml_node& mapNode);
 	bool _parseTileSets(const pugi::xml_node& mapNode);
-	bool _processTiles(const pugi::xml_node& tlesetNode);
-	bool _parseLayer(const pugi::xml_node& layerNode);
-	bool _parseObjectGroup(const pugi::xml_node& groupNode);
+	bool _loadTilesetImage(const pugi::xml_node& tilesetNode, sf::Image& image) const;
+	bool _processTiles(const pugi::xml_node& tilesetNode, const sf::Image& sourceImage);
+	void _parseTileAnimations(const pugi::xml_node& tilesetNode, sf::Uint32 firstGid);
+	void _parseLayerSlot(LayerSlot& slot);
+	bool _parseLayer(const pugi::xml_node& layerNode, MapLayer& layer);
+	bool _parseObjectGroup(const pugi::xml_node& groupNode, MapLayer& layer);
 	bool _parseImageLayer(const pugi::xml_node& imageLayerNode);
 	bool _parseLayerProperties(const pugi::xml_node& propertiesNode, MapLayer& destLayer);
+	void _applySpatialIndexSettings();
+
+	bool _loadBinary(const std::string& path, bool checkSources);
+	bool _readBinary(BinaryReader& reader, bool checkSources);
+	bool _readBinaryLayer(BinaryReader& reader);
+	void _writeBinaryLayer(BinaryWriter& writer, const MapLayer& layer) const;
+	bool _loadImageSource(const ImageSource& source, sf::Texture& texture);
 
-	TileQuad::Ptr _addTileToLayer(MapLayer& layer, sf::Uint16 x, sf::Uint16 y, sf::Uint32 gid, const sf::Vector2f& offset = sf::Vector2f());
+	TileQuad _addTileToLayer(MapLayer& layer, uint32 x, uint32 y, sf::Uint32 gid, const sf::Vector2f& offset = sf::Vector2f());
+
+	// writes the four vertices of the tile to quad and returns its tileset id
+	sf::Uint16 _buildTileQuad(float opacity, uint32 x, uint32 y, sf::Uint32 gid, const sf::Vector2f& offset, sf::Vertex* quad) const;
+
+	// texture coordinates of the four vertices of the tile, flipped by the flags of gid
+	void _tileTexCoords(sf::Uint32 gid, sf::Vector2f* texCoords) const;
+
+	// animation shown by the tile, -1 if it is not animated
+	int32 _findAnimation(sf::Uint32 gid) const;
+
+	// stores the tile in the chunks of streamed layers, otherwise adds its quad
+	void _setLayerTile(MapLayer& layer, uint32 x, uint32 y, sf::Uint32 gid);
+
+	sf::Vector2f _tilePosition(uint32 x, uint32 y) const;
+
+	std::shared_ptr<ChunkedLayer> _createChunkedLayer(uint32 chunkSize);
+	void _buildChunk(const ChunkedLayer& chunks, float opacity, uint32 chunkX, uint32 chunkY, TileChunk::Data& data) const;
+	void _waitForChunks();
 	void _setIsometricCoords(MapLayer& layer);
 	void _drawLayer(sf::RenderTarget& target, MapLayer& layer, bool debug = false);
-	std::string _fileFromPath(const std::string& path);
+	std::string _fileFromPath(const std::string& path) const;
 
 	void draw(sf::RenderTarget& target, sf::RenderStates states) const;
 
 	// utility method for parsing color values from hex values
 	sf::Color _colorFromHex(const char* hexStr) const;
 
-	// method for decompressing zlib compressed strings
-	bool _decompress(const char* source, std::vector<unsigned char>& dest, int inSize, int expectedSize);
-
 	void _createDebugGrid();
 
 	sf::Image& _loadImage(const std::string& imageName);
 
-	std::vector<unsigned char> _intToBytes(sf::Uint32 paramInt);
-	std::pair<sf::Uint32, std::bitset<3>> _resolveRotation(sf::Uint32 gid);
+	// loads the image from the first search path containing it, without caching it
+	bool _readImage(const std::string& imageName, sf::Image& image) const;
+
+	// records the image found in the search paths as a source of the precompiled map
+	void _addImageSourceFile(const std::string& imageName);
 
-	void _flipY(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3);
-	void _flipX(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3);
-	void _flipD(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3);
+	std::vector<unsigned char> _intToBytes(sf::Uint32 paramInt) const;
+	std::pair<sf::Uint32, std::bitset<3>> _resolveRotation(sf::Uint32 gid) const;
 
-	void _doFlips(std::bitset<3> bits, sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3);
+	void _flipY(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3) const;
+	void _flipX(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3) const;
+	void _flipD(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3) const;
+
+	void _doFlips(std::bitset<3> bits, sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3) const;
 
 private:
 
-	sf::Uint16 m_width, m_height;
+	uint32 m_width, m_height;
 	sf::Uint16  m_tileWidth, m_tileHeight;
 	MapOrientation m_orientation;
 	float m_tileRatio;
@@ -118,16 +299,36 @@ private:
 	std::vector<sf::Texture> m_tilesetTextures;
 
 	std::vector<TileInfo> m_tileInfo;
+	TileTable m_tileTable;
+
+	// animations of tiles, looked up by tile id without flip flags
+	std::vector<TileAnimation> m_animations;
+	std::unordered_map<sf::Uint32, uint32> m_animatedTiles;
+	sf::Time m_animationTime;
 
 	sf::VertexArray m_gridVertices;
 	bool m_mapLoaded, m_quadTreeAvailable;
 	QuadTreeRoot m_rootNode;
+	QuadTreeSettings m_quadTreeSettings;
+	SpatialHash m_spatialHash;
+	bool m_useSpatialHash;
 
 	std::map<std::string, std::shared_ptr<sf::Image>> m_cachedImages;
 	bool m_failedImage;
 
-};
+	// files the map was parsed from, a precompiled map is stale when one of them changes
+	std::vector<std::string> m_sourceFiles;
+
+	LoadTimings m_loadTimings;
 
-static std::string base64_decode(std::string const& string);
+	StreamingSettings m_streaming;
+	bool m_streamed;
+	uint32 m_chunkSize;
+	sf::Vector2f m_maxTileSize;
+
+	std::vector<ImageSource> m_tilesetImages;
+	std::vector<ImageSource> m_imageLayerImages;
+
+};
 
 #endif
@@ -15,11 +15,10 @@
 #include <SFML/Graphics/Text.hpp>
 
 #include <Scene/Map/DebugShape.h>
+#include <Scene/Map/TileQuad.h>
 
 #include <Math/Vector2.h>
 
-class TileQuad;
-
 enum MapObjectShape
 {
 	Rectangle,
@@ -79,6 +78,10 @@ public:
 
 	void setSize(const sf::Vector2f& size) { m_size = size; }
 
+	sf::Vector2f getSize() const { return m_size; }
+
+	const std::map<std::string, std::string>& getProperties() const { return m_properties; }
+
 	// call createDebugShape() afterwards to rebuild debug output
 	void addPoint(const sf::Vector2f& point) { m_polypoints.push_back(point); }
 
@@ -92,6 +95,8 @@ public:
 	// creates a shape used for debug drawing
 	void createDebugShape(const sf::Color& color);
 
+	sf::Color getDebugColor() const { return m_debugColor; }
+
 	// draws debug shape to given target
 	void drawDebugShape(sf::RenderTarget& target) const;
 
@@ -118,7 +123,9 @@ public:
 	void reverseWinding();
 
 	// sets the quad used to draw the tile for tile objects
-	void setQuad(std::shared_ptr<TileQuad> quad);
+	void setQuad(const TileQuad& quad);
+
+	const TileQuad& getQuad() const { return m_tileQuad; }
 
 private:
 
@@ -150,12 +157,13 @@ private:
 	std::vector<sf::Vector2f> m_polypoints;
 	MapObjectShape m_shape;
 	DebugShape m_debugShape;
+	sf::Color m_debugColor;
 	sf::Vector2f m_centrePoint;
 
 	bool m_visible;
 
 	std::vector<Segment> m_polySegs;
-	std::shared_ptr<TileQuad> m_tileQuad;
+	TileQuad m_tileQuad;
 
 	float m_furthestPoint;
 
@@ -4,62 +4,163 @@
 #include <Utils.h>
 
 #include <Scene/Map/MapObject.h>
+#include <Scene/Map/SpatialQuery.h>
 
-class QuadTreeNode : public sf::Drawable
+// limits of a quad tree, maps can override them with the "quadtreecapacity",
+// "quadtreedepth" and "quadtreelooseness" properties
+struct QuadTreeSettings
+{
+	QuadTreeSettings();
+
+	// objects a node holds before it splits
+	uint32 capacity;
+
+	// levels of nodes below the root
+	uint32 maxDepth;
+
+	// nodes hold objects inside their area grown by this factor. 1 is a plain
+	// quad tree, at 2 objects straddling a midpoint still move into a child.
+	float looseness;
+};
+
+// quad tree kept between frames, objects are only reinserted when they move.
+// Nodes live in a flat pool, the four children of a node are next to each
+// other and referenced by index, and freed children are reused by later splits.
+// The whole tree is only rebuilt when the root area or the settings change.
+class QuadTreeRoot : public sf::Drawable
 {
 public:
 
-	QuadTreeNode(sf::Uint16 level = 0, const sf::FloatRect& bounds = sf::FloatRect(0.f, 0.f, 0.f, 0.f));
-	
-	virtual ~QuadTreeNode() { }
+	QuadTreeRoot();
+
+	void clear(const sf::FloatRect& newBounds);
+
+	// clears the tree, objects have to be inserted again
+	void setSettings(const QuadTreeSettings& settings);
+
+	inline const QuadTreeSettings& getSettings() const { return m_settings; }
+
+	inline const sf::FloatRect& getBounds() const { return m_nodes[0].bounds; }
 
-	std::vector<MapObject*> retrieve(const sf::FloatRect& bounds, sf::Uint16& currentDepth);
+	inline std::size_t getObjectCount() const { return m_locations.size(); }
+
+	// nodes in use, freed children excluded
+	inline std::size_t getNodeCount() const { return m_nodes.size() - m_freeChildren.size() * 4u; }
 
 	void insert(const MapObject& object);
 
-protected:
+	void remove(const MapObject& object);
 
-	sf::Int16 _getIndex(const sf::FloatRect& bounds);
+	// moves the object to the node matching its current AABB, does nothing if it did not change
+	void update(const MapObject& object);
 
-	void _split();
+	std::vector<MapObject*> retrieve(const sf::FloatRect& bounds);
 
-protected:
+	// appends objects whose AABB intersects bounds to results, nothing is
+	// allocated unless results has to grow
+	void retrieve(const sf::FloatRect& bounds, std::vector<MapObject*>& results);
 
-	const sf::Uint16 MAX_OBJECTS;
-	const sf::Uint16 MAX_LEVELS;
+	// calls visitor with every object whose AABB intersects bounds
+	template <typename Visitor>
+	void visit(const sf::FloatRect& bounds, Visitor&& visitor);
 
-	sf::Uint16 m_level;
-	sf::FloatRect m_bounds;
-	std::vector<MapObject*> m_objects;
-	std::vector<std::shared_ptr<QuadTreeNode>> m_children;
-	sf::RectangleShape m_debugShape;
+	// appends objects whose AABB contains point
+	void retrieve(const sf::Vector2f& point, std::vector<MapObject*>& results);
 
-private:
+	// appends objects whose AABB the ray hits within length, nearest first
+	void raycast(const sf::Vector2f& origin, const sf::Vector2f& direction, float length, std::vector<MapObject*>& results);
 
-	void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+	// appends up to count objects with the closest AABBs to point, nearest first
+	void nearest(const sf::Vector2f& point, uint32 count, std::vector<MapObject*>& results);
 
-};
+private:
 
-class QuadTreeRoot : public QuadTreeNode
-{
-public:
+	static const uint32 NONE = 0xffffffff;
 
-	QuadTreeRoot(sf::Uint16 level = 0, const sf::FloatRect& bounds = sf::FloatRect(0.f, 0.f, 0.f, 0.f)) :
-		QuadTreeNode(level, bounds), m_depth(0u), m_searchDepth(0u)
+	struct Node
 	{
-	}
+		// quadrant of the node and the area its objects have to lie in
+		sf::FloatRect bounds;
+		sf::FloatRect looseBounds;
 
-	void clear(const sf::FloatRect& newBounds);
+		uint32 parent;
+		uint32 depth;
+
+		// first of the four children, NONE for leaves
+		uint32 firstChild;
+
+		std::vector<MapObject*> objects;
 
-	std::vector<MapObject*> retrieve(const sf::FloatRect& bounds)
+		// drawn red by the debug view when the last query visited the node
+		mutable bool retrieved;
+	};
+
+	// node of each object, so objects can be removed or moved without searching the tree
+	struct Location
 	{
-		return QuadTreeNode::retrieve(bounds, m_searchDepth);
-	}
+		uint32 node;
+		sf::FloatRect aabb;
+	};
+
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+
+	void _resetNode(uint32 index, const sf::FloatRect& bounds, uint32 parent, uint32 depth);
+
+	// adds the object to the node and splits it when it holds too many
+	void _addToNode(uint32 index, MapObject* object, Location& location);
+
+	void _split(uint32 index);
+
+	// merges children holding few enough objects back into their parent, up to the root
+	void _collapse(uint32 index);
+
+	// child of the node whose loose area holds aabb, NONE if the object stays in the node
+	uint32 _childFor(uint32 index, const sf::FloatRect& aabb) const;
+
+	template <typename Visitor>
+	void _visit(uint32 index, const sf::FloatRect& bounds, Visitor& visitor);
+
+	// adds the objects of the node and its children hit by the ray to m_hits
+	void _raycast(uint32 index, const sf::Vector2f& origin, const sf::Vector2f& direction, float length);
 
 private:
 
-	sf::Uint16 m_depth, m_searchDepth;
+	QuadTreeSettings m_settings;
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32> m_freeChildren;
+
+	std::unordered_map<const MapObject*, Location> m_locations;
+
+	// scratch space of ray and nearest queries, kept to avoid allocating per query
+	std::vector<std::pair<float, MapObject*>> m_hits;
+	std::vector<std::pair<float, uint32>> m_queue;
 
 };
 
+template <typename Visitor>
+void QuadTreeRoot::visit(const sf::FloatRect& bounds, Visitor&& visitor)
+{
+	_visit(0, bounds, visitor);
+}
+
+template <typename Visitor>
+void QuadTreeRoot::_visit(uint32 index, const sf::FloatRect& bounds, Visitor& visitor)
+{
+	const Node& node = m_nodes[index];
+	node.retrieved = true;
+
+	// objects of a node can lie outside the query, so each of them is tested
+	for (MapObject* object : node.objects)
+		if (SpatialQuery::overlaps(bounds, object->getAABB()))
+			visitor(*object);
+
+	if (node.firstChild == NONE)
+		return;
+
+	for (uint32 child = node.firstChild; child < node.firstChild + 4u; ++child)
+		if (SpatialQuery::overlaps(bounds, m_nodes[child].looseBounds))
+			_visit(child, bounds, visitor);
+}
+
 #endif
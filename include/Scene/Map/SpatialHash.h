@@ -0,0 +1,218 @@
+#ifndef _SPATIAL_HASH_H_
+#define _SPATIAL_HASH_H_
+
+#include <Utils.h>
+
+#include <Scene/Map/MapObject.h>
+#include <Scene/Map/SpatialQuery.h>
+
+#include <SFML/System/NonCopyable.hpp>
+
+class GameObject;
+
+// uniform grid of hashed cells, an alternative to QuadTreeRoot for maps whose
+// objects are about tile sized and spread evenly. Objects are kept in every
+// cell their AABB touches and only move between cells when the cell range of
+// their AABB changes. Besides map objects it indexes game objects, whose
+// bounds are passed in since they have no AABB of their own. Game objects are
+// removed from every hash when they are destroyed, map objects stay until
+// they are removed or the map is unloaded.
+class SpatialHash : public sf::Drawable, private sf::NonCopyable
+{
+public:
+
+	SpatialHash();
+
+	~SpatialHash();
+
+	// removes the game object from every existing hash, called by its destructor
+	static void removeFromAll(const GameObject& object);
+
+	// removes map objects and game objects
+	void clear();
+
+	// removes map objects only, game objects stay indexed
+	void clearMapObjects();
+
+	// objects are moved to the cells of the new size
+	void setCellSize(float size);
+
+	inline float getCellSize() const { return m_cellSize; }
+
+	inline std::size_t getObjectCount() const { return m_mapObjectCount; }
+
+	inline std::size_t getGameObjectCount() const { return m_indices.size() - m_mapObjectCount; }
+
+	void insert(const MapObject& object);
+
+	void remove(const MapObject& object);
+
+	// moves the object to the cells of its current AABB, inserts unknown objects
+	void update(const MapObject& object);
+
+	void insert(GameObject& object, const sf::FloatRect& bounds);
+
+	void remove(const GameObject& object);
+
+	void update(GameObject& object, const sf::FloatRect& bounds);
+
+	std::vector<MapObject*> retrieve(const sf::FloatRect& bounds);
+
+	// appends objects whose AABB intersects bounds to results, nothing is
+	// allocated unless results has to grow
+	void retrieve(const sf::FloatRect& bounds, std::vector<MapObject*>& results);
+	void retrieve(const sf::FloatRect& bounds, std::vector<GameObject*>& results);
+
+	// calls visitor with every map object whose AABB intersects bounds
+	template <typename Visitor>
+	void visit(const sf::FloatRect& bounds, Visitor&& visitor);
+
+	template <typename Visitor>
+	void visitGameObjects(const sf::FloatRect& bounds, Visitor&& visitor);
+
+	// appends objects whose AABB contains point
+	void retrieve(const sf::Vector2f& point, std::vector<MapObject*>& results);
+	void retrieve(const sf::Vector2f& point, std::vector<GameObject*>& results);
+
+	// appends objects whose AABB the ray hits within length, nearest first
+	void raycast(const sf::Vector2f& origin, const sf::Vector2f& direction, float length, std::vector<MapObject*>& results);
+	void raycast(const sf::Vector2f& origin, const sf::Vector2f& direction, float length, std::vector<GameObject*>& results);
+
+	// appends up to count objects with the closest AABBs to point, nearest first
+	void nearest(const sf::Vector2f& point, uint32 count, std::vector<MapObject*>& results);
+	void nearest(const sf::Vector2f& point, uint32 count, std::vector<GameObject*>& results);
+
+private:
+
+	static const uint32 NONE = 0xffffffff;
+
+	struct Entry
+	{
+		sf::FloatRect aabb;
+		sf::IntRect cells;
+
+		// one of them is set while the entry is in use
+		MapObject* mapObject;
+		GameObject* gameObject;
+
+		// last query that reported the entry, objects spanning cells are reported once
+		uint32 queryStamp;
+	};
+
+	struct Cell
+	{
+		std::vector<uint32> entries;
+
+		// drawn red by the debug view when the last query visited the cell
+		mutable bool retrieved;
+	};
+
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+
+	void _insert(const void* key, MapObject* mapObject, GameObject* gameObject, const sf::FloatRect& aabb);
+
+	void _remove(const void* key);
+
+	// moves the entry to the cells of aabb
+	void _move(uint32 index, const sf::FloatRect& aabb);
+
+	void _addToCells(uint32 index);
+	void _removeFromCells(uint32 index);
+
+	void _getCellRange(const sf::FloatRect& rect, sf::IntRect& range) const;
+
+	static uint64_t _getCellKey(int32 x, int32 y);
+
+	// calls visitor with every entry whose AABB intersects bounds, map objects and game objects
+	template <typename Visitor>
+	void _visitEntries(const sf::FloatRect& bounds, Visitor&& visitor);
+
+	// fill m_hits with entries of map objects or game objects, nearest first
+	void _raycast(const sf::Vector2f& origin, const sf::Vector2f& direction, float length, bool gameObjects);
+	void _nearest(const sf::Vector2f& point, uint32 count, bool gameObjects);
+
+	// offers the entries of the cell to the max heap of the count nearest entries
+	void _addNearest(int32 x, int32 y, const sf::Vector2f& point, uint32 count, bool gameObjects);
+
+private:
+
+	float m_cellSize;
+
+	std::vector<Entry> m_entries;
+	std::vector<uint32> m_freeEntries;
+	std::unordered_map<const void*, uint32> m_indices;
+	std::size_t m_mapObjectCount;
+
+	// cells are kept when they become empty, objects moving back and forth do not reallocate them
+	std::unordered_map<uint64_t, Cell> m_cells;
+
+	// cells that held entries since the last clear, limits queries to the used area
+	sf::IntRect m_cellRange;
+
+	uint32 m_queryStamp;
+
+	// hashes that exist, searched for game objects being destroyed
+	static std::vector<SpatialHash*> s_hashes;
+
+	// scratch space of ray and nearest queries, pairs of distance and entry
+	std::vector<std::pair<float, uint32>> m_hits;
+
+};
+
+template <typename Visitor>
+void SpatialHash::visit(const sf::FloatRect& bounds, Visitor&& visitor)
+{
+	_visitEntries(bounds, [&visitor](Entry& entry)
+	{
+		if (entry.mapObject)
+			visitor(*entry.mapObject);
+	});
+}
+
+template <typename Visitor>
+void SpatialHash::visitGameObjects(const sf::FloatRect& bounds, Visitor&& visitor)
+{
+	_visitEntries(bounds, [&visitor](Entry& entry)
+	{
+		if (entry.gameObject)
+			visitor(*entry.gameObject);
+	});
+}
+
+template <typename Visitor>
+void SpatialHash::_visitEntries(const sf::FloatRect& bounds, Visitor&& visitor)
+{
+	sf::IntRect range;
+	_getCellRange(bounds, range);
+
+	// cells outside the used area are empty
+	int32 left = std::max(range.left, m_cellRange.left);
+	int32 top = std::max(range.top, m_cellRange.top);
+	int32 right = std::min(range.left + range.width, m_cellRange.left + m_cellRange.width);
+	int32 bottom = std::min(range.top + range.height, m_cellRange.top + m_cellRange.height);
+
+	m_queryStamp++;
+	for (int32 y = top; y < bottom; y++)
+	{
+		for (int32 x = left; x < right; x++)
+		{
+			auto it = m_cells.find(_getCellKey(x, y));
+			if (it == m_cells.end())
+				continue;
+
+			it->second.retrieved = true;
+			for (uint32 index : it->second.entries)
+			{
+				Entry& entry = m_entries[index];
+				if (entry.queryStamp == m_queryStamp)
+					continue;
+
+				entry.queryStamp = m_queryStamp;
+				if (SpatialQuery::overlaps(bounds, entry.aabb))
+					visitor(entry);
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef _SPATIAL_QUERY_H_
+#define _SPATIAL_QUERY_H_
+
+#include <Utils.h>
+
+// AABB tests shared by the quad tree and the spatial hash, so both indices
+// report the same objects for the same query
+class SpatialQuery
+{
+public:
+
+	// unlike sf::Rect::intersects, touching edges and objects without size overlap
+	static inline bool overlaps(const sf::FloatRect& a, const sf::FloatRect& b)
+	{
+		return a.left <= b.left + b.width && b.left <= a.left + a.width &&
+			a.top <= b.top + b.height && b.top <= a.top + a.height;
+	}
+
+	// squared distance from point to the closest point of aabb, 0 inside it
+	static inline float distanceSquared(const sf::Vector2f& point, const sf::FloatRect& aabb)
+	{
+		float dx = std::max(std::max(aabb.left - point.x, point.x - (aabb.left + aabb.width)), 0.f);
+		float dy = std::max(std::max(aabb.top - point.y, point.y - (aabb.top + aabb.height)), 0.f);
+		return dx * dx + dy * dy;
+	}
+
+	// slab test of a ray with a normalized direction, distance is where the ray
+	// enters aabb, 0 when it starts inside
+	static inline bool raycast(const sf::Vector2f& origin, const sf::Vector2f& direction, float length,
+		const sf::FloatRect& aabb, float& distance)
+	{
+		float enter = 0.f;
+		float leave = length;
+		if (!_slab(origin.x, direction.x, aabb.left, aabb.left + aabb.width, enter, leave) ||
+			!_slab(origin.y, direction.y, aabb.top, aabb.top + aabb.height, enter, leave))
+			return false;
+
+		distance = enter;
+		return true;
+	}
+
+	// direction scaled to length 1, a zero vector stays zero
+	static inline sf::Vector2f normalize(const sf::Vector2f& direction)
+	{
+		float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+		return length > 0.f ? direction / length : direction;
+	}
+
+private:
+
+	static inline bool _slab(float origin, float direction, float min, float max, float& enter, float& leave)
+	{
+		if (direction == 0.f)
+			return origin >= min && origin <= max;
+
+		float t1 = (min - origin) / direction;
+		float t2 = (max - origin) / direction;
+		if (t1 > t2)
+			std::swap(t1, t2);
+
+		enter = std::max(enter, t1);
+		leave = std::min(leave, t2);
+		return enter <= leave;
+	}
+
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef _TEXT_SCANNER_H_
+#define _TEXT_SCANNER_H_
+
+#include <Utils.h>
+
+// reads numbers in place from text of a map document, e.g. csv layer data
+// or polygon points, without copying it into strings or streams
+class TextScanner
+{
+public:
+
+	TextScanner(const char* text);
+
+	// reads the next number, skipping whitespace and commas in front of it.
+	// Returns false at the end of the text or when the text is not a number.
+	bool read(sf::Uint32& value);
+	bool read(float& value);
+
+	// the scanner stopped on text that is not a number instead of the end
+	inline bool failed() const { return m_failed; }
+
+private:
+
+	// returns false at the end of the text
+	bool skipSeparators();
+
+private:
+
+	const char* m_pos;
+	bool m_failed;
+
+};
+
+#endif
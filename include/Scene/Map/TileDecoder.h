@@ -0,0 +1,46 @@
+#ifndef _TILE_DECODER_H_
+#define _TILE_DECODER_H_
+
+#include <Utils.h>
+
+// decodes the encoded and compressed data of tmx tile layers into buffers
+// sized by the caller, no intermediate strings or growing buffers are used
+class TileDecoder
+{
+public:
+
+	enum Compression
+	{
+		None,
+
+		// zlib and gzip streams, told apart by their header
+		Zlib,
+
+		// only available when built with USE_ZSTD
+		Zstd,
+
+		Unknown
+	};
+
+	// compression attribute of a tmx data node, empty means no compression
+	static Compression compressionFromString(const std::string& name);
+
+	// bytes needed to decode length base64 characters
+	static inline std::size_t base64Size(std::size_t length) { return length / 4 * 3 + 3; }
+
+	// decodes base64 text into out, which has to hold base64Size(length) bytes.
+	// Whitespace is skipped and decoding stops at the first padding character.
+	static bool decodeBase64(const char* text, std::size_t length, uint8* out, std::size_t& written);
+
+	// decompresses data into out, the decompressed data has to be exactly size bytes
+	static bool decompress(Compression compression, const uint8* data, std::size_t dataSize, uint8* out, std::size_t size);
+
+private:
+
+	static bool inflateZlib(const uint8* data, std::size_t dataSize, uint8* out, std::size_t size);
+
+	static bool decompressZstd(const uint8* data, std::size_t dataSize, uint8* out, std::size_t size);
+
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef _TILE_QUAD_H_
+#define _TILE_QUAD_H_
+
+#include <Utils.h>
+
+class LayerSet;
+
+// handle to a quad stored in a layer set, e.g. the tile of a tile object.
+// It stays valid as long as the layer set exists.
+class TileQuad
+{
+public:
+
+	TileQuad();
+
+	TileQuad(LayerSet* layerSet, uint32 index);
+
+	// moves the quad by distance the next time the set is drawn
+	void move(const sf::Vector2f& distance);
+
+	inline LayerSet* getLayerSet() const { return m_layerSet; }
+
+	inline uint32 getIndex() const { return m_index; }
+
+	inline bool isValid() const { return m_layerSet != 0; }
+
+private:
+
+	LayerSet* m_layerSet;
+	uint32 m_index;
+
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef _TILE_TABLE_H_
+#define _TILE_TABLE_H_
+
+#include <Utils.h>
+
+#include <Scene/Map/MapBinary.h>
+
+#include <Filesystem/Xml/pugixml.h>
+
+// properties and collision shapes of tileset tiles, parsed once into flat
+// arrays indexed by gid. Property names are interned, so finding a property
+// of a tile compares integers instead of strings.
+class TileTable
+{
+public:
+
+	// name of the bool property marking tiles without collision shapes as solid
+	static const char* SOLID_PROPERTY;
+
+	struct Property
+	{
+		enum Type
+		{
+			String,
+			Int,
+			Float,
+			Bool
+		};
+
+		// index of the interned name
+		uint32 key;
+		uint32 type;
+
+		// strings, colors and files are indices into the string table
+		union
+		{
+			sf::Int32 intValue;
+			float floatValue;
+			uint32 stringIndex;
+		};
+	};
+
+	// collision object of a tile, relative to the top left of the tile
+	struct Shape
+	{
+		// MapObjectShape of the object, Rectangle, Ellipse, Polygon or Polyline
+		uint32 type;
+		sf::FloatRect bounds;
+
+		// points of polygons and polylines in getPoints, relative to the position of bounds
+		uint32 firstPoint;
+		uint32 pointCount;
+	};
+
+	// properties and shapes of one tile, ranges in the flat arrays
+	struct Tile
+	{
+		uint32 firstProperty;
+		uint32 propertyCount;
+		uint32 firstShape;
+		uint32 shapeCount;
+	};
+
+	void clear();
+
+	// makes the table cover gids below count, new tiles have no properties or shapes
+	void resize(uint32 count);
+
+	inline uint32 getTileCount() const { return m_tiles.size(); }
+
+	// parses the properties and objectgroup of a tileset tile node
+	bool parseTile(sf::Uint32 gid, const pugi::xml_node& tileNode);
+
+	// interned name, -1 if no tile has a property with this name
+	int32 findKey(const std::string& name) const;
+
+	inline const std::string& getKey(uint32 key) const { return m_keys[key]; }
+
+	// property of the tile, 0 if it does not have it. Flip flags of gid are ignored.
+	const Property* getProperty(sf::Uint32 gid, uint32 key) const;
+
+	// value of a string, color or file property, empty for int, float and bool
+	// properties, which keep their value in the union instead
+	const std::string& getString(const Property& property) const;
+
+	// tile has collision shapes or the solid property set
+	inline bool isSolid(sf::Uint32 gid) const
+	{
+		gid &= GID_MASK;
+		return gid < m_solid.size() && m_solid[gid] != 0;
+	}
+
+	inline const Tile& getTile(sf::Uint32 gid) const { return m_tiles[gid & GID_MASK]; }
+
+	inline const std::vector<Property>& getProperties() const { return m_properties; }
+	inline const std::vector<Shape>& getShapes() const { return m_shapes; }
+	inline const std::vector<sf::Vector2f>& getPoints() const { return m_points; }
+
+	// precompiled maps store the flat arrays as they are
+	void write(BinaryWriter& writer) const;
+	bool read(BinaryReader& reader);
+
+private:
+
+	// gids keep the flip flags in their highest bits
+	static const sf::Uint32 GID_MASK = 0x1fffffff;
+
+	uint32 _internKey(const std::string& name);
+
+	uint32 _addString(const std::string& value);
+
+	bool _parseShape(const pugi::xml_node& objectNode);
+
+private:
+
+	std::vector<Tile> m_tiles;
+	std::vector<uint8> m_solid;
+
+	std::vector<Property> m_properties;
+	std::vector<Shape> m_shapes;
+	std::vector<sf::Vector2f> m_points;
+
+	std::vector<std::string> m_keys;
+	std::unordered_map<std::string, uint32> m_keyIndices;
+	std::vector<std::string> m_strings;
+
+};
+
+// one bit per tile of a tile layer, set where the tile is solid
+class CollisionMap
+{
+public:
+
+	CollisionMap();
+
+	// clears the map to width x height tiles without collision
+	void create(uint32 width, uint32 height);
+
+	// copies raw words of a map with the same size, the data does not have to be aligned
+	void setWords(const uint8* data, uint32 count);
+
+	inline void set(uint32 x, uint32 y)
+	{
+		uint32 index = y * m_width + x;
+		m_words[index >> 5] |= 1u << (index & 31u);
+	}
+
+	// tiles outside the layer are not solid
+	inline bool isSolid(uint32 x, uint32 y) const
+	{
+		if (x >= m_width || y >= m_height)
+			return false;
+
+		uint32 index = y * m_width + x;
+		return (m_words[index >> 5] >> (index & 31u)) & 1u;
+	}
+
+	inline uint32 getWidth() const { return m_width; }
+	inline uint32 getHeight() const { return m_height; }
+	inline const std::vector<uint32>& getWords() const { return m_words; }
+
+private:
+
+	uint32 m_width;
+	uint32 m_height;
+	std::vector<uint32> m_words;
+
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define _SCENE_H_
 
 #include "Scene/GameObject.h"
+#include "Scene/System.h"
 
 #include "Utils.h"
 
@@ -15,8 +16,12 @@
 
 class Scene
 {
+	friend class GameObject;
+
 public:
 
+	static const uint32 INVALID_PENDING_INDEX = 0xffffffff;
+
 	static void registerComponentFactory(const std::string& id, std::type_index type, Component::OnBuildComponentCallback builder);
 
 	static void unregisterComponentFactory(const std::string& id);
@@ -37,6 +42,15 @@ public:
 	static Component* buildComponent(const std::string& id);
 	static Component* buildComponent(std::type_index type);
 
+	// the scene takes ownership of the system
+	static void registerSystem(System* system);
+
+	static void unregisterSystem(System* system);
+
+	static void unregisterAllSystems();
+
+	static bool isComponentTypeHandled(std::type_index type);
+
 	static bool init();
 
 	static void shutdown();
@@ -63,6 +77,9 @@ public:
 
 	static uint32 getGameObjectCount(bool prefab = false);
 
+	// root game object by its position in the scene storage, see getGameObjectCount
+	static GameObject* getGameObjectAt(uint32 index, bool prefab = false);
+
 	static GameObject* instantiatePrefab(const std::string& id);
 
 	static void processUpdate(const sf::Time& dt, bool sort = false);
@@ -77,6 +94,28 @@ public:
 
 private:
 
+	typedef SlotMap<GameObject*> GameObjectSlots;
+	typedef std::unordered_map<std::string, SlotHandle> GameObjectIndex;
+
+	static bool storeGameObject(GameObject* obj, bool prefab);
+	static bool releaseGameObject(GameObject* obj, bool prefab);
+	// moves the index entry of the stored or pending object to newId, false if newId is taken
+	static bool reindexGameObject(GameObject* obj, const std::string& newId);
+
+	static void queueDestroy(GameObject* obj);
+
+	// sprites written to the render queue by one job
+	static const uint32 SPRITES_PER_JOB = 256;
+
+	// axis aligned bounds of the view, rotation included
+	static sf::FloatRect getViewBounds(const sf::View& view);
+
+	static void renderComponents(sf::RenderTarget* target);
+
+	static void queueChanges(GameObject* obj);
+	static void dequeueChanges(GameObject* obj);
+	static void processPendingChanges(bool sort);
+
 	struct ComponentFactoryData
 	{
 		ComponentFactoryData() :
@@ -89,10 +128,23 @@ private:
 
 	static std::map<std::string, ComponentFactoryData> s_componentFactory;
 
-	static GameObject::List s_prefabs;
-	static GameObject::List s_gameObjects;
-	static GameObject::List s_gameObjectsToCreate;
-	static GameObject::List s_gameObjectsToDestroy;
+	static GameObjectSlots s_prefabs;
+	static GameObjectSlots s_gameObjects;
+	static GameObjectIndex s_prefabIds;
+	static GameObjectIndex s_gameObjectIds;
+
+	static std::vector<GameObject*> s_gameObjectsToCreate;
+	static std::vector<GameObject*> s_gameObjectsToDestroy;
+	static std::unordered_set<std::string> s_idsToCreate;
+	static std::unordered_set<GameObject*> s_pendingDestroy;
+
+	// objects with queued children or delayed components, removed entries are null
+	static std::vector<GameObject*> s_changedGameObjects;
+
+	static std::vector<System*> s_systems;
+
+	// sprites found by the view queries of the current frame
+	static std::vector<SpriteRenderer*> s_visibleSprites;
 
 	static std::string s_sceneFileExtension;
 
@@ -0,0 +1,228 @@
+#ifndef _SLOT_MAP_H_
+#define _SLOT_MAP_H_
+
+#include "Utils.h"
+
+#include <algorithm>
+
+// stable reference to an element of a SlotMap, the generation makes handles
+// of removed elements invalid even when their slot gets reused
+struct SlotHandle
+{
+	static const uint32 INVALID_INDEX = 0xffffffff;
+
+	SlotHandle() :
+		index(INVALID_INDEX),
+		generation(0)
+	{}
+
+	SlotHandle(uint32 i, uint32 g) :
+		index(i),
+		generation(g)
+	{}
+
+	inline bool isValid() const { return index != INVALID_INDEX; }
+
+	inline bool operator==(const SlotHandle& other) const { return index == other.index && generation == other.generation; }
+	inline bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+
+	uint32 index;
+	uint32 generation;
+};
+
+// generational slot map, elements are kept densely packed so iteration walks
+// contiguous memory, while insert, remove and lookup by handle are O(1).
+// Removing swaps the last element into the freed place so the iteration order
+// is not preserved, use sort() when order matters.
+template <typename T>
+class SlotMap
+{
+public:
+
+	typedef typename std::vector<T>::iterator iterator;
+	typedef typename std::vector<T>::const_iterator const_iterator;
+
+	SlotMap();
+
+	SlotHandle insert(const T& value);
+
+	bool remove(SlotHandle handle);
+
+	void clear();
+
+	void reserve(uint32 count);
+
+	bool contains(SlotHandle handle) const;
+
+	T* get(SlotHandle handle);
+	const T* get(SlotHandle handle) const;
+
+	SlotHandle getHandle(uint32 denseIndex) const;
+
+	template <typename Compare>
+	void sort(Compare comp);
+
+	inline uint32 size() const { return m_data.size(); }
+
+	inline bool empty() const { return m_data.empty(); }
+
+	inline T& operator[](uint32 denseIndex) { return m_data[denseIndex]; }
+	inline const T& operator[](uint32 denseIndex) const { return m_data[denseIndex]; }
+
+	inline iterator begin() { return m_data.begin(); }
+	inline iterator end() { return m_data.end(); }
+	inline const_iterator begin() const { return m_data.begin(); }
+	inline const_iterator end() const { return m_data.end(); }
+
+private:
+
+	struct Slot
+	{
+		// index into m_data while the slot is used, next free slot otherwise
+		uint32 dense;
+		uint32 generation;
+	};
+
+	std::vector<T> m_data;
+	std::vector<uint32> m_dataSlots;
+	std::vector<Slot> m_slots;
+	uint32 m_freeHead;
+
+};
+
+template <typename T>
+SlotMap<T>::SlotMap() :
+	m_freeHead(SlotHandle::INVALID_INDEX)
+{
+}
+
+template <typename T>
+SlotHandle SlotMap<T>::insert(const T& value)
+{
+	uint32 slot;
+	if (m_freeHead != SlotHandle::INVALID_INDEX)
+	{
+		slot = m_freeHead;
+		m_freeHead = m_slots[slot].dense;
+	}
+	else
+	{
+		slot = m_slots.size();
+		Slot s;
+		s.generation = 0;
+		m_slots.push_back(s);
+	}
+
+	m_slots[slot].dense = m_data.size();
+	m_data.push_back(value);
+	m_dataSlots.push_back(slot);
+
+	return SlotHandle(slot, m_slots[slot].generation);
+}
+
+template <typename T>
+bool SlotMap<T>::remove(SlotHandle handle)
+{
+	if (!contains(handle))
+		return false;
+
+	Slot& s = m_slots[handle.index];
+	uint32 last = m_data.size() - 1;
+
+	// move the last element into the hole so the data stays packed
+	if (s.dense != last)
+	{
+		m_data[s.dense] = m_data[last];
+		m_dataSlots[s.dense] = m_dataSlots[last];
+		m_slots[m_dataSlots[s.dense]].dense = s.dense;
+	}
+
+	m_data.pop_back();
+	m_dataSlots.pop_back();
+
+	s.generation++;
+	s.dense = m_freeHead;
+	m_freeHead = handle.index;
+
+	return true;
+}
+
+template <typename T>
+void SlotMap<T>::clear()
+{
+	for (uint32 i = 0; i < m_dataSlots.size(); i++)
+	{
+		Slot& s = m_slots[m_dataSlots[i]];
+		s.generation++;
+		s.dense = m_freeHead;
+		m_freeHead = m_dataSlots[i];
+	}
+
+	m_data.clear();
+	m_dataSlots.clear();
+}
+
+template <typename T>
+void SlotMap<T>::reserve(uint32 count)
+{
+	m_data.reserve(count);
+	m_dataSlots.reserve(count);
+	m_slots.reserve(count);
+}
+
+template <typename T>
+bool SlotMap<T>::contains(SlotHandle handle) const
+{
+	if (handle.index >= m_slots.size())
+		return false;
+
+	const Slot& s = m_slots[handle.index];
+	return s.generation == handle.generation && s.dense < m_data.size() && m_dataSlots[s.dense] == handle.index;
+}
+
+template <typename T>
+T* SlotMap<T>::get(SlotHandle handle)
+{
+	return contains(handle) ? &m_data[m_slots[handle.index].dense] : 0;
+}
+
+template <typename T>
+const T* SlotMap<T>::get(SlotHandle handle) const
+{
+	return contains(handle) ? &m_data[m_slots[handle.index].dense] : 0;
+}
+
+template <typename T>
+SlotHandle SlotMap<T>::getHandle(uint32 denseIndex) const
+{
+	if (denseIndex >= m_data.size())
+		return SlotHandle();
+
+	uint32 slot = m_dataSlots[denseIndex];
+	return SlotHandle(slot, m_slots[slot].generation);
+}
+
+template <typename T>
+template <typename Compare>
+void SlotMap<T>::sort(Compare comp)
+{
+	std::vector<uint32> order(m_data.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32 a, uint32 b)->bool { return comp(m_data[a], m_data[b]); });
+
+	std::vector<T> data;
+	std::vector<uint32> dataSlots;
+	data.reserve(m_data.size());
+	dataSlots.reserve(m_dataSlots.size());
+	for (uint32 i = 0; i < order.size(); i++)
+	{
+		data.push_back(m_data[order[i]]);
+		dataSlots.push_back(m_dataSlots[order[i]]);
+		m_slots[dataSlots.back()].dense = i;
+	}
+
+	m_data.swap(data);
+	m_dataSlots.swap(dataSlots);
+}
+
+#endif
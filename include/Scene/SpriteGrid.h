@@ -0,0 +1,54 @@
+#ifndef _SPRITE_GRID_H_
+#define _SPRITE_GRID_H_
+
+#include "Utils.h"
+
+class SpriteRenderer;
+
+// uniform grid over the world bounds of sprites, used to find the sprites
+// inside camera views without visiting the off-screen ones
+class SpriteGrid
+{
+public:
+
+	static const float CELL_SIZE;
+
+	// inserts the sprite or moves it to the cells of its current bounds
+	static void update(SpriteRenderer* sprite);
+
+	static void remove(SpriteRenderer* sprite);
+
+	static void clear();
+
+	static uint32 getCount();
+
+	// starts a new set of queries, a sprite is reported once per set
+	static void beginQueries();
+
+	// appends active sprites intersecting rect whose game object order is within
+	// [firstOrder, lastOrder] and that were not reported yet in this set of queries,
+	// passBit is added to the pass mask of every such sprite
+	static void query(const sf::FloatRect& rect, uint32 firstOrder, uint32 lastOrder, uint32 passBit,
+		std::vector<SpriteRenderer*>& out);
+
+private:
+
+	typedef std::vector<SpriteRenderer*> Cell;
+
+	static uint64_t getCellKey(int32 x, int32 y);
+
+	static void getCellRange(const sf::FloatRect& rect, sf::IntRect& range);
+
+	static void insertToCells(SpriteRenderer* sprite, const sf::IntRect& range);
+	static void removeFromCells(SpriteRenderer* sprite, const sf::IntRect& range);
+
+private:
+
+	static std::unordered_map<uint64_t, Cell> s_cells;
+
+	static uint32 s_count;
+	static uint32 s_queryStamp;
+
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef _SYSTEM_H_
+#define _SYSTEM_H_
+
+#include <SFML/System/Time.hpp>
+
+#include "Utils.h"
+
+class Component;
+
+// one stage of the scene update, systems registered in Scene run every frame
+// by ascending order and walk the registry arrays of the component types they handle
+class System
+{
+public:
+
+	System(int32 order);
+
+	virtual ~System();
+
+	inline int32 getOrder() const { return m_order; }
+
+	// types handled here are skipped by the generic ComponentUpdateSystem
+	virtual bool handlesType(std::type_index type) const { return false; }
+
+	virtual void onUpdate(const sf::Time& dt) = 0;
+
+protected:
+
+	// components handed to one job when a system spreads its work over the job system
+	static const uint32 JOB_BATCH_SIZE = 64;
+
+	// active component owned by an active game object that is already in the scene
+	static bool isUpdated(Component* c);
+
+private:
+
+	int32 m_order;
+
+};
+
+#endif
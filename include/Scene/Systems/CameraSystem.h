@@ -0,0 +1,23 @@
+#ifndef _CAMERA_SYSTEM_H_
+#define _CAMERA_SYSTEM_H_
+
+#include "Scene/System.h"
+
+// moves camera views to the position of their game objects
+class CameraSystem : public System
+{
+public:
+
+	static const int32 ORDER = 400;
+
+	CameraSystem();
+
+	virtual ~CameraSystem();
+
+	virtual bool handlesType(std::type_index type) const;
+
+	virtual void onUpdate(const sf::Time& dt);
+
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef _COMPONENT_UPDATE_SYSTEM_H_
+#define _COMPONENT_UPDATE_SYSTEM_H_
+
+#include "Scene/System.h"
+
+// fallback for component types no other system handles, calls their
+// onUpdate and onTransform callbacks. onTransform gets the global transform
+// of the owner computed in the previous frame.
+class ComponentUpdateSystem : public System
+{
+public:
+
+	static const int32 ORDER = 200;
+
+	ComponentUpdateSystem();
+
+	virtual ~ComponentUpdateSystem();
+
+	virtual void onUpdate(const sf::Time& dt);
+
+};
+
+#endif
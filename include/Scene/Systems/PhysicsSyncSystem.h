@@ -0,0 +1,23 @@
+#ifndef _PHYSICS_SYNC_SYSTEM_H_
+#define _PHYSICS_SYNC_SYSTEM_H_
+
+#include "Scene/System.h"
+
+// copies simulated body positions into the Transform components
+class PhysicsSyncSystem : public System
+{
+public:
+
+	static const int32 ORDER = 100;
+
+	PhysicsSyncSystem();
+
+	virtual ~PhysicsSyncSystem();
+
+	virtual bool handlesType(std::type_index type) const;
+
+	virtual void onUpdate(const sf::Time& dt);
+
+};
+
+#endif
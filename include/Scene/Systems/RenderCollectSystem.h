@@ -0,0 +1,41 @@
+#ifndef _RENDER_COLLECT_SYSTEM_H_
+#define _RENDER_COLLECT_SYSTEM_H_
+
+#include "Scene/System.h"
+
+// rebuilds the world quads of moved sprites and keeps their bounds in SpriteGrid
+class RenderCollectSystem : public System
+{
+public:
+
+	static const int32 ORDER = 500;
+
+	RenderCollectSystem();
+
+	virtual ~RenderCollectSystem();
+
+	virtual bool handlesType(std::type_index type) const;
+
+	virtual void onUpdate(const sf::Time& dt);
+
+	// active sprites of enabled game objects seen by the last update, the ones
+	// that can be culled by the views
+	static inline uint32 getActiveCount() { return s_activeCount; }
+
+private:
+
+	// state of a sprite after its update, 0 for sprites that are not updated
+	enum SpriteState
+	{
+		UPDATED = 1,
+		MOVED = 2
+	};
+
+	// sprite states written by the jobs at the index of the sprite
+	std::vector<uint8> m_moved;
+
+	static uint32 s_activeCount;
+
+};
+
+#endif
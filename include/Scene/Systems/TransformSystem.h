@@ -0,0 +1,122 @@
+#ifndef _TRANSFORM_SYSTEM_H_
+#define _TRANSFORM_SYSTEM_H_
+
+#include "Scene/System.h"
+
+#include <SFML/Graphics/Transform.hpp>
+
+#include <mutex>
+#include <unordered_set>
+
+class GameObject;
+class Transform;
+
+// computes global transforms of all Transform components. The hierarchy is
+// kept flattened in levels with parent indices into the previous level, so
+// every level only depends on the previous ones and is computed in one linear
+// pass. Dirty nodes of a level are composed four at a time and spread over jobs.
+// Objects whose transforms were added, removed or moved to another parent are
+// spliced out and back in before the next update, the rest of the levels stays.
+class TransformSystem : public System
+{
+public:
+
+	static const int32 ORDER = 300;
+
+	// nodes handed to one job, multiple of the batch width
+	static const uint32 NODES_PER_JOB = 256;
+
+	TransformSystem();
+
+	virtual ~TransformSystem();
+
+	virtual bool handlesType(std::type_index type) const;
+
+	virtual void onUpdate(const sf::Time& dt);
+
+	// the transforms of the object and its descendants are spliced into the levels
+	// again before the next update, call when the object enters the scene, gets
+	// activated or deactivated, or a Transform of it is added or (de)activated
+	static void invalidateHierarchy(GameObject* obj);
+
+	// takes the transform out of the levels right away, called when it is detached or deleted
+	static void releaseTransform(Transform* trans);
+
+	// drops the pending invalidation of an object being deleted
+	static void dequeue(GameObject* obj);
+
+	// nearest active Transform on the object or its ancestors
+	static Transform* findTransform(GameObject* obj);
+
+	static const sf::Transform& getGlobalTransform(GameObject* obj);
+
+private:
+
+	// 2D affine matrix [a c tx; b d ty]
+	struct Affine
+	{
+		float a, b, c, d, tx, ty;
+	};
+
+	// four matrices with every component in its own lane
+	struct alignas(16) AffineBatch
+	{
+		float a[4], b[4], c[4], d[4], tx[4], ty[4];
+	};
+
+	static const uint32 BATCH_WIDTH = 4;
+
+	struct Level
+	{
+		Level() :
+			holes(false)
+		{}
+
+		// released nodes stay null until the level is compacted
+		std::vector<Transform*> nodes;
+		// index of the parent node in the previous level, -1 for roots
+		std::vector<int32> parents;
+		std::vector<Affine> world;
+		std::vector<uint8> changed;
+		bool holes;
+	};
+
+	// applies released transforms and invalidated objects to the levels
+	void updateHierarchy();
+
+	void removeSubtree(GameObject* obj);
+
+	// parentLevel is -1 for objects without a transformed ancestor
+	void insertSubtree(GameObject* obj, int32 parentLevel, int32 parentIndex);
+
+	// removes released nodes and fixes the parent indices of the next level
+	void compactLevel(uint32 level);
+
+	void updateNodes(const Level* parentLevel, Level& level, uint32 begin, uint32 end);
+
+	static void multiply(const AffineBatch& parent, const AffineBatch& local, AffineBatch& out);
+
+private:
+
+	// objects to splice in again, in the order they were invalidated, the set tells
+	// which ones are still pending since deleted objects are only removed from it
+	static std::vector<GameObject*> s_invalidated;
+	static std::unordered_set<GameObject*> s_pending;
+
+	// level and index of released nodes, cleared before the transforms are touched
+	static std::vector<std::pair<uint32, uint32> > s_released;
+
+	static std::mutex s_mutex;
+
+	// parents always are in the level before their children
+	std::vector<Level> m_levels;
+
+	// dirty nodes of the level being updated
+	std::vector<uint32> m_dirty;
+
+	// new index of every node of the level being compacted, -1 for released ones
+	std::vector<int32> m_remap;
+
+};
+
+#endif
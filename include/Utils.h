@@ -13,13 +13,18 @@
 #include <sstream>
 #include <vector>
 #include <list>
+#include <deque>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <set>
 #include <stack>
 #include <stdexcept>
 #include <typeindex>
 #include <typeinfo>
 #include <memory>
+#include <functional>
+#include <algorithm>
 #include <numeric>
 #include <complex>
 #include <iterator>
@@ -49,6 +54,7 @@
 #define PTR_TYPEID(ptr) typeid(*ptr)
 
 extern bool SCENE_DEBUG;
+extern bool JOBS_DEBUG;
 
 //! Typedefs for integer types
 typedef int32_t int32;
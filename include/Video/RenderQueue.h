@@ -0,0 +1,112 @@
+#ifndef _RENDER_QUEUE_H_
+#define _RENDER_QUEUE_H_
+
+#include "Utils.h"
+
+#include <SFML/Graphics.hpp>
+
+class Material;
+
+// command buffer of the frame. Every submitted sprite gets one slot with its
+// world space quad and one command per pass, ordered by a 64 bit key
+//
+//   | pass 4 | layer 12 | order 16 | depth 12 | material 20 |
+//
+// Keys are radix sorted, then adjacent commands sharing texture, shader,
+// blend mode and material are merged into one draw call. Slots are written
+// independently, so submission can run from several jobs.
+class RenderQueue
+{
+public:
+
+	// pass 15 is left out so no valid key equals INVALID_KEY
+	static const uint32 MAX_PASSES = 15;
+
+	struct Pass
+	{
+		sf::RenderTarget* target;
+		// displayed after the pass was drawn
+		sf::RenderTexture* texture;
+		sf::View view;
+	};
+
+	struct Stats
+	{
+		// sprites submitted to at least one pass
+		uint32 sprites;
+		// commands drawn over all passes, one per sprite and pass
+		uint32 commands;
+		uint32 culled;
+		uint32 drawCalls;
+	};
+
+	// clears the previous frame and allocates slots for the sprites of this one,
+	// passes are drawn in the order they were added and have to be added before submitting
+	static void begin(uint32 slotCount);
+
+	static bool addPass(const Pass& pass);
+
+	static uint32 getPassCount();
+
+	// quad holds four vertices in world space, clockwise from the top left corner,
+	// commands are added for the passes set in passMask.
+	// Material is applied to the shader before drawing.
+	static void submit(uint32 slot, const sf::Vertex* quad, const sf::RenderStates& states,
+		int32 layer, uint32 order, uint32 depth, uint32 passMask, Material* material = 0, bool materialValidation = false);
+
+	// sprites skipped by view culling, reported in the stats
+	static void setCulledCount(uint32 count);
+
+	// sorts the commands and draws the passes, onPass is called after the commands of every pass
+	static void render(const std::function<void(sf::RenderTarget*)>& onPass = std::function<void(sf::RenderTarget*)>());
+
+	static const Stats& getStats();
+
+private:
+
+	struct Item
+	{
+		const sf::Shader* shader;
+		const sf::Texture* texture;
+		sf::BlendMode blendMode;
+		Material* material;
+		bool materialValidation;
+	};
+
+	struct Command
+	{
+		uint64_t key;
+		uint32 slot;
+	};
+
+	static const uint64_t INVALID_KEY = ~uint64_t(0);
+
+	static uint64_t makeKey(uint32 pass, int32 layer, uint32 order, uint32 depth, uint32 material);
+
+	static uint32 getPass(uint64_t key);
+
+	static void sortCommands();
+
+	static bool canMerge(const Item& a, const Item& b);
+
+	static void drawBatch(sf::RenderTarget* target, const Item& item, uint32 first, uint32 count);
+
+private:
+
+	static std::vector<Pass> s_passes;
+
+	static std::vector<Item> s_items;
+	static std::vector<sf::Vertex> s_quads;
+
+	// one command per slot and pass, unused slots keep INVALID_KEY
+	static std::vector<Command> s_commands;
+	static std::vector<Command> s_sortBuffer;
+
+	// vertices in command order, the storage is kept between frames
+	static std::vector<sf::Vertex> s_vertices;
+
+	static Stats s_stats;
+
+};
+
+#endif
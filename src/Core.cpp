@@ -2,6 +2,7 @@
 
 #include "Filesystem/Assets/AssetManager.h"
 #include "Physics/PhysicsManager.h"
+#include "Jobs/JobSystem.h"
 #include "Scene/Scene.h"
 
 #include <SFML/Window.hpp>
@@ -15,6 +16,8 @@ bool Core::init()
 	// it just creates default texture as null image
 	AssetManager::init();
 
+	JobSystem::init(Configuration::Jobs::Workers, Configuration::Jobs::Deterministic);
+
 	PhysicsManager::init();
 
 	VideoManager::init();
@@ -40,6 +43,8 @@ void Core::shutdown()
 
 	AssetManager::shutdown();
 
+	JobSystem::shutdown();
+
 	s_initialised = false;
 }
 
@@ -1,4 +1,5 @@
 #include "Filesystem/Assets/AssetManager.h"
+#include "Filesystem/Configuration.h"
 
 std::map<std::string, sf::Image*> AssetManager::s_images;
 std::map<std::string, sf::Texture*> AssetManager::s_textures;
@@ -19,13 +20,22 @@ std::map<std::string, std::vector<std::string>> AssetManager::s_shadersUniforms;
 
 sf::Texture* AssetManager::s_defaultTexture = new sf::Texture();
 
+TextureAtlas* AssetManager::s_atlas = 0;
+
 void AssetManager::init()
 {
 	s_defaultTexture->create(1, 1);
+
+	s_atlas = new TextureAtlas(Configuration::Atlas::PageSize, Configuration::Atlas::Padding, Configuration::Atlas::Bleed);
+
+	// images of a baked atlas are found by loadTextureRegion without loading them again
+	if (!Configuration::Atlas::File.empty() && !loadAtlas(Configuration::Atlas::File))
+		PRINT_WARNING << "Failed to load texture atlas " << Configuration::Atlas::File << std::endl;
 }
 
 void AssetManager::shutdown()
 {
+	DELETE_OBJECT(s_atlas)
 	DELETE_OBJECT(s_defaultTexture)
 }
 
@@ -227,6 +237,46 @@ sf::Music* AssetManager::loadMusic(const std::string& id, const std::string& pat
 	return m;
 }
 
+bool AssetManager::loadTextureRegion(const std::string& id, const std::string& path, TextureRegion& region)
+{
+	if (getTextureRegion(id, region))
+		return true;
+
+	if (s_atlas)
+	{
+		sf::Image image;
+		if (!image.loadFromFile(path))
+			return false;
+
+		sf::Vector2u size = image.getSize();
+		uint32 maxSize = Configuration::Atlas::MaxImageSize;
+		if (size.x <= maxSize && size.y <= maxSize && s_atlas->add(id, image, region))
+		{
+			s_metaTextures[id] = path;
+			return true;
+		}
+	}
+
+	sf::Texture* t = loadTexture(id, path);
+	if (!t)
+		return false;
+
+	sf::Vector2u size = t->getSize();
+	region = TextureRegion(t, sf::IntRect(0, 0, size.x, size.y));
+
+	return true;
+}
+
+bool AssetManager::loadAtlas(const std::string& path)
+{
+	return s_atlas && s_atlas->loadFromFile(path);
+}
+
+bool AssetManager::saveAtlas(const std::string& path)
+{
+	return s_atlas && s_atlas->saveToFile(path);
+}
+
 sf::Image* AssetManager::getImage(const std::string& id)
 {
 	return s_images.count(id) ? s_images[id] : 0;
@@ -234,7 +284,7 @@ sf::Image* AssetManager::getImage(const std::string& id)
 
 sf::Texture* AssetManager::getTexture(const std::string& id)
 {
-	return s_images.count(id) ? s_textures[id] : 0;
+	return s_textures.count(id) ? s_textures[id] : 0;
 }
 
 sf::Font* AssetManager::getFont(const std::string& id)
@@ -257,6 +307,26 @@ sf::Music* AssetManager::getMusic(const std::string& id)
 	return s_musics.count(id) ? s_musics[id] : 0;
 }
 
+bool AssetManager::getTextureRegion(const std::string& id, TextureRegion& region)
+{
+	if (s_atlas && s_atlas->find(id, region))
+		return true;
+
+	sf::Texture* t = getTexture(id);
+	if (!t)
+		return false;
+
+	sf::Vector2u size = t->getSize();
+	region = TextureRegion(t, sf::IntRect(0, 0, size.x, size.y));
+
+	return true;
+}
+
+std::string AssetManager::getTexturePath(const std::string& id)
+{
+	return s_metaTextures.count(id) ? s_metaTextures[id] : "";
+}
+
 std::vector<std::string>* AssetManager::getShaderUniforms(const std::string& id)
 {
 	return s_shadersUniforms.count(id) ? &s_shadersUniforms[id] : 0;
@@ -334,6 +404,14 @@ std::string AssetManager::findMusic(const sf::Music* ptr)
 	return "";
 }
 
+std::string AssetManager::findTextureRegion(const TextureRegion& region)
+{
+	if (s_atlas && s_atlas->contains(region.texture))
+		return s_atlas->find(region.texture, region.rect);
+
+	return findTexture(region.texture);
+}
+
 void AssetManager::releaseImage(const std::string& id)
 {
 	if (s_images.count(id))
@@ -401,6 +479,9 @@ void AssetManager::releaseAllTextures()
 	}
 
 	s_textures.clear();
+
+	if (s_atlas)
+		s_atlas->clear();
 }
 
 void AssetManager::releaseAllFonts()
@@ -0,0 +1,353 @@
+#include "Filesystem/Assets/TextureAtlas.h"
+
+#include <Filesystem/Xml/pugixml.h>
+
+#include <boost/filesystem.hpp>
+
+SkylinePacker::SkylinePacker() :
+	m_width(0),
+	m_height(0)
+{
+}
+
+void SkylinePacker::init(uint32 width, uint32 height)
+{
+	m_width = width;
+	m_height = height;
+
+	Node n = { 0, 0, width };
+	m_nodes.clear();
+	m_nodes.push_back(n);
+}
+
+bool SkylinePacker::insert(uint32 width, uint32 height, sf::Vector2u& pos)
+{
+	int32 bestIndex = -1;
+	uint32 bestTop = 0xffffffff;
+	uint32 bestWidth = 0xffffffff;
+
+	for (uint32 i = 0; i < m_nodes.size(); i++)
+	{
+		int32 y = fit(i, width, height);
+		if (y < 0)
+			continue;
+
+		// lowest top edge first, narrowest skyline segment on ties
+		uint32 top = y + height;
+		if (top < bestTop || (top == bestTop && m_nodes[i].width < bestWidth))
+		{
+			bestIndex = i;
+			bestTop = top;
+			bestWidth = m_nodes[i].width;
+			pos.x = m_nodes[i].x;
+			pos.y = y;
+		}
+	}
+
+	if (bestIndex < 0)
+		return false;
+
+	addLevel(bestIndex, pos.x, pos.y, width, height);
+	return true;
+}
+
+int32 SkylinePacker::fit(uint32 index, uint32 width, uint32 height) const
+{
+	if (m_nodes[index].x + width > m_width)
+		return -1;
+
+	uint32 y = 0;
+	int32 widthLeft = width;
+	for (uint32 i = index; widthLeft > 0 && i < m_nodes.size(); i++)
+	{
+		y = std::max(y, m_nodes[i].y);
+		if (y + height > m_height)
+			return -1;
+
+		widthLeft -= m_nodes[i].width;
+	}
+
+	return y;
+}
+
+void SkylinePacker::addLevel(uint32 index, uint32 x, uint32 y, uint32 width, uint32 height)
+{
+	Node n = { x, y + height, width };
+	m_nodes.insert(m_nodes.begin() + index, n);
+
+	// cut the segments now covered by the new one
+	for (uint32 i = index + 1; i < m_nodes.size(); i++)
+	{
+		Node& prev = m_nodes[i - 1];
+		Node& cur = m_nodes[i];
+		if (cur.x >= prev.x + prev.width)
+			break;
+
+		uint32 shrink = prev.x + prev.width - cur.x;
+		if (cur.width <= shrink)
+		{
+			m_nodes.erase(m_nodes.begin() + i);
+			i--;
+			continue;
+		}
+
+		cur.x += shrink;
+		cur.width -= shrink;
+		break;
+	}
+
+	// merge neighbours of the same height
+	for (uint32 i = 0; i + 1 < m_nodes.size(); i++)
+	{
+		if (m_nodes[i].y == m_nodes[i + 1].y)
+		{
+			m_nodes[i].width += m_nodes[i + 1].width;
+			m_nodes.erase(m_nodes.begin() + i + 1);
+			i--;
+		}
+	}
+}
+
+TextureAtlas::TextureAtlas(uint32 pageSize, uint32 padding, uint32 bleed) :
+	m_pageSize(pageSize),
+	m_padding(padding),
+	m_bleed(bleed)
+{
+	// pages can not be bigger than the hardware allows
+	m_pageSize = std::min(m_pageSize, sf::Texture::getMaximumSize());
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	clear();
+}
+
+bool TextureAtlas::add(const std::string& id, const sf::Image& image, TextureRegion& region)
+{
+	if (find(id, region))
+		return true;
+
+	sf::Vector2u size = image.getSize();
+	uint32 width = size.x + 2 * m_bleed + m_padding;
+	uint32 height = size.y + 2 * m_bleed + m_padding;
+	if (size.x == 0 || size.y == 0 || width > m_pageSize || height > m_pageSize)
+		return false;
+
+	// try the newest page first, older ones are mostly full
+	Page* page = 0;
+	uint32 pageIndex = 0;
+	sf::Vector2u pos;
+	for (uint32 i = m_pages.size(); i > 0; i--)
+	{
+		if (m_pages[i - 1]->packer.insert(width, height, pos))
+		{
+			pageIndex = i - 1;
+			page = m_pages[pageIndex];
+			break;
+		}
+	}
+
+	if (!page)
+	{
+		page = addPage();
+		if (!page || !page->packer.insert(width, height, pos))
+			return false;
+
+		pageIndex = m_pages.size() - 1;
+	}
+
+	sf::Image bled;
+	makeBleed(image, bled);
+	page->image.copy(bled, pos.x, pos.y);
+	page->texture->update(bled, pos.x, pos.y);
+
+	Entry e;
+	e.page = pageIndex;
+	e.rect = sf::IntRect(pos.x + m_bleed, pos.y + m_bleed, size.x, size.y);
+	m_entries[id] = e;
+
+	region = TextureRegion(page->texture, e.rect);
+
+	return true;
+}
+
+bool TextureAtlas::find(const std::string& id, TextureRegion& region) const
+{
+	std::map<std::string, Entry>::const_iterator it = m_entries.find(id);
+	if (it == m_entries.end())
+		return false;
+
+	region = TextureRegion(m_pages[it->second.page]->texture, it->second.rect);
+	return true;
+}
+
+std::string TextureAtlas::find(const sf::Texture* texture, const sf::IntRect& rect) const
+{
+	for (std::map<std::string, Entry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+		if (m_pages[it->second.page]->texture == texture && it->second.rect == rect)
+			return it->first;
+
+	return "";
+}
+
+bool TextureAtlas::contains(const sf::Texture* texture) const
+{
+	for (std::vector<Page*>::const_iterator it = m_pages.begin(); it != m_pages.end(); ++it)
+		if ((*it)->texture == texture)
+			return true;
+
+	return false;
+}
+
+bool TextureAtlas::saveToFile(const std::string& path) const
+{
+	boost::filesystem::path p(path.c_str());
+	std::string stem = p.stem().string();
+
+	pugi::xml_document doc;
+	pugi::xml_node atlasNode = doc.append_child("atlas");
+	atlasNode.append_attribute("pagesize") = m_pageSize;
+	atlasNode.append_attribute("padding") = m_padding;
+	atlasNode.append_attribute("bleed") = m_bleed;
+
+	for (uint32 i = 0; i < m_pages.size(); i++)
+	{
+		std::string file = stem + "_" + std::to_string(i) + ".png";
+		boost::filesystem::path pagePath = p.parent_path() / file;
+		if (!m_pages[i]->image.saveToFile(pagePath.string()))
+		{
+			PRINT_ERROR << "Failed to save atlas page " << pagePath.string() << std::endl;
+			return false;
+		}
+
+		atlasNode.append_child("page").append_attribute("source") = file.c_str();
+	}
+
+	for (std::map<std::string, Entry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+	{
+		pugi::xml_node entryNode = atlasNode.append_child("entry");
+		entryNode.append_attribute("id") = it->first.c_str();
+		entryNode.append_attribute("page") = it->second.page;
+		entryNode.append_attribute("x") = it->second.rect.left;
+		entryNode.append_attribute("y") = it->second.rect.top;
+		entryNode.append_attribute("width") = it->second.rect.width;
+		entryNode.append_attribute("height") = it->second.rect.height;
+	}
+
+	return doc.save_file(path.c_str());
+}
+
+bool TextureAtlas::loadFromFile(const std::string& path)
+{
+	pugi::xml_document doc;
+	pugi::xml_parse_result result = doc.load_file(path.c_str());
+	if (!result)
+	{
+		PRINT_ERROR << "Failed to open atlas " << path << std::endl;
+		PRINT_ERROR << "Reason: " << result.description() << std::endl;
+		return false;
+	}
+
+	pugi::xml_node atlasNode = doc.child("atlas");
+	if (!atlasNode)
+	{
+		PRINT_ERROR << "Atlas node not found. Atlas " << path << " not loaded." << std::endl;
+		return false;
+	}
+
+	boost::filesystem::path dir = boost::filesystem::path(path.c_str()).parent_path();
+	uint32 firstPage = m_pages.size();
+	for (pugi::xml_node pageNode = atlasNode.child("page"); pageNode; pageNode = pageNode.next_sibling("page"))
+	{
+		Page* page = new Page();
+		std::string source = (dir / pageNode.attribute("source").as_string()).string();
+		if (!page->image.loadFromFile(source))
+		{
+			PRINT_ERROR << "Failed to load atlas page " << source << std::endl;
+			DELETE_OBJECT(page);
+			return false;
+		}
+
+		page->texture = new sf::Texture();
+		page->texture->loadFromImage(page->image);
+
+		// baked pages are full, new images go to new pages
+		sf::Vector2u size = page->image.getSize();
+		page->packer.init(size.x, 0);
+
+		m_pages.push_back(page);
+	}
+
+	for (pugi::xml_node entryNode = atlasNode.child("entry"); entryNode; entryNode = entryNode.next_sibling("entry"))
+	{
+		Entry e;
+		e.page = firstPage + entryNode.attribute("page").as_uint();
+		e.rect = sf::IntRect(entryNode.attribute("x").as_int(), entryNode.attribute("y").as_int(),
+			entryNode.attribute("width").as_int(), entryNode.attribute("height").as_int());
+
+		if (e.page >= m_pages.size())
+		{
+			PRINT_WARNING << "atlas entry " << entryNode.attribute("id").as_string() << " has invalid page" << std::endl;
+			continue;
+		}
+
+		m_entries[entryNode.attribute("id").as_string()] = e;
+	}
+
+	return true;
+}
+
+void TextureAtlas::clear()
+{
+	for (std::vector<Page*>::iterator it = m_pages.begin(); it != m_pages.end(); ++it)
+	{
+		DELETE_OBJECT((*it)->texture);
+		DELETE_OBJECT(*it);
+	}
+
+	m_pages.clear();
+	m_entries.clear();
+}
+
+TextureAtlas::Page* TextureAtlas::addPage()
+{
+	Page* page = new Page();
+	page->image.create(m_pageSize, m_pageSize, sf::Color::Transparent);
+	page->texture = new sf::Texture();
+	if (!page->texture->loadFromImage(page->image))
+	{
+		PRINT_ERROR << "Failed to create atlas page of size " << m_pageSize << std::endl;
+		DELETE_OBJECT(page->texture);
+		DELETE_OBJECT(page);
+		return 0;
+	}
+
+	page->packer.init(m_pageSize, m_pageSize);
+	m_pages.push_back(page);
+
+	return page;
+}
+
+void TextureAtlas::makeBleed(const sf::Image& image, sf::Image& out) const
+{
+	sf::Vector2u size = image.getSize();
+	out.create(size.x + 2 * m_bleed, size.y + 2 * m_bleed, sf::Color::Transparent);
+	out.copy(image, m_bleed, m_bleed);
+
+	if (m_bleed == 0)
+		return;
+
+	// border pixels take the colour of the nearest edge pixel
+	for (uint32 y = 0; y < size.y + 2 * m_bleed; y++)
+	{
+		uint32 sy = std::min(std::max(y, m_bleed) - m_bleed, size.y - 1);
+		for (uint32 x = 0; x < size.x + 2 * m_bleed; x++)
+		{
+			if (x >= m_bleed && x < size.x + m_bleed && y >= m_bleed && y < size.y + m_bleed)
+				continue;
+
+			uint32 sx = std::min(std::max(x, m_bleed) - m_bleed, size.x - 1);
+			out.setPixel(x, y, image.getPixel(sx, sy));
+		}
+	}
+}
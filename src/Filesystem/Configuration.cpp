@@ -11,6 +11,15 @@ int Configuration::Video::Antialiasing;
 int Configuration::Video::DepthBuffer;
 int Configuration::Video::StencilBuffer;
 
+int Configuration::Jobs::Workers;
+bool Configuration::Jobs::Deterministic;
+
+int Configuration::Atlas::PageSize;
+int Configuration::Atlas::MaxImageSize;
+int Configuration::Atlas::Padding;
+int Configuration::Atlas::Bleed;
+std::string Configuration::Atlas::File;
+
 void Configuration::parseConfig(ConfigFile* cfg)
 {
 	General::Colors = cfg->getInt("General.Colors", 32);
@@ -22,6 +31,19 @@ void Configuration::parseConfig(ConfigFile* cfg)
 	Video::Antialiasing = cfg->getInt("Video.Antialiasing", 8);
 	Video::DepthBuffer = cfg->getInt("Video.DepthBuffer", 32);
 	Video::StencilBuffer = cfg->getInt("Video.StencilBuffer", 32);
+
+	// -1 starts one worker per core besides the main thread
+	Jobs::Workers = cfg->getInt("Jobs.Workers", -1);
+	Jobs::Deterministic = cfg->getBoolean("Jobs.Deterministic", 0);
+
+	// images bigger than MaxImageSize in any dimension get their own texture
+	Atlas::PageSize = cfg->getInt("Atlas.PageSize", 1024);
+	Atlas::MaxImageSize = cfg->getInt("Atlas.MaxImageSize", 256);
+	Atlas::Padding = cfg->getInt("Atlas.Padding", 2);
+	Atlas::Bleed = cfg->getInt("Atlas.Bleed", 1);
+
+	// atlas baked by AtlasBaker, loaded at startup when set
+	Atlas::File = cfg->getString("Atlas.File", "");
 }
 
 void Configuration::applyConfig()
@@ -0,0 +1,260 @@
+#include "Jobs/JobSystem.h"
+
+bool JOBS_DEBUG = true;
+
+std::vector<std::thread*> JobSystem::s_threads;
+std::vector<JobSystem::WorkQueue*> JobSystem::s_queues;
+
+std::atomic<int32> JobSystem::s_queuedJobs(0);
+std::atomic<bool> JobSystem::s_quit(false);
+
+std::mutex JobSystem::s_sleepMutex;
+std::condition_variable JobSystem::s_sleepCondition;
+
+bool JobSystem::s_deterministic = false;
+
+thread_local uint32 JobSystem::t_workerIndex = 0;
+
+Job::Job(const Function& function, const Ptr& parent) :
+	m_function(function),
+	m_parent(parent),
+	m_unfinished(1),
+	m_waiting(1),
+	m_finished(false)
+{
+}
+
+void JobSystem::WorkQueue::push(const Job::Ptr& job)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_jobs.push_back(job);
+}
+
+bool JobSystem::WorkQueue::pop(Job::Ptr& job)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_jobs.empty())
+		return false;
+
+	job = m_jobs.back();
+	m_jobs.pop_back();
+	return true;
+}
+
+bool JobSystem::WorkQueue::steal(Job::Ptr& job)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_jobs.empty())
+		return false;
+
+	job = m_jobs.front();
+	m_jobs.pop_front();
+	return true;
+}
+
+bool JobSystem::init(int32 workerCount, bool deterministic)
+{
+	if (!s_queues.empty())
+		return false;
+
+	if (workerCount < 0)
+		workerCount = std::max((int32)(std::thread::hardware_concurrency()) - 1, 0);
+
+	s_deterministic = deterministic;
+	s_quit = false;
+	s_queuedJobs = 0;
+
+	// queue 0 belongs to the main thread
+	for (int32 i = 0; i <= workerCount; i++)
+		s_queues.push_back(new WorkQueue());
+
+	t_workerIndex = 0;
+	for (int32 i = 1; i <= workerCount; i++)
+		s_threads.push_back(new std::thread(&JobSystem::workerLoop, (uint32)(i)));
+
+	IF_PRINT_DEBUG(JOBS_DEBUG) << "job system started with " << workerCount << " worker threads" << std::endl;
+
+	return true;
+}
+
+void JobSystem::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(s_sleepMutex);
+		s_quit = true;
+	}
+	s_sleepCondition.notify_all();
+
+	std::thread* thread;
+	for (std::vector<std::thread*>::iterator it = s_threads.begin(); it != s_threads.end(); ++it)
+	{
+		thread = *it;
+		thread->join();
+		DELETE_OBJECT(thread);
+	}
+
+	s_threads.clear();
+
+	WorkQueue* queue;
+	for (std::vector<WorkQueue*>::iterator it = s_queues.begin(); it != s_queues.end(); ++it)
+	{
+		queue = *it;
+		DELETE_OBJECT(queue);
+	}
+
+	s_queues.clear();
+	s_queuedJobs = 0;
+}
+
+uint32 JobSystem::getWorkerCount()
+{
+	return s_threads.size();
+}
+
+bool JobSystem::isDeterministic()
+{
+	return s_deterministic;
+}
+
+void JobSystem::setDeterministic(bool flag)
+{
+	s_deterministic = flag;
+}
+
+Job::Ptr JobSystem::createJob(const Job::Function& function, const Job::Ptr& parent)
+{
+	if (parent)
+		parent->m_unfinished++;
+
+	return std::make_shared<Job>(function, parent);
+}
+
+void JobSystem::addDependency(const Job::Ptr& job, const Job::Ptr& dependency)
+{
+	if (!job || !dependency || job == dependency)
+		return;
+
+	std::lock_guard<std::mutex> lock(dependency->m_mutex);
+	if (dependency->m_finished)
+		return;
+
+	job->m_waiting++;
+	dependency->m_continuations.push_back(job);
+}
+
+void JobSystem::run(const Job::Ptr& job)
+{
+	if (job && --job->m_waiting == 0)
+		schedule(job);
+}
+
+void JobSystem::wait(const Job::Ptr& job)
+{
+	if (!job)
+		return;
+
+	// help with the work instead of blocking the thread
+	Job::Ptr next;
+	while (!job->isFinished())
+	{
+		if (findJob(next))
+		{
+			execute(next);
+			next.reset();
+		}
+		else
+			std::this_thread::yield();
+	}
+}
+
+bool JobSystem::isInline()
+{
+	return s_deterministic || s_threads.empty();
+}
+
+void JobSystem::workerLoop(uint32 index)
+{
+	t_workerIndex = index;
+
+	Job::Ptr job;
+	while (!s_quit)
+	{
+		if (findJob(job))
+		{
+			execute(job);
+			job.reset();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(s_sleepMutex);
+		s_sleepCondition.wait(lock, []()->bool { return s_queuedJobs.load() > 0 || s_quit.load(); });
+	}
+}
+
+void JobSystem::schedule(const Job::Ptr& job)
+{
+	if (isInline())
+	{
+		execute(job);
+		return;
+	}
+
+	s_queues[t_workerIndex < s_queues.size() ? t_workerIndex : 0]->push(job);
+	s_queuedJobs++;
+
+	// taking the lock makes sure a worker checking the counter is either before the check or already sleeping
+	{
+		std::lock_guard<std::mutex> lock(s_sleepMutex);
+	}
+	s_sleepCondition.notify_one();
+}
+
+void JobSystem::execute(const Job::Ptr& job)
+{
+	if (job->m_function)
+		job->m_function();
+
+	finish(job);
+}
+
+void JobSystem::finish(const Job::Ptr& job)
+{
+	if (--job->m_unfinished != 0)
+		return;
+
+	std::vector<Job::Ptr> continuations;
+	{
+		std::lock_guard<std::mutex> lock(job->m_mutex);
+		job->m_finished = true;
+		continuations.swap(job->m_continuations);
+	}
+
+	for (std::vector<Job::Ptr>::iterator it = continuations.begin(); it != continuations.end(); ++it)
+		run(*it);
+
+	if (job->m_parent)
+	{
+		Job::Ptr parent = job->m_parent;
+		job->m_parent.reset();
+		finish(parent);
+	}
+}
+
+bool JobSystem::findJob(Job::Ptr& job)
+{
+	if (s_queues.empty())
+		return false;
+
+	uint32 count = s_queues.size();
+	uint32 index = t_workerIndex < count ? t_workerIndex : 0;
+
+	// own queue first, then steal the oldest job from the others
+	bool found = s_queues[index]->pop(job);
+	for (uint32 i = 1; i < count && !found; i++)
+		found = s_queues[(index + i) % count]->steal(job);
+
+	if (found)
+		s_queuedJobs--;
+
+	return found;
+}
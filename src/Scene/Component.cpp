@@ -1,10 +1,14 @@
 #include "Scene/Component.h"
 #include "Scene/GameObject.h"
+#include "Scene/Systems/TransformSystem.h"
+#include "Scene/Components/Transform.h"
 #include "Core.h"
 
 Component::Component() :
 	m_active(true),
-	m_owner(0)
+	m_owner(0),
+	m_typeId(0),
+	m_registryIndex(ComponentRegistry::INVALID_INDEX)
 	//Active(this, &Component::setActive, &Component::isActive),
 	//Owner(this, 0, &Component::getOwner)
 {
@@ -23,7 +27,14 @@ bool Component::isActive()
 
 void Component::setActive(bool active)
 {
+	if (m_active == active)
+		return;
+
 	m_active = active;
+
+	// inactive transforms are left out of the transform hierarchy
+	if (m_owner && getType() == typeid(Transform))
+		TransformSystem::invalidateHierarchy(m_owner);
 }
 
 GameObject* Component::getOwner()
@@ -0,0 +1,62 @@
+#include "Scene/ComponentPool.h"
+
+#include <algorithm>
+#include <cstddef>
+
+PoolAllocator::PoolAllocator(std::size_t objectSize, uint32 objectsPerChunk) :
+	m_objectsPerChunk(objectsPerChunk ? objectsPerChunk : 1),
+	m_freeList(0),
+	m_count(0)
+{
+	// every slot has to hold the free list link and keep the objects aligned
+	const std::size_t align = alignof(std::max_align_t);
+	m_objectSize = std::max(objectSize, sizeof(void*));
+	m_objectSize = (m_objectSize + align - 1) / align * align;
+}
+
+PoolAllocator::~PoolAllocator()
+{
+	if (m_count != 0)
+		PRINT_WARNING << m_count << " pooled objects still alive on shutdown" << std::endl;
+
+	for (std::vector<uint8*>::iterator it = m_chunks.begin(); it != m_chunks.end(); ++it)
+		::operator delete(*it);
+
+	m_chunks.clear();
+}
+
+void* PoolAllocator::allocate()
+{
+	if (!m_freeList)
+		addChunk();
+
+	void* ptr = m_freeList;
+	m_freeList = *static_cast<void**>(ptr);
+	m_count++;
+
+	return ptr;
+}
+
+void PoolAllocator::deallocate(void* ptr)
+{
+	if (!ptr)
+		return;
+
+	*static_cast<void**>(ptr) = m_freeList;
+	m_freeList = ptr;
+	m_count--;
+}
+
+void PoolAllocator::addChunk()
+{
+	uint8* chunk = static_cast<uint8*>(::operator new(m_objectSize * m_objectsPerChunk));
+	m_chunks.push_back(chunk);
+
+	// link slots back to front so allocation walks the chunk in address order
+	for (uint32 i = m_objectsPerChunk; i > 0; i--)
+	{
+		void* slot = chunk + (i - 1) * m_objectSize;
+		*static_cast<void**>(slot) = m_freeList;
+		m_freeList = slot;
+	}
+}
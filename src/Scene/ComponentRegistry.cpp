@@ -0,0 +1,74 @@
+#include "Scene/ComponentRegistry.h"
+#include "Scene/Component.h"
+
+std::unordered_map<std::type_index, uint32> ComponentRegistry::s_typeIds;
+std::vector<std::type_index> ComponentRegistry::s_types;
+
+std::deque<ComponentRegistry::ComponentArray> ComponentRegistry::s_components;
+
+uint32 ComponentRegistry::getTypeId(std::type_index type)
+{
+	std::unordered_map<std::type_index, uint32>::iterator it = s_typeIds.find(type);
+	if (it != s_typeIds.end())
+		return it->second;
+
+	uint32 id = s_typeIds.size();
+	s_typeIds.insert(std::make_pair(type, id));
+	s_types.push_back(type);
+	s_components.resize(id + 1);
+
+	return id;
+}
+
+bool ComponentRegistry::findTypeId(std::type_index type, uint32& id)
+{
+	std::unordered_map<std::type_index, uint32>::iterator it = s_typeIds.find(type);
+	if (it == s_typeIds.end())
+		return false;
+
+	id = it->second;
+	return true;
+}
+
+std::type_index ComponentRegistry::getType(uint32 typeId)
+{
+	return typeId < s_types.size() ? s_types[typeId] : std::type_index(typeid(void));
+}
+
+uint32 ComponentRegistry::getTypeCount()
+{
+	return s_typeIds.size();
+}
+
+const ComponentRegistry::ComponentArray& ComponentRegistry::getComponents(uint32 typeId)
+{
+	static const ComponentArray empty;
+	return typeId < s_components.size() ? s_components[typeId] : empty;
+}
+
+void ComponentRegistry::attach(Component* c)
+{
+	if (!c || c->m_registryIndex != INVALID_INDEX)
+		return;
+
+	c->m_typeId = getTypeId(c->getType());
+
+	ComponentArray& components = s_components[c->m_typeId];
+	c->m_registryIndex = components.size();
+	components.push_back(c);
+}
+
+void ComponentRegistry::detach(Component* c)
+{
+	if (!c || c->m_registryIndex == INVALID_INDEX)
+		return;
+
+	// swap the last component into the freed place to keep the array packed
+	ComponentArray& components = s_components[c->m_typeId];
+	Component* last = components.back();
+	components[c->m_registryIndex] = last;
+	last->m_registryIndex = c->m_registryIndex;
+	components.pop_back();
+
+	c->m_registryIndex = INVALID_INDEX;
+}
@@ -241,6 +241,17 @@ float Body::getAngle()
 	return m_body ? m_body->GetAngle() : m_bodyDef.angle;
 }
 
+void Body::syncTransform()
+{
+	Transform* trans = getOwner()->getComponent<Transform>();
+	if (trans)
+	{
+		b2Vec2 pos = getPosition();
+		trans->setPosition(sf::Vector2f(pos.x, pos.y));
+		trans->setRotation(radToDeg(getAngle()));
+	}
+}
+
 void Body::onCreate()
 {
 	if (!getOwner() || getOwner()->isPrefab())
@@ -315,13 +326,7 @@ void Body::onDestroy()
 
 void Body::onUpdate(const sf::Time& dt)
 {
-	Transform* trans = getOwner()->getComponent<Transform>();
-	if (trans)
-	{
-		b2Vec2 pos = getPosition();
-		trans->setPosition(sf::Vector2f(pos.x, pos.y));
-		trans->setRotation(radToDeg(getAngle()));
-	}
+	syncTransform();
 }
 
 void Body::onDuplicate(Component* dest)
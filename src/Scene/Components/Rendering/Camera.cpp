@@ -3,8 +3,6 @@
 #include "Scene/GameObject.h"
 #include "Video/VideoManager.h"
 
-sf::RenderTexture* Camera::s_currentRT = 0;
-
 Camera::Camera() :
 	m_zoom(0.f),
 	m_zoomOut(0.f),
@@ -101,6 +99,32 @@ void Camera::setApplyViewToRenderTexture(bool value)
 	m_applyViewToRT = value;
 }
 
+void Camera::updateView()
+{
+	Transform* trans = getOwner()->getComponent<Transform>();
+	if (trans)
+	{
+		m_view->setCenter(trans->getPosition());
+		m_view->setRotation(trans->getRotation());
+	}
+}
+
+void Camera::setupPass(sf::RenderTarget* defaultTarget, RenderQueue::Pass& pass)
+{
+	if (m_renderTexture)
+	{
+		pass.target = m_renderTexture;
+		pass.texture = m_renderTexture;
+		pass.view = m_applyViewToRT ? *m_view : m_renderTexture->getView();
+	}
+	else
+	{
+		pass.target = defaultTarget;
+		pass.texture = 0;
+		pass.view = *m_view;
+	}
+}
+
 void Camera::onCreate()
 {
 	if (!getOwner() || getOwner()->isPrefab())
@@ -128,31 +152,7 @@ void Camera::onDuplicate(Component* dest)
 
 void Camera::onUpdate(const sf::Time& dt)
 {
-	Transform* trans = getOwner()->getComponent<Transform>();
-	if (trans)
-	{
-		m_view->setCenter(trans->getPosition());
-		m_view->setRotation(trans->getRotation());
-	}
-}
-
-void Camera::onRender(sf::RenderTarget*& target)
-{
-	if (s_currentRT)
-		s_currentRT->display();
-	if (m_renderTexture)
-	{
-		s_currentRT = m_renderTexture;
-		target = m_renderTexture;
-
-		if (m_applyViewToRT)
-			target->setView(*m_view);
-	}
-	else
-	{
-		s_currentRT = 0;
-		target->setView(*m_view);
-	}
+	updateView();
 }
 
 template <class Archive>
@@ -1,9 +1,21 @@
 #include "Scene/Components/Rendering/SpriteRenderer.h"
 #include "Filesystem/Assets/AssetManager.h"
+#include "Scene/GameObject.h"
+#include "Scene/Components/Transform.h"
+#include "Scene/Systems/TransformSystem.h"
+#include "Scene/SpriteGrid.h"
+#include "Video/RenderQueue.h"
 
 SpriteRenderer::SpriteRenderer() :
 	m_states(sf::RenderStates::Default),
-	m_materialValidation(false)
+	m_materialValidation(false),
+	m_layer(0),
+	m_quadDirty(true),
+	m_transformVersion(0),
+	m_depth(0),
+	m_inGrid(false),
+	m_queryStamp(0),
+	m_passMask(0)
 {
 	m_shape = new sf::RectangleShape();
 	setTexture(0);
@@ -11,11 +23,13 @@ SpriteRenderer::SpriteRenderer() :
 
 SpriteRenderer::~SpriteRenderer()
 {
+	SpriteGrid::remove(this);
 	DELETE_OBJECT(m_shape);
 }
 
 sf::RectangleShape* SpriteRenderer::getRenderer()
 {
+	m_quadDirty = true;
 	return m_shape;
 }
 
@@ -28,6 +42,8 @@ void SpriteRenderer::setTexture(sf::Texture* tex)
 		sf::Vector2u s = t->getSize();
 		m_shape->setTextureRect(sf::IntRect(0, 0, s.x, s.y));
 	}
+
+	m_quadDirty = true;
 }
 
 sf::Texture* SpriteRenderer::getTexture() const
@@ -36,6 +52,28 @@ sf::Texture* SpriteRenderer::getTexture() const
 	return tex == AssetManager::getDefaultTexture() ? 0 : tex;
 }
 
+void SpriteRenderer::setTextureRegion(const TextureRegion& region)
+{
+	setTexture(region.texture);
+	if (region.texture && region.rect.width > 0 && region.rect.height > 0)
+		m_shape->setTextureRect(region.rect);
+}
+
+bool SpriteRenderer::loadTexture(const std::string& id, const std::string& path)
+{
+	TextureRegion region;
+	if (!AssetManager::loadTextureRegion(id, path, region))
+		return false;
+
+	setTextureRegion(region);
+	return true;
+}
+
+TextureRegion SpriteRenderer::getTextureRegion() const
+{
+	return TextureRegion(getTexture(), m_shape->getTextureRect());
+}
+
 void SpriteRenderer::setSize(sf::Vector2f size)
 {
 	sf::Texture* t = getTexture();
@@ -45,6 +83,7 @@ void SpriteRenderer::setSize(sf::Vector2f size)
 		size.y = t ? t->getSize().y : 0.f;
 
 	m_shape->setSize(size);
+	m_quadDirty = true;
 }
 
 sf::Vector2f SpriteRenderer::getSize()
@@ -55,6 +94,7 @@ sf::Vector2f SpriteRenderer::getSize()
 void SpriteRenderer::setOrigin(sf::Vector2f origin)
 {
 	m_shape->setOrigin(origin);
+	m_quadDirty = true;
 }
 
 sf::Vector2f SpriteRenderer::getOrigin()
@@ -80,6 +120,7 @@ sf::Vector2f SpriteRenderer::getOriginPercent() const
 void SpriteRenderer::setColor(sf::Color color)
 {
 	m_shape->setFillColor(color);
+	m_quadDirty = true;
 }
 
 sf::Color SpriteRenderer::getColor()
@@ -90,6 +131,7 @@ sf::Color SpriteRenderer::getColor()
 void SpriteRenderer::setRenderStates(sf::RenderStates states)
 {
 	m_states = states;
+	m_quadDirty = true;
 }
 
 sf::RenderStates SpriteRenderer::getRenderStates()
@@ -117,6 +159,71 @@ bool SpriteRenderer::getMaterialValidation()
 	return m_materialValidation;
 }
 
+void SpriteRenderer::setLayer(int32 layer)
+{
+	m_layer = layer;
+}
+
+int32 SpriteRenderer::getLayer()
+{
+	return m_layer;
+}
+
+bool SpriteRenderer::updateQuad()
+{
+	Transform* trans = TransformSystem::findTransform(getOwner());
+
+	// children are drawn over their parents with the same layer and order,
+	// sprites below a transformed object without their own transform count one level deeper
+	int32 level = trans ? trans->getHierarchyLevel() : -1;
+	m_depth = level >= 0 ? level + (trans->getOwner() != getOwner() ? 1 : 0) : 0;
+
+	uint32 version = trans ? trans->getVersion() : 0;
+	if (!m_quadDirty && version == m_transformVersion)
+		return false;
+
+	m_states.transform = trans ? trans->getGlobalTransform() : sf::Transform::Identity;
+	m_transformVersion = version;
+	m_quadDirty = false;
+
+	sf::Transform t = m_states.transform * m_shape->getTransform();
+	sf::Vector2f size = m_shape->getSize();
+	sf::IntRect rect = m_shape->getTextureRect();
+	sf::Color color = m_shape->getFillColor();
+
+	float left = (float)(rect.left);
+	float top = (float)(rect.top);
+	float right = left + rect.width;
+	float bottom = top + rect.height;
+
+	m_quad[0] = sf::Vertex(t.transformPoint(0.f, 0.f), color, sf::Vector2f(left, top));
+	m_quad[1] = sf::Vertex(t.transformPoint(size.x, 0.f), color, sf::Vector2f(right, top));
+	m_quad[2] = sf::Vertex(t.transformPoint(size.x, size.y), color, sf::Vector2f(right, bottom));
+	m_quad[3] = sf::Vertex(t.transformPoint(0.f, size.y), color, sf::Vector2f(left, bottom));
+
+	sf::Vector2f min = m_quad[0].position;
+	sf::Vector2f max = m_quad[0].position;
+	for (uint32 i = 1; i < 4; i++)
+	{
+		min.x = std::min(min.x, m_quad[i].position.x);
+		min.y = std::min(min.y, m_quad[i].position.y);
+		max.x = std::max(max.x, m_quad[i].position.x);
+		max.y = std::max(max.y, m_quad[i].position.y);
+	}
+
+	m_bounds = sf::FloatRect(min.x, min.y, max.x - min.x, max.y - min.y);
+
+	return true;
+}
+
+void SpriteRenderer::submit(uint32 slot)
+{
+	sf::RenderStates states = m_states;
+	states.texture = m_shape->getTexture();
+
+	RenderQueue::submit(slot, m_quad, states, m_layer, getOwner()->getOrder(), m_depth, m_passMask, &m_material, m_materialValidation);
+}
+
 void SpriteRenderer::onDuplicate(Component* dest)
 {
 	if (!dest)
@@ -129,23 +236,22 @@ void SpriteRenderer::onDuplicate(Component* dest)
 	SpriteRenderer* r = (SpriteRenderer*)(dest);
 	r->setMaterial(getMaterial());
 	r->setMaterialValidation(getMaterialValidation());
-	r->setTexture(getTexture());
+	r->setTextureRegion(getTextureRegion());
 	r->setSize(getSize());
 	r->setOrigin(getOrigin());
 	r->setRenderStates(getRenderStates());
+	r->setLayer(getLayer());
 }
 
-void SpriteRenderer::onRender(sf::RenderTarget*& target)
+void SpriteRenderer::setTransform(const sf::Transform& trans)
 {
-	if (m_states.shader)
-		m_material.apply((sf::Shader*)(m_states.shader), m_materialValidation);
-
-	target->draw(*m_shape, m_states);
+	m_states.transform = trans;
+	m_quadDirty = true;
 }
 
 void SpriteRenderer::onTransform(const sf::Transform& inTrans, sf::Transform& outTrans)
 {
-	m_states.transform = inTrans;
+	setTransform(inTrans);
 }
 
 template <class Archive>
@@ -153,9 +259,12 @@ void SpriteRenderer::save(Archive& ar, const unsigned int version) const
 {
 	ar & boost::serialization::base_object<const Component>(*this);
 
-	std::string texId = AssetManager::findTexture(getTexture());
+	std::string texId = AssetManager::findTextureRegion(getTextureRegion());
 	ar & BOOST_SERIALIZATION_NVP(texId);
 
+	std::string texPath = AssetManager::getTexturePath(texId);
+	ar & BOOST_SERIALIZATION_NVP(texPath);
+
 	sf::Vector2f s = m_shape->getSize();
 	ar & boost::serialization::make_nvp("size", s);
 
@@ -167,6 +276,8 @@ void SpriteRenderer::save(Archive& ar, const unsigned int version) const
 
 	sf::Color c = m_shape->getFillColor();
 	ar & boost::serialization::make_nvp("color", c);
+
+	ar & boost::serialization::make_nvp("layer", m_layer);
 }
 
 template <class Archive>
@@ -176,9 +287,16 @@ void SpriteRenderer::load(Archive& ar, const unsigned int version)
 
 	std::string texId;
 	ar & BOOST_SERIALIZATION_NVP(texId);
-	sf::Texture* tex = AssetManager::getTexture(texId);
-	if(tex)
-		setTexture(tex);
+
+	// scenes load the textures of their sprites, packing small ones into the atlas
+	std::string texPath;
+	if (version > 2)
+		ar & BOOST_SERIALIZATION_NVP(texPath);
+
+	TextureRegion region;
+	if (AssetManager::getTextureRegion(texId, region) ||
+		(!texPath.empty() && AssetManager::loadTextureRegion(texId, texPath, region)))
+		setTextureRegion(region);
 
 	sf::Vector2f s;
 	ar & boost::serialization::make_nvp("size", s);
@@ -195,6 +313,9 @@ void SpriteRenderer::load(Archive& ar, const unsigned int version)
 	sf::Color c;
 	ar & boost::serialization::make_nvp("color", c);
 	setColor(c);
+
+	if (version > 1)
+		ar & boost::serialization::make_nvp("layer", m_layer);
 }
 
 DECLARE_BINARY_SAVE(SpriteRenderer)
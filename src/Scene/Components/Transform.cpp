@@ -1,16 +1,27 @@
 #include "Scene/Components/Transform.h"
 #include "Scene/GameObject.h"
+#include "Scene/Systems/TransformSystem.h"
+
+std::atomic<uint32> Transform::s_version(0);
 
 Transform::Transform() :
 	m_position(sf::Vector2f(0.f, 0.f)),
 	m_rotation(0.f),
 	m_scale(sf::Vector2f(0.f, 0.f)),
-	m_mode(Hierarchy)
+	m_mode(Hierarchy),
+	m_localDirty(true),
+	m_globalDirty(true),
+	m_version(0),
+	m_parent(0),
+	m_parentVersion(0),
+	m_nodeLevel(-1),
+	m_nodeIndex(0)
 {
 }
 
 Transform::~Transform()
 {
+	TransformSystem::releaseTransform(this);
 }
 
 sf::Vector2f Transform::getPosition()
@@ -20,7 +31,11 @@ sf::Vector2f Transform::getPosition()
 
 void Transform::setPosition(sf::Vector2f pos)
 {
+	if (m_position == pos)
+		return;
+
 	m_position = pos;
+	m_localDirty = true;
 }
 
 float Transform::getRotation()
@@ -30,7 +45,11 @@ float Transform::getRotation()
 
 void Transform::setRotation(float rot)
 {
+	if (m_rotation == rot)
+		return;
+
 	m_rotation = rot;
+	m_localDirty = true;
 }
 
 sf::Vector2f Transform::getScale()
@@ -40,33 +59,68 @@ sf::Vector2f Transform::getScale()
 
 void Transform::setScale(sf::Vector2f scale)
 {
+	if (m_scale == scale)
+		return;
+
 	m_scale = scale;
+	m_localDirty = true;
 }
 
-const sf::Transform& Transform::getTransform()
+void Transform::setMode(ModeType mode)
 {
-	return m_transform;
-}
+	if (m_mode == mode)
+		return;
 
-const sf::Transform& Transform::getGlobalTransform()
-{
-	return m_globalTransform;
+	m_mode = mode;
+	m_localDirty = true;
 }
 
-void Transform::recomputeTransform()
+const sf::Transform& Transform::getTransform()
 {
-	if (getOwner())
+	if (m_localDirty)
 	{
-		if (getOwner()->getParent())
+		m_transform = sf::Transform::Identity;
+		if (m_mode != Parent)
 		{
-			Transform* trans = getOwner()->getParent()->getComponent<Transform>();
-			if (trans)
-				trans->recomputeTransform();
+			m_transform.translate(m_position);
+			m_transform.rotate(m_rotation);
+			m_transform.scale(m_scale);
 		}
+
+		m_localDirty = false;
+		m_globalDirty = true;
 	}
 
-	sf::Transform t;
-	onTransform(t, t);
+	return m_transform;
+}
+
+void Transform::recomputeTransform()
+{
+	if (!getOwner())
+		return;
+
+	GameObject* parentObject = getOwner()->getParent();
+	Transform* parent = parentObject != getOwner() ? TransformSystem::findTransform(parentObject) : 0;
+	if (parent)
+		parent->recomputeTransform();
+
+	updateGlobalTransform(parent);
+}
+
+bool Transform::updateGlobalTransform(const Transform* parent)
+{
+	getTransform();
+
+	uint32 parentVersion = parent ? parent->m_version : 0;
+	if (!m_globalDirty && parent == m_parent && parentVersion == m_parentVersion)
+		return false;
+
+	computeGlobalTransform(parent ? parent->m_globalTransform : sf::Transform::Identity);
+
+	m_parent = parent;
+	m_parentVersion = parentVersion;
+
+	return true;
 }
 
 void Transform::onDuplicate(Component* dest)
@@ -87,28 +141,37 @@ void Transform::onDuplicate(Component* dest)
 
 void Transform::onTransform(const sf::Transform& inTrans, sf::Transform& outTrans)
 {
-	sf::Transform t;
+	getTransform();
+	computeGlobalTransform(inTrans);
+
+	// the parent is not known here, next update has to check it again
+	m_parent = 0;
+	m_globalDirty = true;
+
+	outTrans = m_globalTransform;
+}
+
+void Transform::applyGlobalTransform(const sf::Transform& global, const Transform* parent)
+{
+	m_globalTransform = global;
+	m_globalDirty = false;
+	m_version = ++s_version;
+
+	m_parent = parent;
+	m_parentVersion = parent ? parent->m_version : 0;
+}
+
+void Transform::computeGlobalTransform(const sf::Transform& parent)
+{
 	if (m_mode == Hierarchy)
-	{
-		t.translate(m_position);
-		t.rotate(m_rotation);
-		t.scale(m_scale);
-		outTrans = inTrans * t;
-	}
+		m_globalTransform = parent * m_transform;
 	else if (m_mode == Parent)
-	{
-		outTrans = inTrans;
-	}
+		m_globalTransform = parent;
 	else
-	{
-		t.translate(m_position);
-		t.rotate(m_rotation);
-		t.scale(m_scale);
-		outTrans = t;
-	}
+		m_globalTransform = m_transform;
 
-	m_transform = t;
-	m_globalTransform = outTrans;
+	m_globalDirty = false;
+	m_version = ++s_version;
 }
 
 template <class Archive>
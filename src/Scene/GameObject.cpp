@@ -1,5 +1,8 @@
 #include "Scene/GameObject.h"
 #include "Scene/Scene.h"
+#include "Scene/Systems/TransformSystem.h"
+#include "Scene/Components/Transform.h"
+#include "Scene/Map/SpatialHash.h"
 #include "Core.h"
 
 GameObject::GameObject(const std::string& id) :
@@ -11,7 +14,11 @@ GameObject::GameObject(const std::string& id) :
 	m_order(0),
 	m_prefab(false),
 	m_active(true),
-	m_isDestroying(false)
+	m_isDestroying(false),
+	m_inScene(false),
+	m_activeInHierarchy(true),
+	m_childrenUnsorted(false),
+	m_pendingIndex(Scene::INVALID_PENDING_INDEX)
 {
 }
 
@@ -30,6 +37,10 @@ GameObject::~GameObject()
 	}
 
 	m_childrensToAdd.clear();
+
+	Scene::dequeueChanges(this);
+	TransformSystem::dequeue(this);
+	SpatialHash::removeFromAll(*this);
 }
 
 std::string GameObject::getId()
@@ -37,9 +48,17 @@ std::string GameObject::getId()
 	return m_id;
 }
 
-void GameObject::setId(std::string id)
+bool GameObject::setId(std::string id)
 {
+	if (id == m_id)
+		return true;
+
+	// keep the scene id index in sync for objects that are stored or waiting there
+	if (!Scene::reindexGameObject(this, id))
+		return false;
+
 	m_id = id;
+	return true;
 }
 
 uint32 GameObject::getOrder()
@@ -49,7 +68,16 @@ uint32 GameObject::getOrder()
 
 void GameObject::setOrder(uint32 order)
 {
+	if (m_order == order)
+		return;
+
 	m_order = order;
+
+	if (m_parent && m_parent != this)
+	{
+		m_parent->m_childrenUnsorted = true;
+		Scene::queueChanges(m_parent);
+	}
 }
 
 bool GameObject::isActive()
@@ -59,7 +87,13 @@ bool GameObject::isActive()
 
 void GameObject::setActive(bool flag)
 {
+	if (m_active == flag)
+		return;
+
 	m_active = flag;
+
+	if (m_inScene)
+		updateActiveInHierarchy();
 }
 
 bool GameObject::isPrefab()
@@ -67,6 +101,11 @@ bool GameObject::isPrefab()
 	return m_prefab;
 }
 
+bool GameObject::isUpdating()
+{
+	return m_inScene && m_activeInHierarchy;
+}
+
 GameObject* GameObject::getParent()
 {
 	return m_parent;
@@ -101,6 +140,10 @@ bool GameObject::addComponent(Component* c)
 
 	m_components.push_back(std::make_pair(c->getType(), c));
 	c->setGameObject(this);
+	ComponentRegistry::attach(c);
+	setComponentSlot(c);
+	if (c->getType() == typeid(Transform))
+		TransformSystem::invalidateHierarchy(this);
 
 	return true;
 }
@@ -117,12 +160,14 @@ void GameObject::removeComponent(Component* c, bool delayed)
 		if (it->second == c)
 		{
 			if (delayed)
+			{
 				m_componentsToDestroyDelayed.push_back(std::make_pair(c->getType(), c));
+				Scene::queueChanges(this);
+			}
 			else
 			{
-				c->setGameObject(0);
+				detachComponent(it);
 				DELETE_OBJECT(c);
-				m_components.erase(it);
 			}
 			return;
 		}
@@ -138,12 +183,14 @@ void GameObject::removeComponent(std::type_index type, bool delayed)
 		{
 			c = it->second;
 			if (delayed)
+			{
 				m_componentsToDestroyDelayed.push_back(std::make_pair(c->getType(), c));
+				Scene::queueChanges(this);
+			}
 			else
 			{
-				c->setGameObject(0);
+				detachComponent(it);
 				DELETE_OBJECT(c);
-				m_components.erase(it);
 			}
 			return;
 		}
@@ -156,18 +203,28 @@ void GameObject::removeAllComponents(bool delayed)
 	{
 		for (Components::iterator it = m_components.begin(); it != m_components.end(); it++)
 			m_componentsToDestroyDelayed.push_back(*it);
+
+		Scene::queueChanges(this);
 	}
 	else
 	{
 		Component* c;
+		bool hadTransform = false;
 		for (Components::iterator it = m_components.begin(); it != m_components.end(); it++)
 		{
 			c = it->second;
+			hadTransform = hadTransform || c->getType() == typeid(Transform);
+			ComponentRegistry::detach(c);
 			c->setGameObject(0);
 			DELETE_OBJECT(c);
 		}
 
 		m_components.clear();
+		m_componentsByType.clear();
+
+		// children of the deleted transforms get a new parent
+		if (hadTransform)
+			TransformSystem::invalidateHierarchy(this);
 	}
 }
 
@@ -187,20 +244,16 @@ bool GameObject::hasComponent(Component* c)
 
 bool GameObject::hasComponent(std::type_index type)
 {
-	for (Components::iterator it = m_components.begin(); it != m_components.end(); it++)
-		if (it->first == type)
-			return true;
-
-	return false;
+	return getComponent(type) != 0;
 }
 
 Component* GameObject::getComponent(std::type_index type)
 {
-	for (Components::iterator it = m_components.begin(); it != m_components.end(); it++)
-		if (it->first == type)
-			return it->second;
+	uint32 id;
+	if (!ComponentRegistry::findTypeId(type, id) || id >= m_componentsByType.size())
+		return 0;
 
-	return 0;
+	return m_componentsByType[id];
 }
 
 GameObject::Components GameObject::getComponentList()
@@ -210,14 +263,17 @@ GameObject::Components GameObject::getComponentList()
 
 void GameObject::processRemovingDelayedComponents()
 {
+	if (m_componentsToDestroyDelayed.empty())
+		return;
+
 	Component* c;
 	for (Components::iterator it = m_componentsToDestroyDelayed.begin(); it != m_componentsToDestroyDelayed.end(); it++)
 	{
-		if (std::find(m_components.begin(), m_components.end(), *it) == m_components.end())
+		Components::iterator found = std::find(m_components.begin(), m_components.end(), *it);
+		if (found == m_components.end())
 			continue;
 		c = it->second;
-		m_components.remove(*it);
-		c->setGameObject(0);
+		detachComponent(found);
 		DELETE_OBJECT(c);
 	}
 
@@ -272,6 +328,8 @@ bool GameObject::addChildren(GameObject* o)
 	o->setDestroying(m_isDestroying);
 	o->setPrefab(m_prefab);
 
+	Scene::queueChanges(this);
+
 	return true;
 }
 
@@ -285,6 +343,8 @@ void GameObject::removeChildren(GameObject* o)
 	m_childrensToRemove.push_back(o);
 	o->setDestroying(true);
 	o->onDestroy();
+
+	Scene::queueChanges(this);
 }
 
 void GameObject::removeChildren(const std::string& id)
@@ -298,6 +358,8 @@ void GameObject::removeChildren(const std::string& id)
 	m_childrensToRemove.push_back(o);
 	o->setDestroying(true);
 	o->onDestroy();
+
+	Scene::queueChanges(this);
 }
 
 void GameObject::removeAllChildrens()
@@ -310,6 +372,9 @@ void GameObject::removeAllChildrens()
 		o->setDestroying(true);
 		o->onDestroy();
 	}
+
+	if (!m_childrensToRemove.empty())
+		Scene::queueChanges(this);
 }
 
 bool GameObject::hasChildren(GameObject* o)
@@ -356,6 +421,7 @@ void GameObject::processAdding()
 	{
 		o = *it;
 		m_childrens.push_back(o);
+		m_childrenUnsorted = true;
 		o->onCreate();
 	}
 
@@ -397,8 +463,19 @@ bool GameObject::isWaitingToRemove(GameObject* o)
 	return false;
 }
 
+bool GameObject::hasPendingChanges()
+{
+	return !m_childrensToAdd.empty() || !m_childrensToRemove.empty() || !m_componentsToDestroyDelayed.empty() || m_childrenUnsorted;
+}
+
 void GameObject::onCreate()
 {
+	m_inScene = true;
+	m_activeInHierarchy = m_active && (!m_parent || m_parent == this || m_parent->m_activeInHierarchy);
+	if (hasPendingChanges())
+		Scene::queueChanges(this);
+	TransformSystem::invalidateHierarchy(this);
+
 	for (Components::iterator it = m_components.begin(); it != m_components.end(); it++)
 		it->second->onCreate();
 
@@ -408,6 +485,9 @@ void GameObject::onCreate()
 
 void GameObject::onDestroy()
 {
+	// transforms stay in the hierarchy until the object is deleted
+	m_inScene = false;
+
 	for (List::iterator it = m_childrens.begin(); it != m_childrens.end(); it++)
 		(*it)->onDestroy();
 
@@ -456,35 +536,6 @@ void GameObject::onDuplicate(GameObject* dest)
 	}
 }
 
-void GameObject::onUpdate(const sf::Time& dt, const sf::Transform& trans, bool sort)
-{
-	if (m_active)
-	{
-		processRemovingDelayedComponents();
-
-		Component* c;
-		sf::Transform t = trans;
-		for (Components::iterator it = m_components.begin(); it != m_components.end(); it++)
-		{
-			c = it->second;
-			if (c->isActive())
-			{
-				c->onUpdate(dt);
-				c->onTransform(t, t);
-			}
-		}
-
-		processAdding();
-		processRemoving();
-
-		if (sort)
-			m_childrens.sort([](GameObject* a, GameObject* b)->bool { return a->getOrder() > b->getOrder(); });
-
-		for (List::iterator it = m_childrens.begin(); it != m_childrens.end(); it++)
-			(*it)->onUpdate(dt, t, sort);
-	}
-}
-
 void GameObject::onEvent(const sf::Event& event)
 {
 	if (m_active)
@@ -502,35 +553,6 @@ void GameObject::onEvent(const sf::Event& event)
 	}
 }
 
-void GameObject::onRender(sf::RenderTarget*& target)
-{
-	if (m_active)
-	{
-		List::iterator it = m_childrens.begin();
-		while (it != m_childrens.end())
-		{
-			if ((*it)->getOrder() <= 0)
-				break;
-			(*it)->onRender(target);
-			it++;
-		}
-
-		Component* c;
-		for (Components::iterator it = m_components.begin(); it != m_components.end(); it++)
-		{
-			c = it->second;
-			if (c->isActive())
-				c->onRender(target);
-		}
-
-		while (it != m_childrens.end())
-		{
-			(*it)->onRender(target);
-			it++;
-		}
-	}
-}
-
 void GameObject::onCollide(GameObject* other, bool beginOrEnd, b2Contact* contact)
 {
 	if (m_active)
@@ -560,6 +582,78 @@ void GameObject::setPrefab(bool flag)
 	m_prefab = flag;
 }
 
+void GameObject::updateActiveInHierarchy()
+{
+	bool wasActive = m_activeInHierarchy;
+	m_activeInHierarchy = m_active && (!m_parent || m_parent == this || m_parent->m_activeInHierarchy);
+	if (m_activeInHierarchy == wasActive)
+		return;
+
+	TransformSystem::invalidateHierarchy(this);
+
+	// changes of inactive objects wait until they are activated again
+	if (m_activeInHierarchy && hasPendingChanges())
+		Scene::queueChanges(this);
+
+	for (List::iterator it = m_childrens.begin(); it != m_childrens.end(); it++)
+		(*it)->updateActiveInHierarchy();
+}
+
+void GameObject::processPendingChanges(bool sort)
+{
+	processRemovingDelayedComponents();
+	processAdding();
+	processRemoving();
+
+	if (sort && m_childrenUnsorted)
+		m_childrens.sort([](GameObject* a, GameObject* b)->bool { return a->getOrder() > b->getOrder(); });
+
+	m_childrenUnsorted = false;
+}
+
+void GameObject::detachComponent(Components::iterator it)
+{
+	Component* c = it->second;
+	m_components.erase(it);
+
+	ComponentRegistry::detach(c);
+	resetComponentSlot(c);
+	c->setGameObject(0);
+	if (c->getType() == typeid(Transform))
+	{
+		TransformSystem::releaseTransform((Transform*)(c));
+		TransformSystem::invalidateHierarchy(this);
+	}
+}
+
+void GameObject::setComponentSlot(Component* c)
+{
+	uint32 id = ComponentRegistry::getTypeId(c->getType());
+	if (id >= m_componentsByType.size())
+		m_componentsByType.resize(id + 1, 0);
+
+	if (!m_componentsByType[id])
+		m_componentsByType[id] = c;
+}
+
+void GameObject::resetComponentSlot(Component* c)
+{
+	uint32 id;
+	if (!ComponentRegistry::findTypeId(c->getType(), id) || id >= m_componentsByType.size() || m_componentsByType[id] != c)
+		return;
+
+	// another component of the same type takes the slot over
+	m_componentsByType[id] = 0;
+	for (Components::iterator it = m_components.begin(); it != m_components.end(); it++)
+	{
+		if (it->first == c->getType())
+		{
+			m_componentsByType[id] = it->second;
+			break;
+		}
+	}
+}
+
 GameObject* GameObject::findChildrenInPartOfPath(const std::string& path, uint32 from)
 {
 	unsigned int p = path.find('/', from);
@@ -658,7 +752,7 @@ void GameObject::load(Archive& ar, const unsigned int version)
 
 	uint32 componentsCount;
 	ar & BOOST_SERIALIZATION_NVP(componentsCount);
-	m_components.clear();
+	removeAllComponents();
 
 	for (uint32 i = 0; i < componentsCount; i++)
 	{
@@ -0,0 +1,160 @@
+#include <Scene/Map/ChunkedLayer.h>
+#include <Scene/Map/MapLayer.h>
+
+void TileChunk::Data::setTexCoords(const AnimatedTile& tile, const sf::Vector2f* texCoords)
+{
+	std::vector<sf::Vertex>& set = vertices[tile.tileset];
+	for (uint32 i = 0; i < 4u; ++i)
+		set[tile.first + i].texCoords = texCoords[i];
+
+	auto buffer = buffers.find(tile.tileset);
+	if (buffer != buffers.end())
+		buffer->second.update(&set[tile.first], 4u, tile.first);
+}
+
+ChunkedLayer::ChunkedLayer(uint32 width, uint32 height, uint32 chunkSize, const std::vector<sf::Texture>& textures) :
+	m_width(width),
+	m_height(height),
+	m_chunkSize(chunkSize ? chunkSize : 1u),
+	m_textures(textures),
+	m_memory(0),
+	m_loadedCount(0)
+{
+	m_chunksX = (m_width + m_chunkSize - 1) / m_chunkSize;
+	m_chunksY = (m_height + m_chunkSize - 1) / m_chunkSize;
+
+	m_tiles.resize(m_width * m_height, 0u);
+	m_chunks.resize(m_chunksX * m_chunksY);
+}
+
+ChunkedLayer::~ChunkedLayer()
+{
+	waitForJobs();
+}
+
+void ChunkedLayer::setTile(uint32 x, uint32 y, sf::Uint32 gid)
+{
+	if (x < m_width && y < m_height)
+		m_tiles[y * m_width + x] = gid;
+}
+
+void ChunkedLayer::setTiles(const uint8* tileData)
+{
+	if (!m_tiles.empty())
+		std::memcpy(&m_tiles[0], tileData, m_tiles.size() * sizeof(sf::Uint32));
+}
+
+void ChunkedLayer::load(uint32 index, const BuildFunction& build)
+{
+	TileChunk& chunk = m_chunks[index];
+	if (chunk.state != TileChunk::Unloaded)
+		return;
+
+	uint32 chunkX = index % m_chunksX;
+	uint32 chunkY = index / m_chunksX;
+
+	// the job fills its own data, the chunk takes it over on the main thread
+	std::shared_ptr<TileChunk::Data> data = std::make_shared<TileChunk::Data>();
+	chunk.data = data;
+	chunk.state = TileChunk::Loading;
+	chunk.job = JobSystem::createJob([this, build, chunkX, chunkY, data]()
+	{
+		build(*this, chunkX, chunkY, *data);
+	});
+
+	m_loading.push_back(index);
+	JobSystem::run(chunk.job);
+}
+
+void ChunkedLayer::unload(uint32 index)
+{
+	TileChunk& chunk = m_chunks[index];
+	if (chunk.state != TileChunk::Loaded)
+		return;
+
+	m_memory -= chunk.data->memory;
+	m_loadedCount--;
+
+	chunk.data.reset();
+	chunk.state = TileChunk::Unloaded;
+}
+
+void ChunkedLayer::update()
+{
+	for (uint32 i = 0; i < m_loading.size(); ++i)
+	{
+		TileChunk& chunk = m_chunks[m_loading[i]];
+		if (!chunk.job->isFinished())
+			continue;
+
+		chunk.job.reset();
+		chunk.state = TileChunk::Loaded;
+		m_memory += chunk.data->memory;
+		m_loadedCount++;
+
+		m_loading[i] = m_loading.back();
+		m_loading.pop_back();
+		i--;
+	}
+}
+
+void ChunkedLayer::waitForJobs()
+{
+	for (uint32 i = 0; i < m_loading.size(); ++i)
+		JobSystem::wait(m_chunks[m_loading[i]].job);
+
+	update();
+}
+
+void ChunkedLayer::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+	const sf::View& view = target.getView();
+	sf::FloatRect viewBounds(view.getCenter() - view.getSize() / 2.f, view.getSize());
+
+	for (const auto& chunk : m_chunks)
+	{
+		if (chunk.state != TileChunk::Loaded || !viewBounds.intersects(chunk.data->bounds))
+			continue;
+
+		if (!chunk.data->uploaded)
+			_upload(*chunk.data);
+
+		for (const auto& set : chunk.data->vertices)
+		{
+			if (set.second.empty() || set.first >= m_textures.size())
+				continue;
+
+			states.texture = &m_textures[set.first];
+
+			auto buffer = chunk.data->buffers.find(set.first);
+			if (buffer != chunk.data->buffers.end())
+				target.draw(buffer->second, states);
+			else
+				target.draw(&set.second[0], set.second.size(), sf::Quads, states);
+
+			LayerSet::addDrawnVertices(set.second.size());
+		}
+	}
+}
+
+void ChunkedLayer::_upload(TileChunk::Data& data) const
+{
+	data.uploaded = true;
+	if (!LayerSet::vertexBuffersEnabled())
+		return;
+
+	for (const auto& set : data.vertices)
+	{
+		if (set.second.empty())
+			continue;
+
+		sf::VertexBuffer& buffer = data.buffers[set.first];
+		buffer.setPrimitiveType(sf::Quads);
+		buffer.setUsage(sf::VertexBuffer::Static);
+		if (!buffer.create(set.second.size()) || !buffer.update(&set.second[0]))
+		{
+			PRINT_WARNING << "Failed to create vertex buffer for chunk, using vertex arrays" << std::endl;
+			data.buffers.erase(set.first);
+		}
+	}
+}
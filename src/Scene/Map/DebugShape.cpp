@@ -10,7 +10,7 @@ void DebugShape::addVertex(const sf::Vertex& v)
 {
 	if (m_closed)
 	{
-		sf::Uint16 i = m_array.getVertexCount() - 1;
+		std::size_t i = m_array.getVertexCount() - 1;
 		sf::Vertex v = m_array[i];
 		m_array[i] = v;
 		m_array.append(v);
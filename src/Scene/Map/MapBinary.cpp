@@ -0,0 +1,39 @@
+#include <Scene/Map/MapBinary.h>
+
+const char* MapBinary::EXTENSION = ".tmxb";
+
+void BinaryWriter::writeString(const std::string& value)
+{
+	writeArray(value.data(), value.size());
+}
+
+BinaryReader::BinaryReader(const uint8* data, std::size_t size) :
+	m_data(data),
+	m_size(size),
+	m_offset(0),
+	m_failed(false)
+{
+}
+
+bool BinaryReader::readString(std::string& value)
+{
+	uint32 count;
+	const uint8* chars = readArray<char>(count);
+	if (m_failed)
+		return false;
+
+	value.assign(reinterpret_cast<const char*>(chars), count);
+	return true;
+}
+
+bool BinaryReader::skip(std::size_t size)
+{
+	if (m_failed || size > m_size - m_offset)
+	{
+		m_failed = true;
+		return false;
+	}
+
+	m_offset += size;
+	return true;
+}
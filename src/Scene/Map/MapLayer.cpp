@@ -1,96 +1,371 @@
 #include <Scene/Map/MapLayer.h>
 
-TileQuad::TileQuad(sf::Uint16 i0, sf::Uint16 i1, sf::Uint16 i2, sf::Uint16 i3) :
-	m_needsUpdate(false)
+TileQuad::TileQuad() :
+	m_layerSet(0),
+	m_index(0)
+{
+}
+
+TileQuad::TileQuad(LayerSet* layerSet, uint32 index) :
+	m_layerSet(layerSet),
+	m_index(index)
 {
-	m_indices[0] = i0;
-	m_indices[1] = i1;
-	m_indices[2] = i2;
-	m_indices[3] = i3;
 }
 
 void TileQuad::move(const sf::Vector2f& distance)
 {
-	m_movement = distance;
-	m_needsUpdate = true;
+	if (m_layerSet)
+		m_layerSet->moveQuad(m_index, distance);
+}
+
+uint32 LayerSet::s_drawnVertices = 0;
+bool LayerSet::s_vertexBuffersEnabled = true;
+
+static sf::FloatRect quadBounds(const sf::Vertex* quad)
+{
+	sf::Vector2f min = quad[0].position;
+	sf::Vector2f max = quad[0].position;
+	for (uint32 i = 1; i < 4u; ++i)
+	{
+		min.x = std::min(min.x, quad[i].position.x);
+		min.y = std::min(min.y, quad[i].position.y);
+		max.x = std::max(max.x, quad[i].position.x);
+		max.y = std::max(max.y, quad[i].position.y);
+	}
+
+	return sf::FloatRect(min, max - min);
+}
+
+static void expandRect(sf::FloatRect& rect, const sf::FloatRect& other)
+{
+	float right = std::max(rect.left + rect.width, other.left + other.width);
+	float bottom = std::max(rect.top + rect.height, other.top + other.height);
+	rect.left = std::min(rect.left, other.left);
+	rect.top = std::min(rect.top, other.top);
+	rect.width = right - rect.left;
+	rect.height = bottom - rect.top;
 }
 
 LayerSet::LayerSet(const sf::Texture& texture) :
 	m_texture(texture),
-	m_visible(true)
+	m_cellsDirty(false),
+	m_buffer(sf::Quads, sf::VertexBuffer::Static),
+	m_bufferDirty(false),
+	m_culled(false)
 {
 }
 
-TileQuad::Ptr LayerSet::addTile(sf::Vertex v0, sf::Vertex v1, sf::Vertex v2, sf::Vertex v3)
+TileQuad LayerSet::addTile(sf::Vertex v0, sf::Vertex v1, sf::Vertex v2, sf::Vertex v3)
 {
 	m_vertices.push_back(v0);
 	m_vertices.push_back(v1);
 	m_vertices.push_back(v2);
 	m_vertices.push_back(v3);
 
-	sf::Uint16 i = m_vertices.size() - 4u;
-	m_quads.push_back(std::make_shared<TileQuad>(i, i + 1, i + 2, i + 3));
-
-	_updateAABB(v0.position, v2.position);
+	Quad q = { static_cast<uint32>(m_vertices.size() - 4u), 0u };
+	m_quads.push_back(q);
+	m_cellsDirty = true;
 
-	return m_quads.back();
+	return TileQuad(this, m_quads.size() - 1);
 }
 
-void LayerSet::cull(const sf::FloatRect& bounds)
+void LayerSet::addTiles(const uint8* vertexData, uint32 vertexCount)
 {
-	if (bounds.contains(m_boundingBox.left, m_boundingBox.top) ||
-		bounds.contains(m_boundingBox.width, m_boundingBox.height) ||
-		m_boundingBox.contains(bounds.left, bounds.top) ||
-		m_boundingBox.contains(bounds.left + bounds.width, bounds.top + bounds.height))
+	vertexCount -= vertexCount % 4u;
+	if (vertexCount == 0)
+		return;
+
+	uint32 first = m_vertices.size();
+	m_vertices.resize(m_vertices.size() + vertexCount);
+	std::memcpy(&m_vertices[first], vertexData, vertexCount * sizeof(sf::Vertex));
+
+	m_quads.reserve(m_quads.size() + vertexCount / 4u);
+	for (uint32 i = first; i < m_vertices.size(); i += 4u)
 	{
-		m_visible = true;
+		Quad q = { i, 0u };
+		m_quads.push_back(q);
 	}
-	else
+
+	m_cellsDirty = true;
+}
+
+TileQuad LayerSet::getQuad(uint32 position)
+{
+	_buildCells();
+
+	// quads of sets read from precompiled maps never leave their place
+	if (position < m_quads.size() && m_quads[position].first == position * 4u)
+		return TileQuad(this, position);
+
+	for (uint32 i = 0; i < m_quads.size(); ++i)
+		if (m_quads[i].first == position * 4u)
+			return TileQuad(this, i);
+
+	return TileQuad();
+}
+
+int32 LayerSet::findQuad(const TileQuad& quad) const
+{
+	if (quad.getLayerSet() != this || quad.getIndex() >= m_quads.size())
+		return -1;
+
+	_buildCells();
+	return m_quads[quad.getIndex()].first / 4u;
+}
+
+void LayerSet::moveQuad(uint32 index, const sf::Vector2f& distance)
+{
+	Quad& q = m_quads[index];
+	if (q.move)
 	{
-		m_visible = false;
+		m_moves[q.move - 1].distance += distance;
+		return;
 	}
+
+	Move move = { index, distance };
+	m_moves.push_back(move);
+	q.move = m_moves.size();
+}
+
+void LayerSet::addAnimatedQuad(uint32 index, uint32 animation, sf::Uint32 gid)
+{
+	AnimatedQuad quad = { index, animation, gid };
+	m_animatedQuads.push_back(quad);
+}
+
+void LayerSet::setQuadTexCoords(uint32 index, const sf::Vector2f* texCoords)
+{
+	const Quad& q = m_quads[index];
+	for (uint32 i = 0; i < 4u; ++i)
+		m_vertices[q.first + i].texCoords = texCoords[i];
+
+	// sets waiting for a full upload get the new coordinates with it
+	if (!m_cellsDirty && !m_bufferDirty && m_buffer.getVertexCount() == m_vertices.size())
+		m_buffer.update(&m_vertices[q.first], 4u, q.first);
+}
+
+const std::vector<sf::Vertex>& LayerSet::getVertices() const
+{
+	_buildCells();
+	_updateQuads();
+	return m_vertices;
+}
+
+void LayerSet::cull(const sf::FloatRect& bounds)
+{
+	m_cullBounds = bounds;
+	m_culled = true;
+}
+
+void LayerSet::setVertexBuffersEnabled(bool enabled)
+{
+	s_vertexBuffersEnabled = enabled;
+}
+
+bool LayerSet::vertexBuffersEnabled()
+{
+	return s_vertexBuffersEnabled && sf::VertexBuffer::isAvailable();
+}
+
+const sf::FloatRect& LayerSet::getBoundingBox() const
+{
+	_buildCells();
+	_updateQuads();
+	return m_boundingBox;
 }
 
 void LayerSet::draw(sf::RenderTarget& target, sf::RenderStates states) const
 {
-	for (auto& q : m_quads)
+	_buildCells();
+	_updateBuffer();
+	_updateQuads();
+
+	sf::FloatRect bounds = m_cullBounds;
+	if (!m_culled)
 	{
-		if (q->m_needsUpdate)
-		{
-			for (auto& i : q->m_indices)
-				m_vertices[i].position += q->m_movement;
+		const sf::View& view = target.getView();
+		bounds = sf::FloatRect(view.getCenter() - view.getSize() / 2.f, view.getSize());
+	}
+
+	m_culled = false;
+
+	if (m_vertices.empty() || !bounds.intersects(m_boundingBox))
+		return;
 
-			q->m_needsUpdate = false;
+	states.texture = &m_texture;
+
+	// visible cells next to each other in the vertex array are drawn in one call
+	uint32 first = 0;
+	uint32 count = 0;
+	for (const auto& cell : m_cells)
+	{
+		if (!bounds.intersects(cell.bounds))
+			continue;
+
+		if (first + count == cell.first)
+		{
+			count += cell.count;
+			continue;
 		}
+
+		_drawRange(target, states, first, count);
+		first = cell.first;
+		count = cell.count;
 	}
 
-	if (!m_vertices.empty() && m_visible)
+	_drawRange(target, states, first, count);
+}
+
+void LayerSet::_drawRange(sf::RenderTarget& target, const sf::RenderStates& states, uint32 first, uint32 count) const
+{
+	if (count == 0)
+		return;
+
+	if (m_buffer.getVertexCount() == m_vertices.size())
+		target.draw(m_buffer, first, count, states);
+	else
+		target.draw(&m_vertices[first], static_cast<unsigned int>(count), sf::Quads, states);
+
+	s_drawnVertices += count;
+}
+
+void LayerSet::_updateQuads() const
+{
+	for (const auto& move : m_moves)
 	{
-		states.texture = &m_texture;
-		target.draw(&m_vertices[0], static_cast<unsigned int>(m_vertices.size()), sf::Quads, states);
+		Quad& q = m_quads[move.quad];
+		for (uint32 i = q.first; i < q.first + 4u; ++i)
+			m_vertices[i].position += move.distance;
+
+		q.move = 0;
+
+		if (m_cellsDirty)
+			continue;
+
+		if (!m_bufferDirty && m_buffer.getVertexCount() == m_vertices.size())
+			m_buffer.update(&m_vertices[q.first], 4u, q.first);
+
+		// quads stay in the cell they were sorted into, the cell grows to keep covering them
+		sf::FloatRect bounds = quadBounds(&m_vertices[q.first]);
+		uint32 cell = m_cells.size() - 1;
+		while (cell > 0 && m_cells[cell].first > q.first)
+			cell--;
+
+		expandRect(m_cells[cell].bounds, bounds);
+		expandRect(m_boundingBox, bounds);
 	}
+
+	m_moves.clear();
 }
 
-void LayerSet::_updateAABB(sf::Vector2f position, sf::Vector2f size)
+void LayerSet::_updateBuffer() const
 {
-	if (m_boundingBox.width == 0.f)
+	if (!m_bufferDirty)
+		return;
+
+	// pending movement goes into the upload instead of partial updates
+	_updateQuads();
+	m_bufferDirty = false;
+
+	if (!vertexBuffersEnabled() || m_vertices.empty())
+	{
+		m_buffer.create(0);
+		return;
+	}
+
+	if (!m_buffer.create(m_vertices.size()) || !m_buffer.update(&m_vertices[0]))
 	{
-		// not been set yet so take on initial size
-		m_boundingBox = sf::FloatRect(position, size);
+		PRINT_WARNING << "Failed to create vertex buffer of " << m_vertices.size() << " vertices, using vertex arrays" << std::endl;
+		m_buffer.create(0);
+	}
+}
+
+void LayerSet::_buildCells() const
+{
+	if (!m_cellsDirty)
+		return;
+
+	m_cellsDirty = false;
+	m_bufferDirty = true;
+	m_cells.clear();
+	m_boundingBox = sf::FloatRect();
+	if (m_quads.empty())
 		return;
+
+	// row major cell of the top left corner of every quad
+	struct CellKey
+	{
+		int32 y;
+		int32 x;
+		uint32 quad;
+
+		bool operator<(const CellKey& other) const
+		{
+			return y < other.y || (y == other.y && x < other.x);
+		}
+	};
+
+	std::vector<CellKey> keys(m_quads.size());
+	for (uint32 i = 0; i < m_quads.size(); ++i)
+	{
+		sf::FloatRect bounds = quadBounds(&m_vertices[m_quads[i].first]);
+		keys[i].y = static_cast<int32>(std::floor(bounds.top / CELL_SIZE));
+		keys[i].x = static_cast<int32>(std::floor(bounds.left / CELL_SIZE));
+		keys[i].quad = i;
 	}
 
-	if (position.x < m_boundingBox.left)
-		m_boundingBox.left = position.x;
+	// stable so quads of a cell keep their drawing order
+	std::stable_sort(keys.begin(), keys.end());
 
-	if (position.y < m_boundingBox.top)
-		m_boundingBox.top = position.y;
+	// quads keep their index, only their vertices move. The vertices are
+	// permuted in place so large sets are not copied while sorting.
+	std::vector<uint32> source(keys.size());
+	for (uint32 i = 0; i < keys.size(); ++i)
+	{
+		Quad& q = m_quads[keys[i].quad];
+		source[i] = q.first / 4u;
+		q.first = i * 4u;
+	}
+
+	for (uint32 i = 0; i < source.size(); ++i)
+	{
+		if (source[i] == i)
+			continue;
 
-	if (size.x > m_boundingBox.left + m_boundingBox.width)
-		m_boundingBox.width = size.x - m_boundingBox.left;
+		// follow the cycle starting at i, each slot takes the quad it is sorted to
+		sf::Vertex quad[4];
+		std::copy(&m_vertices[i * 4u], &m_vertices[i * 4u] + 4u, quad);
+		uint32 slot = i;
+		while (source[slot] != i)
+		{
+			uint32 next = source[slot];
+			std::copy(&m_vertices[next * 4u], &m_vertices[next * 4u] + 4u, &m_vertices[slot * 4u]);
+			source[slot] = slot;
+			slot = next;
+		}
+
+		std::copy(quad, quad + 4u, &m_vertices[slot * 4u]);
+		source[slot] = slot;
+	}
 
-	if (size.y > m_boundingBox.top + m_boundingBox.height)
-		m_boundingBox.height = size.y - m_boundingBox.top;
+	for (uint32 i = 0; i < keys.size(); ++i)
+	{
+		uint32 first = i * 4u;
+		sf::FloatRect bounds = quadBounds(&m_vertices[first]);
+		if (i == 0 || keys[i - 1] < keys[i])
+		{
+			Cell cell = { bounds, first, 0 };
+			m_cells.push_back(cell);
+		}
+
+		m_cells.back().count += 4u;
+		expandRect(m_cells.back().bounds, bounds);
+
+		if (i == 0)
+			m_boundingBox = bounds;
+		else
+			expandRect(m_boundingBox, bounds);
+	}
 }
 
 MapLayer::MapLayer(MapLayerType type) :
@@ -121,6 +396,9 @@ void MapLayer::draw(sf::RenderTarget& target, sf::RenderStates states) const
 	for (const auto& ls : layerSets)
 		target.draw(*ls.second, states);
 
+	if (chunks)
+		target.draw(*chunks, states);
+
 	if (type == ImageLayer)
 		for (const auto& tile : tiles)
 			target.draw(tile.sprite, tile.states);
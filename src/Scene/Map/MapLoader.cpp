@@ -1,6 +1,9 @@
 #include <Scene/Map/MapLoader.h>
+#include <Scene/Map/TileDecoder.h>
+#include <Scene/Map/TextScanner.h>
 
-#include <zlib.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 MapLoader::MapLoader(const std::string& mapDirectory) :
 	m_width(1u),
@@ -10,7 +13,10 @@ MapLoader::MapLoader(const std::string& mapDirectory) :
 	m_tileRatio(1.f),
 	m_mapLoaded(false),
 	m_quadTreeAvailable(false),
-	m_failedImage(false)
+	m_useSpatialHash(false),
+	m_failedImage(false),
+	m_streamed(false),
+	m_chunkSize(0)
 {
 	// reserve some space to help reduce reallocations
 	m_layers.reserve(10);
@@ -18,11 +24,42 @@ MapLoader::MapLoader(const std::string& mapDirectory) :
 	addSearchPath(mapDirectory);
 }
 
-bool MapLoader::load(const std::string& map)
+MapLoader::LayerSlot::LayerSlot(const pugi::xml_node& n) :
+	node(n),
+	parsed(false)
+{
+}
+
+MapLoader::~MapLoader()
+{
+	// chunk jobs read the tile info, they have to finish before it is released
+	_unload();
+}
+
+bool MapLoader::load(const std::string& map, bool useBinary)
 {
 	std::string mapPath = m_searchPaths[0] + _fileFromPath(map);
 	_unload();
 
+	m_loadTimings = LoadTimings();
+	sf::Clock clock;
+
+	boost::filesystem::path binaryPath(mapPath.c_str());
+	if (binaryPath.extension().string() == MapBinary::EXTENSION)
+	{
+		m_mapLoaded = _loadBinary(mapPath, false);
+		m_loadTimings.binary = clock.getElapsedTime();
+		return m_mapLoaded;
+	}
+
+	// precompiled map is used while the files it was made from are unchanged
+	binaryPath.replace_extension(MapBinary::EXTENSION);
+	if (useBinary && boost::filesystem::exists(binaryPath) && _loadBinary(binaryPath.string(), true))
+	{
+		m_loadTimings.binary = clock.getElapsedTime();
+		return m_mapLoaded = true;
+	}
+
 	// parse map xml, return on error
 	pugi::xml_document mapDoc;
 	pugi::xml_parse_result result = mapDoc.load_file(mapPath.c_str());
@@ -33,6 +70,8 @@ bool MapLoader::load(const std::string& map)
 		return m_mapLoaded = false;
 	}
 
+	m_sourceFiles.push_back(mapPath);
+
 	// set map properties
 	pugi::xml_node mapNode = mapDoc.child("map");
 	if (!mapNode)
@@ -43,49 +82,60 @@ bool MapLoader::load(const std::string& map)
 
 	if (!(m_mapLoaded = _parseMapNode(mapNode)))
 		return false;
+
+	m_loadTimings.parse = clock.restart();
+
 	if (!(m_mapLoaded = _parseTileSets(mapNode)))
 		return false;
 
-	// actually we need to traverse map node children and parse each layer as found
-	pugi::xml_node currentNode = mapNode.first_child();
-	while (currentNode)
+	m_loadTimings.tilesets = clock.restart();
+
+	std::vector<LayerSlot> slots;
+	for (pugi::xml_node node = mapNode.first_child(); node; node = node.next_sibling())
 	{
-		std::string name = currentNode.name();
-		if (name == "layer")
-		{
-			PRINT_DEBUG << "Calling _parseLayer()..." << std::endl;
-			if (!(m_mapLoaded = _parseLayer(currentNode)))
-			{
-				_unload();
-				return false;
-			}
-		}
-		else if (name == "imageLayer")
+		std::string name = node.name();
+		if (name == "layer" || name == "imageLayer" || name == "objectgroup")
+			slots.push_back(LayerSlot(node));
+	}
+
+	// tile layers and object groups only read the map and tileset info,
+	// each one is decoded into its own slot
+	JobSystem::parallelFor(slots.size(), 1, [this, &slots](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; ++i)
+			_parseLayerSlot(slots[i]);
+	});
+
+	m_loadTimings.layers = clock.restart();
+
+	// image layers create textures so they are parsed here, layers keep the document order
+	for (auto& slot : slots)
+	{
+		if (std::string(slot.node.name()) == "imageLayer")
 		{
 			PRINT_DEBUG << "Calling _parseImageLayer()..." << std::endl;
-			if (!(m_mapLoaded = _parseImageLayer(currentNode)))
-			{
-				_unload();
-				return false;
-			}
+			slot.parsed = _parseImageLayer(slot.node);
 		}
-		else if (name == "objectgroup")
+		else if (slot.parsed && slot.layer)
 		{
-			PRINT_DEBUG << "Calling _parseObjectGroup()..." << std::endl;
-			if (!(m_mapLoaded = _parseObjectGroup(currentNode)))
-			{
-				_unload();
-				return false;
-			}
+			m_layers.push_back(std::move(*slot.layer));
 		}
 
-		currentNode = currentNode.next_sibling();
+		if (!(m_mapLoaded = slot.parsed))
+		{
+			_unload();
+			return false;
+		}
 	}
 
 	_createDebugGrid();
 
+	m_loadTimings.assembly = clock.restart();
+
 	PRINT_DEBUG << "Parsed " << m_layers.size() << " layers." << std::endl;
-	PRINT_DEBUG << "Loaded " << map << " successfully." << std::endl;
+	PRINT_DEBUG << "Loaded " << map << " successfully in " << (m_loadTimings.parse + m_loadTimings.tilesets + m_loadTimings.layers + m_loadTimings.assembly).asMilliseconds() << "ms"
+		<< " (parse " << m_loadTimings.parse.asMilliseconds() << "ms, tilesets " << m_loadTimings.tilesets.asMilliseconds()
+		<< "ms, layers " << m_loadTimings.layers.asMilliseconds() << "ms, assembly " << m_loadTimings.assembly.asMilliseconds() << "ms)" << std::endl;
 
 	return m_mapLoaded = true;
 }
@@ -105,18 +155,109 @@ void MapLoader::addSearchPath(const std::string& path)
 
 void MapLoader::updateQuadTree(const sf::FloatRect& rootArea)
 {
-	m_rootNode.clear(rootArea);
+	std::size_t objectCount = 0;
+	for (const auto& layer : m_layers)
+		objectCount += layer.objects.size();
+
+	// the hash is not bounded, only map objects are replaced so indexed game objects stay
+	if (m_useSpatialHash)
+	{
+		if (!m_quadTreeAvailable || objectCount != m_spatialHash.getObjectCount())
+		{
+			m_spatialHash.clearMapObjects();
+			for (const auto& layer : m_layers)
+				for (const auto& object : layer.objects)
+					m_spatialHash.insert(object);
+
+			m_quadTreeAvailable = true;
+			return;
+		}
+
+		for (const auto& layer : m_layers)
+			for (const auto& object : layer.objects)
+				m_spatialHash.update(object);
+
+		return;
+	}
+
+	// the tree is only rebuilt for a new area or when objects were added or removed,
+	// otherwise objects that moved are reinserted
+	if (!m_quadTreeAvailable || rootArea != m_rootNode.getBounds() || objectCount != m_rootNode.getObjectCount())
+	{
+		m_rootNode.clear(rootArea);
+		for (const auto& layer : m_layers)
+			for (const auto& object : layer.objects)
+				m_rootNode.insert(object);
+
+		m_quadTreeAvailable = true;
+		return;
+	}
+
 	for (const auto& layer : m_layers)
 		for (const auto& object : layer.objects)
-			m_rootNode.insert(object);
+			m_rootNode.update(object);
+}
+
+void MapLoader::setQuadTreeSettings(const QuadTreeSettings& settings)
+{
+	m_quadTreeSettings = settings;
+}
 
-	m_quadTreeAvailable = true;
+const QuadTreeSettings& MapLoader::getQuadTreeSettings() const
+{
+	return m_quadTreeSettings;
 }
 
 std::vector<MapObject*> MapLoader::queryQuadTree(const sf::FloatRect& testArea)
 {
 	assert(m_quadTreeAvailable);
-	return m_rootNode.retrieve(testArea);
+	return m_useSpatialHash ? m_spatialHash.retrieve(testArea) : m_rootNode.retrieve(testArea);
+}
+
+void MapLoader::queryQuadTree(const sf::FloatRect& testArea, std::vector<MapObject*>& results)
+{
+	assert(m_quadTreeAvailable);
+	if (m_useSpatialHash)
+		m_spatialHash.retrieve(testArea, results);
+	else
+		m_rootNode.retrieve(testArea, results);
+}
+
+void MapLoader::queryPoint(const sf::Vector2f& point, std::vector<MapObject*>& results)
+{
+	assert(m_quadTreeAvailable);
+	if (m_useSpatialHash)
+		m_spatialHash.retrieve(point, results);
+	else
+		m_rootNode.retrieve(point, results);
+}
+
+void MapLoader::raycast(const sf::Vector2f& origin, const sf::Vector2f& direction, float length, std::vector<MapObject*>& results)
+{
+	assert(m_quadTreeAvailable);
+	if (m_useSpatialHash)
+		m_spatialHash.raycast(origin, direction, length, results);
+	else
+		m_rootNode.raycast(origin, direction, length, results);
+}
+
+void MapLoader::queryNearest(const sf::Vector2f& point, uint32 count, std::vector<MapObject*>& results)
+{
+	assert(m_quadTreeAvailable);
+	if (m_useSpatialHash)
+		m_spatialHash.nearest(point, count, results);
+	else
+		m_rootNode.nearest(point, count, results);
+}
+
+bool MapLoader::usesSpatialHash() const
+{
+	return m_useSpatialHash;
+}
+
+SpatialHash& MapLoader::getSpatialHash()
+{
+	return m_spatialHash;
 }
 
 std::vector<MapLayer>& MapLoader::getLayers()
@@ -146,7 +287,7 @@ void MapLoader::draw(sf::RenderTarget& target, MapLayer::DrawType type, bool deb
 		}
 		break;
 	case MapLayer::Debug:
-		for (auto layer : m_layers)
+		for (const auto& layer : m_layers)
 		{
 			if (layer.type == ObjectGroup)
 			{
@@ -156,7 +297,10 @@ void MapLoader::draw(sf::RenderTarget& target, MapLayer::DrawType type, bool deb
 			}
 		}
 		target.draw(m_gridVertices);
-		target.draw(m_rootNode);
+		if (m_useSpatialHash)
+			target.draw(m_spatialHash);
+		else
+			target.draw(m_rootNode);
 		break;
 	}
 }
@@ -206,6 +350,200 @@ bool MapLoader::quadTreeAvailable() const
 	return m_quadTreeAvailable;
 }
 
+const MapLoader::LoadTimings& MapLoader::getLoadTimings() const
+{
+	return m_loadTimings;
+}
+
+const TileTable& MapLoader::getTileTable() const
+{
+	return m_tileTable;
+}
+
+bool MapLoader::isSolid(uint32 x, uint32 y) const
+{
+	for (const auto& layer : m_layers)
+		if (layer.collision.isSolid(x, y))
+			return true;
+
+	return false;
+}
+
+MapLoader::StreamingSettings::StreamingSettings() :
+	enabled(false),
+	chunkSize(32u),
+	loadRadius(1u),
+	hysteresis(1u),
+	memoryBudget(64u * 1024u * 1024u)
+{
+}
+
+void MapLoader::setStreamingSettings(const StreamingSettings& settings)
+{
+	m_streaming = settings;
+}
+
+const MapLoader::StreamingSettings& MapLoader::getStreamingSettings() const
+{
+	return m_streaming;
+}
+
+bool MapLoader::isStreamed() const
+{
+	return m_streamed;
+}
+
+void MapLoader::updateStreaming(const sf::View& view)
+{
+	if (!m_streamed)
+		return;
+
+	sf::FloatRect viewBounds(view.getCenter() - view.getSize() / 2.f, view.getSize());
+	sf::Vector2f chunkExtent(static_cast<float>(m_chunkSize * m_tileWidth), static_cast<float>(m_chunkSize * m_tileHeight));
+
+	sf::Vector2f loadBorder = chunkExtent * static_cast<float>(m_streaming.loadRadius);
+	sf::FloatRect loadBounds(viewBounds.left - loadBorder.x, viewBounds.top - loadBorder.y,
+		viewBounds.width + loadBorder.x * 2.f, viewBounds.height + loadBorder.y * 2.f);
+
+	sf::Vector2f keepBorder = chunkExtent * static_cast<float>(m_streaming.loadRadius + m_streaming.hysteresis);
+	sf::FloatRect keepBounds(viewBounds.left - keepBorder.x, viewBounds.top - keepBorder.y,
+		viewBounds.width + keepBorder.x * 2.f, viewBounds.height + keepBorder.y * 2.f);
+
+	std::size_t memory = 0;
+	for (auto& layer : m_layers)
+	{
+		if (!layer.chunks)
+			continue;
+
+		ChunkedLayer& chunks = *layer.chunks;
+		chunks.update();
+
+		float opacity = layer.opacity;
+		for (uint32 i = 0; i < chunks.getChunkCount(); ++i)
+		{
+			const TileChunk& chunk = chunks.getChunk(i);
+			if (chunk.state == TileChunk::Unloaded && loadBounds.intersects(chunk.area))
+			{
+				chunks.load(i, [this, opacity](const ChunkedLayer& c, uint32 x, uint32 y, TileChunk::Data& data)
+				{
+					_buildChunk(c, opacity, x, y, data);
+				});
+			}
+			else if (chunk.state == TileChunk::Loaded && !keepBounds.intersects(chunk.area))
+			{
+				chunks.unload(i);
+			}
+		}
+
+		memory += chunks.getMemory();
+	}
+
+	if (memory <= m_streaming.memoryBudget)
+		return;
+
+	// over budget, drop the chunks outside the load area furthest from the view first
+	sf::Vector2f centre = view.getCenter();
+	std::vector<std::pair<float, std::pair<ChunkedLayer*, uint32>>> candidates;
+	for (auto& layer : m_layers)
+	{
+		if (!layer.chunks)
+			continue;
+
+		for (uint32 i = 0; i < layer.chunks->getChunkCount(); ++i)
+		{
+			const TileChunk& chunk = layer.chunks->getChunk(i);
+			if (chunk.state != TileChunk::Loaded || loadBounds.intersects(chunk.area))
+				continue;
+
+			sf::Vector2f d(chunk.area.left + chunk.area.width / 2.f - centre.x, chunk.area.top + chunk.area.height / 2.f - centre.y);
+			candidates.push_back(std::make_pair(d.x * d.x + d.y * d.y, std::make_pair(layer.chunks.get(), i)));
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(),
+		[](const std::pair<float, std::pair<ChunkedLayer*, uint32>>& a, const std::pair<float, std::pair<ChunkedLayer*, uint32>>& b)->bool { return a.first > b.first; });
+
+	for (auto& c : candidates)
+	{
+		if (memory <= m_streaming.memoryBudget)
+			break;
+
+		ChunkedLayer* chunks = c.second.first;
+		std::size_t before = chunks->getMemory();
+		chunks->unload(c.second.second);
+		memory -= before - chunks->getMemory();
+	}
+
+	if (memory > m_streaming.memoryBudget)
+		PRINT_WARNING << "Chunks around the view need " << memory << " bytes, over the streaming budget of " << m_streaming.memoryBudget << std::endl;
+}
+
+void MapLoader::updateAnimations(const sf::Time& elapsed)
+{
+	if (m_animations.empty())
+		return;
+
+	m_animationTime += elapsed;
+	sf::Int32 time = m_animationTime.asMilliseconds();
+
+	bool changed = false;
+	for (auto& animation : m_animations)
+	{
+		sf::Int32 t = time % animation.length;
+		uint32 frame = 0;
+		while (t >= animation.frames[frame].duration)
+			t -= animation.frames[frame++].duration;
+
+		animation.changed = frame != animation.currentFrame;
+		animation.currentFrame = frame;
+		changed |= animation.changed;
+	}
+
+	sf::Vector2f texCoords[4];
+	for (auto& layer : m_layers)
+	{
+		if (changed)
+		{
+			for (auto& ls : layer.layerSets)
+			{
+				for (const auto& quad : ls.second->getAnimatedQuads())
+				{
+					const TileAnimation& animation = m_animations[quad.animation];
+					if (!animation.changed)
+						continue;
+
+					// the frame is shown with the flip flags of the placed tile
+					_tileTexCoords(animation.frames[animation.currentFrame].gid | (quad.gid & ~_resolveRotation(quad.gid).first), texCoords);
+					ls.second->setQuadTexCoords(quad.quad, texCoords);
+				}
+			}
+		}
+
+		if (!layer.chunks)
+			continue;
+
+		for (uint32 i = 0; i < layer.chunks->getChunkCount(); ++i)
+		{
+			TileChunk& chunk = layer.chunks->getChunk(i);
+			if (chunk.state != TileChunk::Loaded || chunk.data->animated.empty())
+				continue;
+
+			TileChunk::Data& data = *chunk.data;
+			for (const auto& tile : data.animated)
+			{
+				const TileAnimation& animation = m_animations[tile.animation];
+				if (!animation.changed && data.animationsCurrent)
+					continue;
+
+				_tileTexCoords(animation.frames[animation.currentFrame].gid | (tile.gid & ~_resolveRotation(tile.gid).first), texCoords);
+				data.setTexCoords(tile, texCoords);
+			}
+
+			data.animationsCurrent = true;
+		}
+	}
+}
+
 MapLoader::TileInfo::TileInfo() :
 	tilesetId(0u)
 {
@@ -223,12 +561,26 @@ MapLoader::TileInfo::TileInfo(const sf::IntRect& r, const sf::Vector2f& s, sf::U
 
 void MapLoader::_unload()
 {
+	_waitForChunks();
+
 	m_tilesetTextures.clear();
 	m_tileInfo.clear();
+	m_tileTable.clear();
+	m_animations.clear();
+	m_animatedTiles.clear();
+	m_animationTime = sf::Time::Zero;
 	m_layers.clear();
 	m_imageLayerTextures.clear();
+	m_gridVertices.clear();
+	m_sourceFiles.clear();
+	m_tilesetImages.clear();
+	m_imageLayerImages.clear();
+	m_properties.clear();
+	m_streamed = false;
+	m_maxTileSize = sf::Vector2f();
 	m_mapLoaded = false;
 	m_quadTreeAvailable = false;
+	m_spatialHash.clearMapObjects();
 	m_failedImage = false;
 }
 
@@ -264,6 +616,12 @@ bool MapLoader::_parseMapNode(const pugi::xml_node& mapNode)
 		return false;
 	}
 
+	if (!fitsTileLimit(m_width, m_height))
+	{
+		PRINT_ERROR << "Map of " << m_width << "x" << m_height << " tiles is larger than " << MAX_TILES << " tiles. Map not loaded." << std::endl;
+		return false;
+	}
+
 	// parse orientation property
 	std::string orientation = mapNode.attribute("orientation").as_string();
 
@@ -296,6 +654,14 @@ bool MapLoader::_parseMapNode(const pugi::xml_node& mapNode)
 		}
 	}
 
+	// big maps keep their tile layers in chunks loaded around the view
+	m_streamed = m_streaming.enabled || (m_properties.count("streaming") && m_properties["streaming"] == "true");
+	m_chunkSize = m_streaming.chunkSize;
+	if (m_properties.count("chunksize") && std::atoi(m_properties["chunksize"].c_str()) > 0)
+		m_chunkSize = std::atoi(m_properties["chunksize"].c_str());
+
+	_applySpatialIndexSettings();
+
 	return true;
 }
 
@@ -313,7 +679,10 @@ bool MapLoader::_parseTileSets(const pugi::xml_node& mapNode)
 	// empty vertex tile
 	m_tileInfo.push_back(TileInfo());
 
-	// parse tile sets in order so GUIDs match index
+	// external tsx documents stay open until their tiles are processed
+	std::vector<std::unique_ptr<pugi::xml_document>> tsxDocs;
+	std::vector<pugi::xml_node> tilesetNodes;
+
 	while (tileset)
 	{
 		// if source attribute parse external tsx
@@ -322,13 +691,13 @@ bool MapLoader::_parseTileSets(const pugi::xml_node& mapNode)
 			// try loading tsx
 			std::string file = _fileFromPath(tileset.attribute("source").as_string());
 			std::string path;
-			pugi::xml_document tsxDoc;
+			std::unique_ptr<pugi::xml_document> tsxDoc(new pugi::xml_document());
 			pugi::xml_parse_result result;
 
 			for (auto& p : m_searchPaths)
 			{
 				path = p + file;
-				result = tsxDoc.load_file(path.c_str());
+				result = tsxDoc->load_file(path.c_str());
 				if (result)
 					break;
 			}
@@ -342,54 +711,59 @@ bool MapLoader::_parseTileSets(const pugi::xml_node& mapNode)
 				return false;
 			}
 
-			// try parsing tileset node
-			pugi::xml_node ts = tsxDoc.child("tileset");
+			m_sourceFiles.push_back(path);
 
-			if (!_processTiles(ts))
-				return false;
+			// try parsing tileset node
+			tilesetNodes.push_back(tsxDoc->child("tileset"));
+			tsxDocs.push_back(std::move(tsxDoc));
 		}
 		else // try for tmx map file data
 		{
-			if (!_processTiles(tileset))
-				return false;
+			tilesetNodes.push_back(tileset);
 		}
 
 		// move on to next tileset node
 		tileset = tileset.next_sibling("tileset");
 	}
 
-	return true;
-}
-
-bool MapLoader::_processTiles(const pugi::xml_node& tilesetNode)
-{
-	sf::Uint16 tileWidth, tileHeight, spacing, margin;
+	// decoding the images takes most of the time, they are loaded in parallel
+	// and processed in order afterwards so GUIDs match index
+	std::vector<sf::Image> images(tilesetNodes.size());
+	std::vector<uint8> loaded(tilesetNodes.size(), 0u);
+	JobSystem::parallelFor(tilesetNodes.size(), 1, [this, &tilesetNodes, &images, &loaded](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; ++i)
+			loaded[i] = _loadTilesetImage(tilesetNodes[i], images[i]);
+	});
 
-	// try and parse tile sizes
-	if (!(tileWidth = tilesetNode.attribute("tilewidth").as_int()) || 
-		!(tileHeight = tilesetNode.attribute("tileheight").as_int()))
+	for (uint32 i = 0; i < tilesetNodes.size(); ++i)
 	{
-		PRINT_ERROR << "Invalid tileset data found. Map not loaded." << std::endl;
-		_unload();
-		return false;
+		if (!loaded[i])
+		{
+			_unload();
+			return false;
+		}
+
+		if (!_processTiles(tilesetNodes[i], images[i]))
+			return false;
 	}
 
-	spacing = (tilesetNode.attribute("spacing")) ? tilesetNode.attribute("spacing").as_int() : 0u;
-	margin = (tilesetNode.attribute("margin")) ? tilesetNode.attribute("margin").as_int() : 0u;
+	return true;
+}
 
+bool MapLoader::_loadTilesetImage(const pugi::xml_node& tilesetNode, sf::Image& image) const
+{
 	// try parsing image node
 	pugi::xml_node imageNode;
 	if (!(imageNode = tilesetNode.child("image")) || !imageNode.attribute("source"))
 	{
 		PRINT_ERROR << "Missing image data in tmx file. Map not loaded." << std::endl;
-		_unload();
 		return false;
 	}
 
 	// process image from disk
 	std::string imageName = _fileFromPath(imageNode.attribute("source").as_string());
-	sf::Image sourceImage = _loadImage(imageName);
-	if (m_failedImage)
+	if (!_readImage(imageName, image))
 	{
 		PRINT_ERROR << "Failed to load image " << imageName << std::endl;
 		PRINT_ERROR << "Please check image exists and add any external paths with addSearchPath()" << std::endl;
@@ -398,12 +772,43 @@ bool MapLoader::_processTiles(const pugi::xml_node& tilesetNode)
 
 	// add transparency mask from color if it exists
 	if (imageNode.attribute("trans"))
-		sourceImage.createMaskFromColor(_colorFromHex(imageNode.attribute("trans").as_string()));
+		image.createMaskFromColor(_colorFromHex(imageNode.attribute("trans").as_string()));
+
+	return true;
+}
+
+bool MapLoader::_processTiles(const pugi::xml_node& tilesetNode, const sf::Image& sourceImage)
+{
+	sf::Uint16 tileWidth, tileHeight, spacing, margin;
+
+	// try and parse tile sizes
+	if (!(tileWidth = tilesetNode.attribute("tilewidth").as_int()) || 
+		!(tileHeight = tilesetNode.attribute("tileheight").as_int()))
+	{
+		PRINT_ERROR << "Invalid tileset data found. Map not loaded." << std::endl;
+		_unload();
+		return false;
+	}
+
+	spacing = (tilesetNode.attribute("spacing")) ? tilesetNode.attribute("spacing").as_int() : 0u;
+	margin = (tilesetNode.attribute("margin")) ? tilesetNode.attribute("margin").as_int() : 0u;
+
+	// image was loaded by _loadTilesetImage, the mask is already applied
+	pugi::xml_node imageNode = tilesetNode.child("image");
+	std::string imageName = _fileFromPath(imageNode.attribute("source").as_string());
+
+	ImageSource source;
+	source.name = imageName;
+	source.hasTrans = imageNode.attribute("trans");
+	if (source.hasTrans)
+		source.trans = _colorFromHex(imageNode.attribute("trans").as_string());
 
 	// store image as a texture for drawing with vertex array
 	sf::Texture tileset;
 	tileset.loadFromImage(sourceImage);
 	m_tilesetTextures.push_back(tileset);
+	m_tilesetImages.push_back(source);
+	_addImageSourceFile(imageName);
 
 	// parse offset node if it exists - TODO store somewhere tileset info can be referenced
 	sf::Vector2u offset;
@@ -413,9 +818,8 @@ bool MapLoader::_processTiles(const pugi::xml_node& tilesetNode)
 		offset.y = (offsetNode.attribute("y")) ? offsetNode.attribute("y").as_uint() : 0u;
 	}
 
-	// TODO parse any tile properties and store with offset above
-
 	// slice into tiles
+	sf::Uint32 firstGid = m_tileInfo.size();
 	int columns = (sourceImage.getSize().x - margin) / (tileWidth + spacing);
 	int rows = (sourceImage.getSize().y - margin) / (tileHeight + spacing);
 
@@ -435,24 +839,97 @@ bool MapLoader::_processTiles(const pugi::xml_node& tilesetNode)
 			m_tileInfo.push_back(TileInfo(rect,
 								 sf::Vector2f(static_cast<float>(rect.width), static_cast<float>(rect.height)),
 								 m_tilesetTextures.size() - 1u));
+
+			m_maxTileSize.x = std::max(m_maxTileSize.x, m_tileInfo.back().size.x);
+			m_maxTileSize.y = std::max(m_maxTileSize.y, m_tileInfo.back().size.y);
 		}
 	}
 
+	// properties and collision shapes of tiles, tile ids are relative to the tileset
+	m_tileTable.resize(m_tileInfo.size());
+	for (pugi::xml_node tileNode : tilesetNode.children("tile"))
+	{
+		sf::Uint32 gid = firstGid + tileNode.attribute("id").as_uint();
+		if (gid >= m_tileInfo.size() || !m_tileTable.parseTile(gid, tileNode))
+			PRINT_WARNING << "Tileset " << imageName << " has data for missing tile " << tileNode.attribute("id").as_uint() << std::endl;
+	}
+
+	_parseTileAnimations(tilesetNode, firstGid);
+
 	PRINT_ERROR << "Processed " << imageName << std::endl;
 	return true;
 }
 
-bool MapLoader::_parseLayer(const pugi::xml_node& layerNode)
+void MapLoader::_parseTileAnimations(const pugi::xml_node& tilesetNode, sf::Uint32 firstGid)
 {
-	PRINT_DEBUG << "Found standard map layer " << layerNode.attribute("name").as_string() << std::endl;
+	for (pugi::xml_node tileNode : tilesetNode.children("tile"))
+	{
+		pugi::xml_node animationNode = tileNode.child("animation");
+		if (!animationNode)
+			continue;
 
-	MapLayer layer(Layer);
-	if (layerNode.attribute("name"))
-		layer.name = layerNode.attribute("name").as_string();
-	if (layerNode.attribute("opacity"))
-		layer.opacity = layerNode.attribute("opacity").as_float();
-	if (layerNode.attribute("visible"))
-		layer.visible = layerNode.attribute("visible").as_bool();
+		TileAnimation animation;
+		animation.length = 0;
+		animation.currentFrame = 0;
+		animation.changed = false;
+		for (pugi::xml_node frameNode : animationNode.children("frame"))
+		{
+			TileAnimation::Frame frame;
+			frame.gid = firstGid + frameNode.attribute("tileid").as_uint();
+			frame.duration = std::max(frameNode.attribute("duration").as_int(), 1);
+			if (frame.gid >= m_tileInfo.size())
+			{
+				PRINT_WARNING << "Animation frame uses missing tile " << frameNode.attribute("tileid").as_uint() << std::endl;
+				continue;
+			}
+
+			animation.frames.push_back(frame);
+			animation.length += frame.duration;
+		}
+
+		if (animation.frames.empty())
+			continue;
+
+		m_animatedTiles[firstGid + tileNode.attribute("id").as_uint()] = m_animations.size();
+		m_animations.push_back(animation);
+	}
+}
+
+void MapLoader::_parseLayerSlot(LayerSlot& slot)
+{
+	std::string name = slot.node.name();
+	if (name == "layer")
+	{
+		PRINT_DEBUG << "Calling _parseLayer()..." << std::endl;
+		slot.layer.reset(new MapLayer(Layer));
+		slot.parsed = _parseLayer(slot.node, *slot.layer);
+	}
+	else if (name == "objectgroup")
+	{
+		// groups without objects are left out
+		if (!slot.node.child("object"))
+		{
+			PRINT_ERROR << "Object group contains no objects" << std::endl;
+			slot.parsed = true;
+			return;
+		}
+
+		PRINT_DEBUG << "Calling _parseObjectGroup()..." << std::endl;
+		slot.layer.reset(new MapLayer(ObjectGroup));
+		slot.parsed = _parseObjectGroup(slot.node, *slot.layer);
+	}
+}
+
+bool MapLoader::_parseLayer(const pugi::xml_node& layerNode, MapLayer& layer)
+{
+	PRINT_DEBUG << "Found standard map layer " << layerNode.attribute("name").as_string() << std::endl;
+
+	if (layerNode.attribute("name"))
+		layer.name = layerNode.attribute("name").as_string();
+	if (layerNode.attribute("opacity"))
+		layer.opacity = layerNode.attribute("opacity").as_float();
+	if (layerNode.attribute("visible"))
+		layer.visible = layerNode.attribute("visible").as_bool();
 
 	pugi::xml_node dataNode;
 	if (!(dataNode = layerNode.child("data")))
@@ -461,55 +938,53 @@ bool MapLoader::_parseLayer(const pugi::xml_node& layerNode)
 		return false;
 	}
 
+	if (m_streamed)
+		layer.chunks = _createChunkedLayer(m_chunkSize);
+
+	layer.collision.create(m_width, m_height);
+
 	// decode and decompress data first if necessary
 	// see https://github.com/bjorn/tiled/wiki/TMX-Map-Format#data
 	// for explanation of bytestream retrieved when using compression
 	if (dataNode.attribute("encoding"))
 	{
 		std::string encoding = dataNode.attribute("encoding").as_string();
-		std::string data = dataNode.text().as_string();
 
 		if (encoding == "base64")
 		{
 			PRINT_DEBUG << "Found Base64 encoded layer data, decoding..." << std::endl;
-			// remove any newlines or white space created by tab spaces in document
-			std::stringstream ss;
-			ss << data;
-			ss >> data;
-			data = base64_decode(data);
-
-			// calculate the expected size of the uncompressed string
-			int expectedSize = m_width * m_height * 4;
-			std::vector<unsigned char> byteArray;
-			byteArray.reserve(expectedSize);
-
-			// check for compression (only used with base64 encoded data)
-			if (dataNode.attribute("compression"))
-			{
-				std::string compression = dataNode.attribute("compression").as_string();
-				PRINT_DEBUG << "Found " << compression << " compressd layer data, decompressing..." << std::endl;
 
-				// decompress with zlib
-				int dataSize = data.length() * sizeof(unsigned char);
-				if (!_decompress(data.c_str(), byteArray, dataSize, expectedSize))
-				{
-					PRINT_ERROR << "Failed to decompress map data. Map not loaded." << std::endl;
-					return false;
-				}
+			// decode straight from the document text, whitespace around the data is skipped
+			const char* text = dataNode.text().get();
+			std::size_t length = std::strlen(text);
+			std::vector<uint8> bytes(TileDecoder::base64Size(length));
+			std::size_t byteCount = 0;
+			if (!TileDecoder::decodeBase64(text, length, bytes.data(), byteCount))
+			{
+				PRINT_ERROR << "Failed to decode map data. Map not loaded." << std::endl;
+				return false;
 			}
-			else // uncompressed
+
+			// compressed data is inflated straight into the tile ids, whose size is known
+			const std::size_t expectedSize = (std::size_t)(m_width) * m_height * 4;
+			std::vector<uint8> tileData(expectedSize);
+			TileDecoder::Compression compression = TileDecoder::compressionFromString(dataNode.attribute("compression").as_string());
+			if (compression != TileDecoder::None)
+				PRINT_DEBUG << "Found " << dataNode.attribute("compression").as_string() << " compressed layer data, decompressing..." << std::endl;
+			if (!TileDecoder::decompress(compression, bytes.data(), byteCount, tileData.data(), expectedSize))
 			{
-				byteArray.insert(byteArray.end(), data.begin(), data.end());
+				PRINT_ERROR << "Failed to decompress map data. Map not loaded." << std::endl;
+				return false;
 			}
 
 			// extract tile GIDs using bitshift
-			sf::Uint16 x, y;
+			uint32 x, y;
 			x = y = 0;
-			for (int i = 0; i < expectedSize - 3; i += 4)
+			for (std::size_t i = 0; i < expectedSize; i += 4)
 			{
-				sf::Uint32 tileGID = byteArray[i] | byteArray[i+1] << 8 | byteArray[i+2] << 16 | byteArray[i+3] << 24;
+				sf::Uint32 tileGID = tileData[i] | tileData[i+1] << 8 | tileData[i+2] << 16 | tileData[i+3] << 24;
 
-				_addTileToLayer(layer, x, y, tileGID);
+				_setLayerTile(layer, x, y, tileGID);
 
 				++x;
 				if (x == m_width)
@@ -523,23 +998,17 @@ bool MapLoader::_parseLayer(const pugi::xml_node& layerNode)
 		{
 			PRINT_DEBUG << "CSV encoded layer data found." << std::endl;
 
-			std::vector<sf::Uint32> tileGIDs;
-			std::stringstream datastream(data);
-
-			sf::Uint32 i;
-			while (datastream >> i)
-			{
-				tileGIDs.push_back(i);
-				if (datastream.peek() == ',')
-					datastream.ignore();
-			}
-
-			// create tiles from IDs
-			sf::Uint16 x, y;
+			// create tiles from IDs read straight from the document text
+			TextScanner scanner(dataNode.text().get());
+			const std::size_t tileCount = (std::size_t)(m_width) * m_height;
+			std::size_t count = 0;
+			uint32 x, y;
 			x = y = 0;
-			for (unsigned int i = 0; i < tileGIDs.size(); ++i)
+			sf::Uint32 gid;
+			while (count < tileCount && scanner.read(gid))
 			{
-				_addTileToLayer(layer, x, y, tileGIDs[i]);
+				_setLayerTile(layer, x, y, gid);
+				count++;
 				++x;
 				if (x == m_width)
 				{
@@ -547,6 +1016,12 @@ bool MapLoader::_parseLayer(const pugi::xml_node& layerNode)
 					++y;
 				}
 			}
+
+			if (scanner.failed())
+			{
+				PRINT_ERROR << "Invalid CSV layer data found. Map not loaded." << std::endl;
+				return false;
+			}
 		}
 		else
 		{
@@ -564,13 +1039,13 @@ bool MapLoader::_parseLayer(const pugi::xml_node& layerNode)
 			return false;
 		}
 
-		sf::Uint16 x, y;
+		uint32 x, y;
 		x = y = 0;
 		while (tileNode)
 		{
 			sf::Uint32 gid = tileNode.attribute("gid").as_uint();
 
-			_addTileToLayer(layer, x, y, gid);
+			_setLayerTile(layer, x, y, gid);
 
 			tileNode = tileNode.next_sibling("tile");
 			x++;
@@ -590,23 +1065,14 @@ bool MapLoader::_parseLayer(const pugi::xml_node& layerNode)
 	if (m_orientation == Isometric)
 		_setIsometricCoords(layer);
 
-	m_layers.push_back(layer);
 	return true;
 }
 
-bool MapLoader::_parseObjectGroup(const pugi::xml_node& groupNode)
+bool MapLoader::_parseObjectGroup(const pugi::xml_node& groupNode, MapLayer& layer)
 {
 	PRINT_ERROR << "Found object layer " << groupNode.attribute("name").as_string() << std::endl;
 
-	pugi::xml_node objectNode;
-	if (!(objectNode = groupNode.child("object")))
-	{
-		PRINT_ERROR << "Object group contains no objects" << std::endl;
-		return true;
-	}
-
-	// add layer to map layers
-	MapLayer layer(ObjectGroup);
+	pugi::xml_node objectNode = groupNode.child("object");
 
 	layer.name = groupNode.attribute("name").as_string();
 	if (groupNode.attribute("opacity"))
@@ -620,7 +1086,6 @@ bool MapLoader::_parseObjectGroup(const pugi::xml_node& groupNode)
 		if (!objectNode.attribute("x") || !objectNode.attribute("y"))
 		{
 			PRINT_ERROR << "Object missing position data. Map not loaded." << std::endl;
-			_unload();
 			return false;
 		}
 
@@ -674,34 +1139,17 @@ bool MapLoader::_parseObjectGroup(const pugi::xml_node& groupNode)
 			else
 				object.setShapeType(Polyline);
 
-			// split coords into pairs
-			if (objectNode.first_child().attribute("points"))
+			// points are x,y pairs separated by spaces, read straight from the attribute
+			if (pugi::xml_attribute pointsAttribute = objectNode.first_child().attribute("points"))
 			{
 				PRINT_DEBUG << "Processing poly shape points..." << std::endl;
-				std::string pointlist = objectNode.first_child().attribute("points").as_string();
-				std::stringstream stream(pointlist);
-				std::vector<std::string> points;
-				std::string pointstring;
-
-				while (std::getline(stream, pointstring, ' '))
-					points.push_back(pointstring);
+				TextScanner scanner(pointsAttribute.value());
+				sf::Vector2f point;
+				while (scanner.read(point.x) && scanner.read(point.y))
+					object.addPoint(isometricToOrthogonal(point));
 
-				// parse each pair into sf::Vector2i
-				for (unsigned int i = 0; i < points.size(); ++i)
-				{
-					std::vector<float> coords;
-					std::stringstream coordstream(points[i]);
-
-					float j;
-					while (coordstream >> j)
-					{
-						coords.push_back(j);
-						if (coordstream.peek() == ',')
-							coordstream.ignore();
-					}
-
-					object.addPoint(isometricToOrthogonal(sf::Vector2f(coords[0], coords[1])));
-				}
+				if (scanner.failed())
+					PRINT_ERROR << "Invalid points for polygon or polyline" << std::endl;
 			}
 			else
 			{
@@ -744,8 +1192,8 @@ bool MapLoader::_parseObjectGroup(const pugi::xml_node& groupNode)
 			PRINT_DEBUG << "Found object with tile GID " << gid << std::endl;
 
 			object.move(0.f, static_cast<float>(-m_tileHeight));
-			const sf::Uint16 x = static_cast<sf::Uint16>(object.getPosition().x / m_tileWidth);
-			const sf::Uint16 y = static_cast<sf::Uint16>(object.getPosition().y / m_tileHeight);
+			const uint32 x = static_cast<uint32>(object.getPosition().x / m_tileWidth);
+			const uint32 y = static_cast<uint32>(object.getPosition().y / m_tileHeight);
 
 			sf::Vector2f offset(object.getPosition().x - (x * m_tileWidth), (object.getPosition().y - (y * m_tileHeight)));
 			object.setQuad(_addTileToLayer(layer, x, y, gid, offset));
@@ -791,7 +1239,6 @@ bool MapLoader::_parseObjectGroup(const pugi::xml_node& groupNode)
 		objectNode = objectNode.next_sibling("object");
 	}
 
-	m_layers.push_back(layer);
 	PRINT_DEBUG << "Processed " << layer.objects.size() << " objects" << std::endl;
 	return true;
 }
@@ -817,14 +1264,23 @@ bool MapLoader::_parseImageLayer(const pugi::xml_node& imageLayerNode)
 		return false;
 	}
 
+	ImageSource source;
+	source.name = imageName;
+	source.hasTrans = imageNode.attribute("trans");
+
 	// set transparency if required
-	if (imageNode.attribute("trans"))
-		image.createMaskFromColor(_colorFromHex(imageNode.attribute("trans").as_string()));
+	if (source.hasTrans)
+	{
+		source.trans = _colorFromHex(imageNode.attribute("trans").as_string());
+		image.createMaskFromColor(source.trans);
+	}
 
 	// load image to texture
 	sf::Texture texture;
 	texture.loadFromImage(image);
 	m_imageLayerTextures.push_back(texture);
+	m_imageLayerImages.push_back(source);
+	_addImageSourceFile(imageName);
 
 	// add texture to layer as sprite, set layer properties
 	MapTile tile;
@@ -867,42 +1323,692 @@ bool MapLoader::_parseLayerProperties(const pugi::xml_node& propertiesNode, MapL
 	}
 }
 
-TileQuad::Ptr MapLoader::_addTileToLayer(MapLayer& layer, sf::Uint16 x, sf::Uint16 y, sf::Uint32 gid, const sf::Vector2f& offset)
+bool MapLoader::saveBinary(const std::string& path) const
+{
+	if (!m_mapLoaded)
+	{
+		PRINT_ERROR << "No map loaded, cannot save " << path << std::endl;
+		return false;
+	}
+
+	BinaryWriter writer;
+
+	MapBinary::Header header;
+	header.magic = MapBinary::MAGIC;
+	header.version = MapBinary::VERSION;
+	header.vertexSize = sizeof(sf::Vertex);
+	header.sourceCount = m_sourceFiles.size();
+	writer.write(header);
+
+	for (const auto& file : m_sourceFiles)
+	{
+		boost::system::error_code ec;
+		uint64_t size = boost::filesystem::file_size(file, ec);
+		int64_t time = ec ? 0 : boost::filesystem::last_write_time(file, ec);
+
+		writer.writeString(file);
+		writer.write(ec ? (uint64_t)(0) : size);
+		writer.write(time);
+	}
+
+	writer.write(m_width);
+	writer.write(m_height);
+	writer.write(m_tileWidth);
+	writer.write(m_tileHeight);
+	writer.write((uint8)(m_orientation));
+	writer.write(m_tileRatio);
+
+	writer.write((uint32)(m_properties.size()));
+	for (const auto& p : m_properties)
+	{
+		writer.writeString(p.first);
+		writer.writeString(p.second);
+	}
+
+	writer.write((uint32)(m_tilesetImages.size()));
+	for (const auto& image : m_tilesetImages)
+	{
+		writer.writeString(image.name);
+		writer.write((uint8)(image.hasTrans));
+		writer.write(image.trans);
+	}
+
+	writer.writeArray(m_tileInfo.data(), m_tileInfo.size());
+	m_tileTable.write(writer);
+
+	// animations are written in order, layer sets refer to them by index
+	std::vector<sf::Uint32> animatedTiles(m_animations.size());
+	for (const auto& tile : m_animatedTiles)
+		animatedTiles[tile.second] = tile.first;
+
+	writer.write((uint32)(m_animations.size()));
+	for (uint32 i = 0; i < m_animations.size(); ++i)
+	{
+		writer.write(animatedTiles[i]);
+		writer.writeArray(m_animations[i].frames.data(), m_animations[i].frames.size());
+	}
+
+	writer.write((uint32)(m_imageLayerImages.size()));
+	for (const auto& image : m_imageLayerImages)
+	{
+		writer.writeString(image.name);
+		writer.write((uint8)(image.hasTrans));
+		writer.write(image.trans);
+	}
+
+	writer.write((uint32)(m_layers.size()));
+	for (const auto& layer : m_layers)
+		_writeBinaryLayer(writer, layer);
+
+	std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		PRINT_ERROR << "Failed to open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	const std::vector<uint8>& data = writer.getData();
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+	return file.good();
+}
+
+void MapLoader::_applySpatialIndexSettings()
+{
+	// maps with many or clustered objects can tune the tree, invalid values keep the defaults
+	QuadTreeSettings settings = m_quadTreeSettings;
+	if (m_properties.count("quadtreecapacity") && std::atoi(m_properties["quadtreecapacity"].c_str()) > 0)
+		settings.capacity = std::atoi(m_properties["quadtreecapacity"].c_str());
+	if (m_properties.count("quadtreedepth") && std::atoi(m_properties["quadtreedepth"].c_str()) > 0)
+		settings.maxDepth = std::atoi(m_properties["quadtreedepth"].c_str());
+	if (m_properties.count("quadtreelooseness") && std::atof(m_properties["quadtreelooseness"].c_str()) >= 1.0)
+		settings.looseness = static_cast<float>(std::atof(m_properties["quadtreelooseness"].c_str()));
+
+	m_rootNode.setSettings(settings);
+
+	// maps of evenly spread, tile sized objects are faster with the spatial hash,
+	// its cells cover two tiles unless the map sets "spatialhashcellsize"
+	m_useSpatialHash = m_properties.count("spatialindex") && getPropertyString("spatialindex") == "hash";
+	float cellSize = 2.f * std::max(m_tileWidth, m_tileHeight);
+	if (m_properties.count("spatialhashcellsize") && std::atof(m_properties["spatialhashcellsize"].c_str()) > 0.0)
+		cellSize = static_cast<float>(std::atof(m_properties["spatialhashcellsize"].c_str()));
+
+	m_spatialHash.setCellSize(cellSize);
+	m_quadTreeAvailable = false;
+}
+
+bool MapLoader::_loadBinary(const std::string& path, bool checkSources)
+{
+	// the file is mapped so vertex data is copied straight from the page cache
+	try
+	{
+		boost::interprocess::file_mapping mapping(path.c_str(), boost::interprocess::read_only);
+		boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+
+		BinaryReader reader(static_cast<const uint8*>(region.get_address()), region.get_size());
+		if (!_readBinary(reader, checkSources))
+		{
+			_unload();
+			return false;
+		}
+	}
+	catch (const boost::interprocess::interprocess_exception& e)
+	{
+		PRINT_ERROR << "Failed to map " << path << ": " << e.what() << std::endl;
+		_unload();
+		return false;
+	}
+
+	_createDebugGrid();
+
+	PRINT_DEBUG << "Loaded " << m_layers.size() << " layers from precompiled map " << path << std::endl;
+
+	return true;
+}
+
+bool MapLoader::_readBinary(BinaryReader& reader, bool checkSources)
 {
-	sf::Uint8 opacity = static_cast<sf::Uint8>(255.f * layer.opacity);
-	sf::Color color = sf::Color(255u, 255u, 255u, opacity);
+	MapBinary::Header header;
+	if (!reader.read(header) || header.magic != MapBinary::MAGIC)
+	{
+		PRINT_ERROR << "Not a precompiled map" << std::endl;
+		return false;
+	}
+
+	if (header.version != MapBinary::VERSION || header.vertexSize != sizeof(sf::Vertex))
+	{
+		PRINT_DEBUG << "Precompiled map has version " << header.version << ", expected " << MapBinary::VERSION << std::endl;
+		return false;
+	}
+
+	for (uint32 i = 0; i < header.sourceCount; ++i)
+	{
+		std::string file;
+		uint64_t size;
+		int64_t time;
+		if (!reader.readString(file) || !reader.read(size) || !reader.read(time))
+			return false;
+
+		if (checkSources)
+		{
+			boost::system::error_code ec;
+			uint64_t currentSize = boost::filesystem::file_size(file, ec);
+			int64_t currentTime = ec ? 0 : boost::filesystem::last_write_time(file, ec);
+			if (ec || currentSize != size || currentTime != time)
+			{
+				PRINT_DEBUG << "Precompiled map is older than " << file << ", parsing tmx" << std::endl;
+				return false;
+			}
+		}
+
+		m_sourceFiles.push_back(file);
+	}
+
+	uint8 orientation;
+	reader.read(m_width);
+	reader.read(m_height);
+	reader.read(m_tileWidth);
+	reader.read(m_tileHeight);
+	reader.read(orientation);
+	reader.read(m_tileRatio);
+	m_orientation = (MapOrientation)(orientation);
+
+	if (!fitsTileLimit(m_width, m_height))
+	{
+		PRINT_ERROR << "Precompiled map of " << m_width << "x" << m_height << " tiles is too large" << std::endl;
+		return false;
+	}
+
+	uint32 count = 0;
+	reader.read(count);
+	for (uint32 i = 0; i < count && !reader.failed(); ++i)
+	{
+		std::string name, value;
+		reader.readString(name);
+		reader.readString(value);
+		m_properties[name] = value;
+	}
+
+	_applySpatialIndexSettings();
+
+	// all textures are loaded before the layers keep references to them
+	count = 0;
+	reader.read(count);
+	m_tilesetTextures.reserve(count);
+	for (uint32 i = 0; i < count && !reader.failed(); ++i)
+	{
+		ImageSource source;
+		uint8 hasTrans;
+		reader.readString(source.name);
+		reader.read(hasTrans);
+		reader.read(source.trans);
+		source.hasTrans = hasTrans != 0;
+
+		m_tilesetTextures.push_back(sf::Texture());
+		m_tilesetImages.push_back(source);
+		if (!_loadImageSource(source, m_tilesetTextures.back()))
+			return false;
+	}
+
+	const uint8* tileInfo = reader.readArray<TileInfo>(count);
+	m_tileInfo.resize(count);
+	if (count)
+		std::memcpy(&m_tileInfo[0], tileInfo, count * sizeof(TileInfo));
+
+	for (const auto& info : m_tileInfo)
+	{
+		m_maxTileSize.x = std::max(m_maxTileSize.x, info.size.x);
+		m_maxTileSize.y = std::max(m_maxTileSize.y, info.size.y);
+	}
+
+	if (!m_tileTable.read(reader) || m_tileTable.getTileCount() != m_tileInfo.size())
+	{
+		PRINT_ERROR << "Precompiled map has an invalid tile table" << std::endl;
+		return false;
+	}
+
+	count = 0;
+	reader.read(count);
+	m_animations.reserve(count);
+	for (uint32 i = 0; i < count && !reader.failed(); ++i)
+	{
+		sf::Uint32 gid = 0;
+		uint32 frameCount;
+		reader.read(gid);
+		const uint8* frames = reader.readArray<TileAnimation::Frame>(frameCount);
+		if (frameCount == 0)
+		{
+			PRINT_ERROR << "Precompiled map has an animation without frames" << std::endl;
+			return false;
+		}
+
+		// vertices were saved with any frame, the first update replaces it
+		TileAnimation animation;
+		animation.frames.resize(frameCount);
+		std::memcpy(&animation.frames[0], frames, frameCount * sizeof(TileAnimation::Frame));
+		animation.length = 0;
+		animation.currentFrame = frameCount;
+		animation.changed = false;
+		for (const auto& frame : animation.frames)
+		{
+			if (frame.gid >= m_tileInfo.size() || frame.duration <= 0)
+			{
+				PRINT_ERROR << "Precompiled map has an invalid animation frame" << std::endl;
+				return false;
+			}
+
+			animation.length += frame.duration;
+		}
+
+		m_animatedTiles[gid] = m_animations.size();
+		m_animations.push_back(animation);
+	}
+
+	count = 0;
+	reader.read(count);
+	m_imageLayerTextures.reserve(count);
+	for (uint32 i = 0; i < count && !reader.failed(); ++i)
+	{
+		ImageSource source;
+		uint8 hasTrans;
+		reader.readString(source.name);
+		reader.read(hasTrans);
+		reader.read(source.trans);
+		source.hasTrans = hasTrans != 0;
+
+		m_imageLayerTextures.push_back(sf::Texture());
+		m_imageLayerImages.push_back(source);
+		if (!_loadImageSource(source, m_imageLayerTextures.back()))
+			return false;
+	}
+
+	count = 0;
+	reader.read(count);
+	m_layers.reserve(count);
+	for (uint32 i = 0; i < count; ++i)
+		if (!_readBinaryLayer(reader))
+			return false;
+
+	if (reader.failed())
+	{
+		PRINT_ERROR << "Precompiled map is truncated" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool MapLoader::_readBinaryLayer(BinaryReader& reader)
+{
+	uint8 type, visible;
+	reader.read(type);
+
+	MapLayer layer((MapLayerType)(type));
+	reader.readString(layer.name);
+	reader.read(layer.opacity);
+	reader.read(visible);
+	layer.visible = visible != 0;
+
+	uint32 count = 0;
+	reader.read(count);
+	for (uint32 i = 0; i < count && !reader.failed(); ++i)
+	{
+		std::string name, value;
+		reader.readString(name);
+		reader.readString(value);
+		layer.properties[name] = value;
+	}
+
+	count = 0;
+	reader.read(count);
+	for (uint32 i = 0; i < count && !reader.failed(); ++i)
+	{
+		sf::Uint16 id = 0;
+		uint32 vertexCount;
+		reader.read(id);
+		const uint8* vertices = reader.readArray<sf::Vertex>(vertexCount);
+		if (id >= m_tilesetTextures.size())
+		{
+			PRINT_ERROR << "Layer " << layer.name << " uses missing tileset " << id << std::endl;
+			return false;
+		}
+
+		LayerSet& set = *(layer.layerSets[id] = std::make_shared<LayerSet>(m_tilesetTextures[id]));
+		set.addTiles(vertices, vertexCount);
+
+		// animated quads are stored by their position in the vertices
+		uint32 animatedCount;
+		const uint8* animated = reader.readArray<LayerSet::AnimatedQuad>(animatedCount);
+		for (uint32 a = 0; a < animatedCount; ++a)
+		{
+			LayerSet::AnimatedQuad quad;
+			std::memcpy(&quad, animated + a * sizeof(LayerSet::AnimatedQuad), sizeof(LayerSet::AnimatedQuad));
+
+			TileQuad tileQuad = set.getQuad(quad.quad);
+			if (tileQuad.isValid() && quad.animation < m_animations.size())
+				set.addAnimatedQuad(tileQuad.getIndex(), quad.animation, quad.gid);
+		}
+	}
+
+	// streamed layers keep tile ids, their vertices are built per chunk
+	uint8 chunked = 0;
+	reader.read(chunked);
+	if (chunked)
+	{
+		uint32 chunkSize = 0, tileCount;
+		reader.read(chunkSize);
+		const uint8* tiles = reader.readArray<sf::Uint32>(tileCount);
+		if (tileCount != m_width * m_height)
+		{
+			PRINT_ERROR << "Layer " << layer.name << " has " << tileCount << " tiles, expected " << m_width * m_height << std::endl;
+			return false;
+		}
+
+		m_streamed = true;
+		m_chunkSize = chunkSize;
+		layer.chunks = _createChunkedLayer(chunkSize);
+		layer.chunks->setTiles(tiles);
+	}
+
+	uint32 collisionWidth = 0, collisionHeight = 0, wordCount;
+	reader.read(collisionWidth);
+	reader.read(collisionHeight);
+	const uint8* words = reader.readArray<uint32>(wordCount);
+	layer.collision.create(collisionWidth, collisionHeight);
+	if (wordCount != layer.collision.getWords().size())
+	{
+		PRINT_ERROR << "Layer " << layer.name << " has an invalid collision map" << std::endl;
+		return false;
+	}
 
+	layer.collision.setWords(words, wordCount);
+
+	int32 image = -1;
+	reader.read(image);
+	if (image >= (int32)(m_imageLayerTextures.size()))
+		return false;
+
+	if (image >= 0)
+	{
+		MapTile tile;
+		tile.sprite.setTexture(m_imageLayerTextures[image]);
+		tile.sprite.setColor(sf::Color(255u, 255u, 255u, static_cast<sf::Uint8>(255.f * layer.opacity)));
+		layer.tiles.push_back(tile);
+	}
+
+	count = 0;
+	reader.read(count);
+	layer.objects.reserve(count);
+	for (uint32 i = 0; i < count && !reader.failed(); ++i)
+	{
+		MapObject object;
+		std::string name, objectType, parent;
+		sf::Vector2f position, size;
+		uint8 shape, objectVisible;
+		reader.readString(name);
+		reader.readString(objectType);
+		reader.readString(parent);
+		reader.read(position);
+		reader.read(size);
+		reader.read(shape);
+		reader.read(objectVisible);
+
+		// points are stored as they end up after parsing, so they are added
+		// once the object is in place
+		object.setPosition(position);
+		object.setSize(size);
+		object.setShapeType((MapObjectShape)(shape));
+		object.setName(name);
+		object.setType(objectType);
+		object.setParent(parent);
+		object.setVisible(objectVisible != 0);
+
+		uint32 propertyCount = 0;
+		reader.read(propertyCount);
+		for (uint32 p = 0; p < propertyCount && !reader.failed(); ++p)
+		{
+			std::string propertyName, value;
+			reader.readString(propertyName);
+			reader.readString(value);
+			object.setProperty(propertyName, value);
+		}
+
+		uint32 pointCount;
+		const uint8* points = reader.readArray<sf::Vector2f>(pointCount);
+		for (uint32 p = 0; p < pointCount; ++p)
+		{
+			sf::Vector2f point;
+			std::memcpy(&point, points + p * sizeof(sf::Vector2f), sizeof(sf::Vector2f));
+			object.addPoint(point);
+		}
+
+		sf::Color debugColor;
+		int32 quadSet = -1;
+		uint32 quadIndex = 0;
+		reader.read(debugColor);
+		reader.read(quadSet);
+		reader.read(quadIndex);
+
+		if (pointCount)
+		{
+			object.createDebugShape(debugColor);
+			object.createSegments();
+		}
+
+		if (quadSet >= 0 && layer.layerSets.count(quadSet))
+			object.setQuad(layer.layerSets[quadSet]->getQuad(quadIndex));
+
+		layer.objects.push_back(object);
+	}
+
+	if (reader.failed())
+		return false;
+
+	m_layers.push_back(layer);
+	return true;
+}
+
+void MapLoader::_writeBinaryLayer(BinaryWriter& writer, const MapLayer& layer) const
+{
+	writer.write((uint8)(layer.type));
+	writer.writeString(layer.name);
+	writer.write(layer.opacity);
+	writer.write((uint8)(layer.visible));
+
+	writer.write((uint32)(layer.properties.size()));
+	for (const auto& p : layer.properties)
+	{
+		writer.writeString(p.first);
+		writer.writeString(p.second);
+	}
+
+	writer.write((uint32)(layer.layerSets.size()));
+	for (const auto& ls : layer.layerSets)
+	{
+		const std::vector<sf::Vertex>& vertices = ls.second->getVertices();
+		writer.write(ls.first);
+		writer.writeArray(vertices.data(), vertices.size());
+
+		std::vector<LayerSet::AnimatedQuad> animated = ls.second->getAnimatedQuads();
+		for (auto& quad : animated)
+			quad.quad = ls.second->findQuad(TileQuad(ls.second.get(), quad.quad));
+
+		writer.writeArray(animated.data(), animated.size());
+	}
+
+	writer.write((uint8)(layer.chunks ? 1 : 0));
+	if (layer.chunks)
+	{
+		writer.write(layer.chunks->getChunkSize());
+		writer.writeArray(layer.chunks->getTiles().data(), layer.chunks->getTiles().size());
+	}
+
+	writer.write(layer.collision.getWidth());
+	writer.write(layer.collision.getHeight());
+	writer.writeArray(layer.collision.getWords().data(), layer.collision.getWords().size());
+
+	// image layers draw a single sprite of one of the image layer textures
+	int32 image = -1;
+	if (layer.type == ImageLayer && !layer.tiles.empty())
+	{
+		for (uint32 i = 0; i < m_imageLayerTextures.size(); ++i)
+			if (layer.tiles.front().sprite.getTexture() == &m_imageLayerTextures[i])
+				image = i;
+	}
+
+	writer.write(image);
+
+	writer.write((uint32)(layer.objects.size()));
+	for (const auto& object : layer.objects)
+	{
+		writer.writeString(object.getName());
+		writer.writeString(object.getType());
+		writer.writeString(object.getParent());
+		writer.write(object.getPosition());
+		writer.write(object.getSize());
+		writer.write((uint8)(object.getShapeType()));
+		writer.write((uint8)(object.isVisible()));
+
+		writer.write((uint32)(object.getProperties().size()));
+		for (const auto& p : object.getProperties())
+		{
+			writer.writeString(p.first);
+			writer.writeString(p.second);
+		}
+
+		const std::vector<sf::Vector2f>& points = object.polyPoints();
+		writer.writeArray(points.data(), points.size());
+		writer.write(object.getDebugColor());
+
+		// tile objects are linked to their quad by the set and the index in it
+		int32 quadSet = -1;
+		int32 quadIndex = -1;
+		const TileQuad& quad = object.getQuad();
+		for (const auto& ls : layer.layerSets)
+		{
+			if (ls.second.get() == quad.getLayerSet())
+			{
+				quadSet = ls.first;
+				quadIndex = ls.second->findQuad(quad);
+				break;
+			}
+		}
+
+		writer.write(quadSet);
+		writer.write((uint32)(std::max(quadIndex, 0)));
+	}
+}
+
+bool MapLoader::_loadImageSource(const ImageSource& source, sf::Texture& texture)
+{
+	sf::Image image = _loadImage(source.name);
+	if (m_failedImage)
+	{
+		PRINT_ERROR << "Failed to load image " << source.name << std::endl;
+		PRINT_ERROR << "Please check image exists and add any external paths with addSearchPath()" << std::endl;
+		return false;
+	}
+
+	if (source.hasTrans)
+		image.createMaskFromColor(source.trans);
+
+	return texture.loadFromImage(image);
+}
+
+TileQuad MapLoader::_addTileToLayer(MapLayer& layer, uint32 x, uint32 y, sf::Uint32 gid, const sf::Vector2f& offset)
+{
+	sf::Vertex quad[4];
+	sf::Uint16 id = _buildTileQuad(layer.opacity, x, y, gid, offset, quad);
+	if (layer.layerSets.find(id) == layer.layerSets.end())
+	{
+		// create a new layerset for texture
+		layer.layerSets[id] = std::make_shared<LayerSet>(m_tilesetTextures[id]);
+	}
+
+	// add tile to set
+	TileQuad tileQuad = layer.layerSets[id]->addTile(quad[0], quad[1], quad[2], quad[3]);
+
+	int32 animation = _findAnimation(gid);
+	if (animation >= 0)
+		layer.layerSets[id]->addAnimatedQuad(tileQuad.getIndex(), animation, gid);
+
+	return tileQuad;
+}
+
+sf::Uint16 MapLoader::_buildTileQuad(float opacity, uint32 x, uint32 y, sf::Uint32 gid, const sf::Vector2f& offset, sf::Vertex* quad) const
+{
+	sf::Color color = sf::Color(255u, 255u, 255u, static_cast<sf::Uint8>(255.f * opacity));
+
+	const TileInfo& info = m_tileInfo[_resolveRotation(gid).first];
+	sf::Vertex& v0 = quad[0];
+	sf::Vertex& v1 = quad[1];
+	sf::Vertex& v2 = quad[2];
+	sf::Vertex& v3 = quad[3];
+
+	sf::Vector2f texCoords[4];
+	_tileTexCoords(gid, texCoords);
+	v0.texCoords = texCoords[0];
+	v1.texCoords = texCoords[1];
+	v2.texCoords = texCoords[2];
+	v3.texCoords = texCoords[3];
+
+	sf::Vector2f position = _tilePosition(x, y) + offset;
+
+	// offset tiles with size not equal to map grid size
+	position.y += static_cast<float>(m_tileHeight) - static_cast<float>(static_cast<sf::Uint16>(info.size.y));
+
+	v0.position = position;
+	v1.position = position + sf::Vector2f(info.size.x, 0.f);
+	v2.position = position + info.size;
+	v3.position = position + sf::Vector2f(0.f, info.size.y);
+
+	v0.color = color;
+	v1.color = color;
+	v2.color = color;
+	v3.color = color;
+
+	return info.tilesetId;
+}
+
+void MapLoader::_tileTexCoords(sf::Uint32 gid, sf::Vector2f* texCoords) const
+{
 	// get bits and tile id
 	std::pair<sf::Uint32, std::bitset<3>> idAndFlags = _resolveRotation(gid);
-	gid = idAndFlags.first;
-
-	// update the layer's tile set(s)
-	sf::Vertex v0, v1, v2, v3;
+	const TileInfo& info = m_tileInfo[idAndFlags.first];
 
 	// applying half pixel trick avoids artifacting when scrolling
-	v0.texCoords = m_tileInfo[gid].coords[0] + sf::Vector2f(0.5f, 0.5f);
-	v1.texCoords = m_tileInfo[gid].coords[1] + sf::Vector2f(-0.5f, 0.5f);
-	v2.texCoords = m_tileInfo[gid].coords[2] + sf::Vector2f(-0.5f, -0.5f);
-	v3.texCoords = m_tileInfo[gid].coords[3] + sf::Vector2f(0.5f, -0.5f);
+	texCoords[0] = info.coords[0] + sf::Vector2f(0.5f, 0.5f);
+	texCoords[1] = info.coords[1] + sf::Vector2f(-0.5f, 0.5f);
+	texCoords[2] = info.coords[2] + sf::Vector2f(-0.5f, -0.5f);
+	texCoords[3] = info.coords[3] + sf::Vector2f(0.5f, -0.5f);
 
 	// flip texture coordinates according to bits set
-	_doFlips(idAndFlags.second, &v0.texCoords, &v1.texCoords, &v2.texCoords, &v3.texCoords);
+	_doFlips(idAndFlags.second, &texCoords[0], &texCoords[1], &texCoords[2], &texCoords[3]);
+}
 
-	v0.position = sf::Vector2f(static_cast<float>(m_tileWidth * x), static_cast<float>(m_tileHeight * y));
-	v1.position = sf::Vector2f(static_cast<float>(m_tileWidth * x) + m_tileInfo[gid].size.x, static_cast<float>(m_tileHeight * y));
-	v2.position = sf::Vector2f(static_cast<float>(m_tileWidth * x) + m_tileInfo[gid].size.x, static_cast<float>(m_tileHeight * y) + m_tileInfo[gid].size.y);
-	v3.position = sf::Vector2f(static_cast<float>(m_tileWidth * x), static_cast<float>(m_tileHeight * y) + m_tileInfo[gid].size.y);
+int32 MapLoader::_findAnimation(sf::Uint32 gid) const
+{
+	if (m_animatedTiles.empty())
+		return -1;
 
-	// offset tiles with size not equal to map grid size
-	sf::Uint16 tileHeight = static_cast<sf::Uint16>(m_tileInfo[gid].size.y);
-	if (tileHeight != m_tileHeight)
-	{
-		float diff = static_cast<float>(m_tileHeight - tileHeight);
-		v0.position.y += diff;
-		v1.position.y += diff;
-		v2.position.y += diff;
-		v3.position.y += diff;	
-	}
+	auto it = m_animatedTiles.find(_resolveRotation(gid).first);
+	return it != m_animatedTiles.end() ? (int32)(it->second) : -1;
+}
+
+void MapLoader::_setLayerTile(MapLayer& layer, uint32 x, uint32 y, sf::Uint32 gid)
+{
+	if (m_tileTable.isSolid(gid))
+		layer.collision.set(x, y);
+
+	if (layer.chunks)
+		layer.chunks->setTile(x, y, gid);
+	else
+		_addTileToLayer(layer, x, y, gid);
+}
+
+sf::Vector2f MapLoader::_tilePosition(uint32 x, uint32 y) const
+{
+	sf::Vector2f position(static_cast<float>(m_tileWidth * x), static_cast<float>(m_tileHeight * y));
 
 	// adjust position for isometric maps
 	if (m_orientation == Isometric)
@@ -913,31 +2019,100 @@ TileQuad::Ptr MapLoader::_addTileToLayer(MapLayer& layer, sf::Uint16 x, sf::Uint
 		isoOffset.x -= static_cast<float>(m_tileWidth / 2u);
 		isoOffset.y += static_cast<float>(m_tileHeight / 2u);
 
-		v0.position += isoOffset;
-		v1.position += isoOffset;
-		v2.position += isoOffset;
-		v3.position += isoOffset;
+		position += isoOffset;
 	}
 
-	v0.color = color;
-	v1.color = color;
-	v2.color = color;
-	v3.color = color;
+	return position;
+}
 
-	v0.position += offset;
-	v1.position += offset;
-	v2.position += offset;
-	v3.position += offset;
+std::shared_ptr<ChunkedLayer> MapLoader::_createChunkedLayer(uint32 chunkSize)
+{
+	std::shared_ptr<ChunkedLayer> chunks = std::make_shared<ChunkedLayer>(m_width, m_height, chunkSize, m_tilesetTextures);
 
-	sf::Uint16 id = m_tileInfo[gid].tilesetId;
-	if (layer.layerSets.find(id) == layer.layerSets.end())
+	// area of a chunk spans the positions of its corner tiles, padded by the largest
+	// tile so tiles overhanging the grid are included
+	for (uint32 i = 0; i < chunks->getChunkCount(); ++i)
 	{
-		// create a new layerset for texture
-		layer.layerSets[id] = std::make_shared<LayerSet>(m_tilesetTextures[id]);
+		uint32 x0 = (i % chunks->getChunksX()) * chunks->getChunkSize();
+		uint32 y0 = (i / chunks->getChunksX()) * chunks->getChunkSize();
+		uint32 x1 = std::min(x0 + chunks->getChunkSize(), m_width);
+		uint32 y1 = std::min(y0 + chunks->getChunkSize(), m_height);
+
+		sf::Vector2f corners[4] = { _tilePosition(x0, y0), _tilePosition(x1, y0), _tilePosition(x1, y1), _tilePosition(x0, y1) };
+		sf::Vector2f min = corners[0];
+		sf::Vector2f max = corners[0];
+		for (uint32 c = 1; c < 4; ++c)
+		{
+			min.x = std::min(min.x, corners[c].x);
+			min.y = std::min(min.y, corners[c].y);
+			max.x = std::max(max.x, corners[c].x);
+			max.y = std::max(max.y, corners[c].y);
+		}
+
+		min -= m_maxTileSize;
+		max += m_maxTileSize;
+		chunks->getChunk(i).area = sf::FloatRect(min, max - min);
 	}
 
-	// add tile to set
-	return layer.layerSets[id]->addTile(v0, v1, v2, v3);
+	return chunks;
+}
+
+void MapLoader::_buildChunk(const ChunkedLayer& chunks, float opacity, uint32 chunkX, uint32 chunkY, TileChunk::Data& data) const
+{
+	uint32 x0 = chunkX * chunks.getChunkSize();
+	uint32 y0 = chunkY * chunks.getChunkSize();
+	uint32 x1 = std::min(x0 + chunks.getChunkSize(), chunks.getWidth());
+	uint32 y1 = std::min(y0 + chunks.getChunkSize(), chunks.getHeight());
+
+	bool empty = true;
+	sf::Vector2f min, max;
+	for (uint32 y = y0; y < y1; ++y)
+	{
+		for (uint32 x = x0; x < x1; ++x)
+		{
+			// empty cells have no quad, unlike fully loaded layers
+			sf::Uint32 gid = chunks.getTile(x, y);
+			sf::Uint32 id = _resolveRotation(gid).first;
+			if (id == 0u || id >= m_tileInfo.size())
+				continue;
+
+			sf::Vertex quad[4];
+			sf::Uint16 tileset = _buildTileQuad(opacity, x, y, gid, sf::Vector2f(), quad);
+			std::vector<sf::Vertex>& vertices = data.vertices[tileset];
+
+			int32 animation = _findAnimation(gid);
+			if (animation >= 0)
+			{
+				TileChunk::Data::AnimatedTile tile = { tileset, (uint32)(vertices.size()), (uint32)(animation), gid };
+				data.animated.push_back(tile);
+			}
+
+			vertices.insert(vertices.end(), quad, quad + 4);
+
+			if (empty)
+			{
+				min = quad[0].position;
+				max = quad[2].position;
+				empty = false;
+			}
+
+			min.x = std::min(min.x, quad[0].position.x);
+			min.y = std::min(min.y, quad[0].position.y);
+			max.x = std::max(max.x, quad[2].position.x);
+			max.y = std::max(max.y, quad[2].position.y);
+		}
+	}
+
+	data.bounds = sf::FloatRect(min, max - min);
+	for (const auto& set : data.vertices)
+		data.memory += set.second.size() * sizeof(sf::Vertex);
+}
+
+void MapLoader::_waitForChunks()
+{
+	for (auto& layer : m_layers)
+		if (layer.chunks)
+			layer.chunks->waitForJobs();
 }
 
 void MapLoader::_setIsometricCoords(MapLayer& layer)
@@ -963,7 +2138,7 @@ void MapLoader::_drawLayer(sf::RenderTarget& target, MapLayer& layer, bool debug
 	}
 }
 
-std::string MapLoader::_fileFromPath(const std::string& path)
+std::string MapLoader::_fileFromPath(const std::string& path) const
 {
 	assert(!path.empty());
 
@@ -1018,89 +2193,12 @@ sf::Color MapLoader::_colorFromHex(const char* hexStr) const
 	return sf::Color(r, g, b);
 }
 
-bool MapLoader::_decompress(const char* source, std::vector<unsigned char>& dest, int inSize, int expectedSize)
-{
-	if (!source)
-	{
-		PRINT_ERROR << "Input string is empty, decompression failed." << std::endl;
-		return false;
-	}
-
-	int currentSize = expectedSize;
-	// TODO: switch to std::make_unique when compatible with all complilers
-	std::unique_ptr<unsigned char[]> byteArray(new unsigned char[expectedSize / sizeof(unsigned char)]);
-	z_stream stream;
-	stream.zalloc = Z_NULL;
-	stream.zfree = Z_NULL;
-	stream.opaque = Z_NULL;
-	stream.next_in = (Bytef*)source;
-	stream.avail_in = inSize;
-	stream.next_out = (Bytef*)byteArray.get();
-	stream.avail_out = expectedSize;
-
-	if (inflateInit2(&stream, 15 + 32) != Z_OK)
-	{
-		PRINT_ERROR << "inflate 2 failed" << std::endl;
-		return false;
-	}
-
-	int result = 0;
-	do
-	{
-		result = inflate(&stream, Z_SYNC_FLUSH);
-
-		switch (result)
-		{
-			case Z_NEED_DICT:
-			case Z_STREAM_ERROR:
-				result = Z_DATA_ERROR;
-			case Z_DATA_ERROR:
-			case Z_MEM_ERROR:
-				inflateEnd(&stream);
-				PRINT_ERROR << result << std::endl;
-				return false;
-		}
-
-		if (result != Z_STREAM_END)
-		{
-			int oldSize = currentSize;
-			currentSize *= 2;
-			std::unique_ptr<unsigned char[]> newArray(new unsigned char[currentSize / sizeof(unsigned char)]);
-			std::memcpy(newArray.get(), byteArray.get(), currentSize / 2);
-			byteArray = std::move(newArray);
-
-			stream.next_out = (Bytef*)(byteArray.get() + oldSize);
-			stream.avail_out = oldSize;
-		}
-	} while (result != Z_STREAM_END);
-
-	if (stream.avail_in != 0)
-	{
-		PRINT_ERROR << "stream.avail_in is 0" << std::endl;
-		PRINT_ERROR << "zlib compression failed." << std::endl;
-		return false;
-	}
-
-	const int outSize = currentSize - stream.avail_out;
-	inflateEnd(&stream);
-
-	std::unique_ptr<unsigned char[]> newArray(new unsigned char[outSize / sizeof(unsigned char)]);
-	std::memcpy(newArray.get(), byteArray.get(), outSize);
-	byteArray = std::move(newArray);
-
-	// copy bytes to vector
-	int length = currentSize / sizeof(unsigned char);
-	dest.insert(dest.begin(), &byteArray[0], &byteArray[length]);
-
-	return true;
-}
-
 void MapLoader::_createDebugGrid()
 {
 	sf::Color debugColor(0u, 0u, 0u, 120u);
 
 	float mapHeight = static_cast<float>(m_tileHeight * m_height);
-	for (int x = 0; x <= m_width; x += 2)
+	for (uint32 x = 0; x <= m_width; x += 2)
 	{
 		float posX = static_cast<float>(x * (m_tileWidth / m_tileRatio));
 		m_gridVertices.append(sf::Vertex(isometricToOrthogonal(sf::Vector2f(posX, 0.f)), debugColor));
@@ -1115,7 +2213,7 @@ void MapLoader::_createDebugGrid()
 	}
 
 	float mapWidth = static_cast<float>(m_tileWidth * (m_width / m_tileRatio));
-	for (int y = 0; y <= m_height; y += 2)
+	for (uint32 y = 0; y <= m_height; y += 2)
 	{
 		float posY = static_cast<float>(y * m_tileHeight);
 		m_gridVertices.append(sf::Vertex(isometricToOrthogonal(sf::Vector2f(0.f, posY)), debugColor));
@@ -1164,7 +2262,31 @@ sf::Image& MapLoader::_loadImage(const std::string& imageName)
 	return *m_cachedImages[path];
 }
 
-std::vector<unsigned char> MapLoader::_intToBytes(sf::Uint32 paramInt)
+bool MapLoader::_readImage(const std::string& imageName, sf::Image& image) const
+{
+	for (const auto& p : m_searchPaths)
+		if (image.loadFromFile(p + imageName))
+			return true;
+
+	return false;
+}
+
+void MapLoader::_addImageSourceFile(const std::string& imageName)
+{
+	// tile sizes and tex coords in the precompiled map come from the image size
+	for (const auto& p : m_searchPaths)
+	{
+		std::string path = p + imageName;
+		if (boost::filesystem::exists(path))
+		{
+			if (std::find(m_sourceFiles.begin(), m_sourceFiles.end(), path) == m_sourceFiles.end())
+				m_sourceFiles.push_back(path);
+			return;
+		}
+	}
+}
+
+std::vector<unsigned char> MapLoader::_intToBytes(sf::Uint32 paramInt) const
 {
 	std::vector<unsigned char> arrayOfByte(4);
 	for (int i = 0; i < 4; i++)
@@ -1173,7 +2295,7 @@ std::vector<unsigned char> MapLoader::_intToBytes(sf::Uint32 paramInt)
 	return arrayOfByte;
 }
 
-std::pair<sf::Uint32, std::bitset<3>> MapLoader::_resolveRotation(sf::Uint32 gid)
+std::pair<sf::Uint32, std::bitset<3>> MapLoader::_resolveRotation(sf::Uint32 gid) const
 {
 	const unsigned FLIPPED_HORIZONTALLY_FLAG = 0x80000000;
 	const unsigned FLIPPED_VERTICALLY_FLAG = 0x40000000;
@@ -1198,7 +2320,7 @@ std::pair<sf::Uint32, std::bitset<3>> MapLoader::_resolveRotation(sf::Uint32 gid
 	return std::pair<sf::Uint32, std::bitset<3>>(tileGID, b);
 }
 
-void MapLoader::_flipY(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3)
+void MapLoader::_flipY(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3) const
 {
 	// flip Y
 	sf::Vector2f tmp = *v0;
@@ -1208,7 +2330,7 @@ void MapLoader::_flipY(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf:
 	v3->y = v2->y;
 }
 
-void MapLoader::_flipX(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3)
+void MapLoader::_flipX(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3) const
 {
 	// flip X
 	sf::Vector2f tmp = *v0;
@@ -1218,7 +2340,7 @@ void MapLoader::_flipX(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf:
 	v3->x = v0->x;
 }
 
-void MapLoader::_flipD(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3)
+void MapLoader::_flipD(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3) const
 {
 	// flip D
 	sf::Vector2f tmp = *v1;
@@ -1228,7 +2350,7 @@ void MapLoader::_flipD(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf:
 	v3->y = tmp.y;
 }
 
-void MapLoader::_doFlips(std::bitset<3> bits, sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3)
+void MapLoader::_doFlips(std::bitset<3> bits, sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3) const
 {
 	// 000 = no change
     // 001 = vertical = swap y axis
@@ -1288,60 +2410,3 @@ void MapLoader::_doFlips(std::bitset<3> bits, sf::Vector2f *v0, sf::Vector2f *v1
         _flipD(v0,v1,v2,v3);
     }
 }
-
-static const std::string base64_chars =
-				"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-				"abcdefghijklmnopqrstuvwxyz"
-				"0123456789+/";
-
-
-static inline bool is_base64(unsigned char c)
-{
-	return (isalnum(c) || (c == '+') || (c == '/'));
-}
-
-static std::string base64_decode(std::string const& encoded_string)
-{
-	int in_len = encoded_string.size();
-	int i = 0;
-	int j = 0;
-	int in_ = 0;
-	unsigned char char_array_4[4], char_array_3[3];
-	std::string ret;
-
-	while (in_len-- && ( encoded_string[in_] != '=') && is_base64(encoded_string[in_]))
-	{
-		char_array_4[i++] = encoded_string[in_]; in_++;
-		if (i ==4)
-		{
-			for (i = 0; i <4; i++)
-				char_array_4[i] = base64_chars.find(char_array_4[i]);
-
-			char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-			char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-			char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-			for (i = 0; (i < 3); i++)
-				ret += char_array_3[i];
-			i = 0;
-		}
-	}
-
-	if (i)
-	{
-		for (j = i; j <4; j++)
-			char_array_4[j] = 0;
-
-		for (j = 0; j <4; j++)
-			char_array_4[j] = base64_chars.find(char_array_4[j]);
-
-		char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-		char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-		char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-		for (j = 0; (j < i - 1); j++)
-			ret += char_array_3[j];
-	}
-
-	return ret;
-}
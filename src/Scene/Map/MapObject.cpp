@@ -73,8 +73,8 @@ void MapObject::move(const sf::Vector2f& distance)
 	m_position += distance;
 
 	// if object is of type tile move vertex data
-	if (m_tileQuad)
-		m_tileQuad->move(distance);
+	if (m_tileQuad.isValid())
+		m_tileQuad.move(distance);
 }
 
 bool MapObject::contains(sf::Vector2f point) const
@@ -136,6 +136,7 @@ void MapObject::createDebugShape(const sf::Color& color)
 
 	// reset any existing shapes incase new points have been added
 	m_debugShape.reset();
+	m_debugColor = color;
 
 	for (const auto& p : m_polypoints)
 		m_debugShape.addVertex(sf::Vertex(p, color));
@@ -254,7 +255,7 @@ void MapObject::reverseWinding()
 	std::reverse(m_polypoints.begin(), m_polypoints.end());
 }
 
-void MapObject::setQuad(std::shared_ptr<TileQuad> quad)
+void MapObject::setQuad(const TileQuad& quad)
 {
 	m_tileQuad = quad;
 }
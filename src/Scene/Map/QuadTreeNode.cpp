@@ -1,147 +1,360 @@
 #include <Scene/Map/QuadTreeNode.h>
 
-QuadTreeNode::QuadTreeNode(sf::Uint16 level, const sf::FloatRect& bounds) :
-	MAX_OBJECTS(5u),
-	MAX_LEVELS(5u),
-	m_level(level),
-	m_bounds(bounds)
+static bool containsRect(const sf::FloatRect& outer, const sf::FloatRect& inner)
 {
-	m_children.reserve(4);
-	m_debugShape = sf::RectangleShape(sf::Vector2f(bounds.width, bounds.height));
-	m_debugShape.setPosition(bounds.left, bounds.top);
-	m_debugShape.setFillColor(sf::Color::Transparent);
-	m_debugShape.setOutlineColor(sf::Color::Green);
-	m_debugShape.setOutlineThickness(-2.f);
+	return inner.left >= outer.left && inner.top >= outer.top &&
+		inner.left + inner.width <= outer.left + outer.width &&
+		inner.top + inner.height <= outer.top + outer.height;
+}
+
+QuadTreeSettings::QuadTreeSettings() :
+	capacity(5u),
+	maxDepth(5u),
+	looseness(1.f)
+{
+}
+
+QuadTreeRoot::QuadTreeRoot() :
+	m_nodes(1)
+{
+	_resetNode(0, sf::FloatRect(), NONE, 0);
 }
 
 void QuadTreeRoot::clear(const sf::FloatRect& newBounds)
 {
-	m_objects.clear();
-	m_children.clear();
-	m_bounds = newBounds;
-	m_debugShape.setPosition(newBounds.left, newBounds.top);
-	m_debugShape.setSize(sf::Vector2f(newBounds.width, newBounds.height));
+	m_nodes.resize(1);
+	m_freeChildren.clear();
+	m_locations.clear();
+	_resetNode(0, newBounds, NONE, 0);
+}
+
+void QuadTreeRoot::setSettings(const QuadTreeSettings& settings)
+{
+	m_settings = settings;
+	m_settings.capacity = std::max(m_settings.capacity, 1u);
+	m_settings.looseness = std::max(m_settings.looseness, 1.f);
 
-	m_searchDepth = 0u;
-	m_depth = 0;
+	sf::FloatRect bounds = getBounds();
+	clear(bounds);
 }
 
-std::vector<MapObject*> QuadTreeNode::retrieve(const sf::FloatRect& bounds, sf::Uint16& searchDepth)
+void QuadTreeRoot::insert(const MapObject& object)
 {
-	searchDepth = m_level;
-	std::vector<MapObject*> foundObjects;
-	sf::Int16 index = _getIndex(bounds);
+	Location& location = m_locations[&object];
+	location.aabb = object.getAABB();
+	location.node = NONE;
+	if (!SpatialQuery::overlaps(location.aabb, m_nodes[0].bounds))
+		return;
 
-	// recursively add objects of child node if bounds is fully contained
-	if (!m_children.empty() && index != -1)
-	{
-		foundObjects = m_children[index]->retrieve(bounds, searchDepth);
-	}
-	else
+	// deepest existing node whose loose area holds the object
+	uint32 index = 0;
+	for (uint32 child = _childFor(index, location.aabb); child != NONE; child = _childFor(index, location.aabb))
+		index = child;
+
+	_addToNode(index, const_cast<MapObject*>(&object), location);
+}
+
+void QuadTreeRoot::remove(const MapObject& object)
+{
+	auto it = m_locations.find(&object);
+	if (it == m_locations.end())
+		return;
+
+	uint32 index = it->second.node;
+	m_locations.erase(it);
+
+	// objects outside the root area are tracked without a node
+	if (index == NONE)
+		return;
+
+	// order of objects in a node does not matter, the last one takes the place
+	std::vector<MapObject*>& objects = m_nodes[index].objects;
+	auto o = std::find(objects.begin(), objects.end(), &object);
+	if (o != objects.end())
 	{
-		for (auto& child : m_children)
-		{
-			if (bounds.intersects(child->m_bounds))
-			{
-				std::vector<MapObject*> childObjects = child->retrieve(bounds, searchDepth);
-				foundObjects.insert(foundObjects.end(), childObjects.begin(), childObjects.end());
-			}
-		}
+		*o = objects.back();
+		objects.pop_back();
 	}
 
-	// and append objects in this node
-	foundObjects.insert(foundObjects.end(), m_objects.begin(), m_objects.end());
-	m_debugShape.setOutlineColor(sf::Color::Red);
-	return foundObjects;
+	_collapse(index);
 }
 
-void QuadTreeNode::insert(const MapObject& object)
+void QuadTreeRoot::update(const MapObject& object)
 {
-	if (!object.getAABB().intersects(m_bounds))
+	auto it = m_locations.find(&object);
+	if (it == m_locations.end())
+	{
+		insert(object);
+		return;
+	}
+
+	sf::FloatRect aabb = object.getAABB();
+	Location& location = it->second;
+	if (aabb == location.aabb)
 		return;
 
-	if (!m_children.empty())
+	// objects still inside their node and the map area that do not fit a child stay where they are
+	uint32 index = location.node;
+	if (index != NONE && containsRect(m_nodes[index].looseBounds, aabb) && SpatialQuery::overlaps(aabb, m_nodes[0].bounds) && _childFor(index, aabb) == NONE)
 	{
-		sf::Int16 index = _getIndex(object.getAABB());
-		if (index != -1)
-		{
-			m_children[index]->insert(object);
-			return;
-		}
+		location.aabb = aabb;
+		return;
 	}
-	// else add object to this node
-	m_objects.push_back(const_cast<MapObject*>(&object));
 
-	if (m_objects.size() > MAX_OBJECTS && m_level < MAX_LEVELS)
+	remove(object);
+	insert(object);
+}
+
+std::vector<MapObject*> QuadTreeRoot::retrieve(const sf::FloatRect& bounds)
+{
+	std::vector<MapObject*> results;
+	retrieve(bounds, results);
+	return results;
+}
+
+void QuadTreeRoot::retrieve(const sf::FloatRect& bounds, std::vector<MapObject*>& results)
+{
+	visit(bounds, [&results](MapObject& object) { results.push_back(&object); });
+}
+
+void QuadTreeRoot::retrieve(const sf::Vector2f& point, std::vector<MapObject*>& results)
+{
+	retrieve(sf::FloatRect(point.x, point.y, 0.f, 0.f), results);
+}
+
+void QuadTreeRoot::raycast(const sf::Vector2f& origin, const sf::Vector2f& direction, float length, std::vector<MapObject*>& results)
+{
+	m_hits.clear();
+	_raycast(0, origin, SpatialQuery::normalize(direction), length);
+
+	std::sort(m_hits.begin(), m_hits.end());
+	for (const auto& hit : m_hits)
+		results.push_back(hit.second);
+}
+
+void QuadTreeRoot::nearest(const sf::Vector2f& point, uint32 count, std::vector<MapObject*>& results)
+{
+	if (count == 0)
+		return;
+
+	// best first search, nodes are opened by the distance of their loose area
+	// and the closest objects found so far are kept in a max heap
+	std::greater<std::pair<float, uint32>> farther;
+	m_hits.clear();
+	m_queue.clear();
+	m_queue.push_back(std::make_pair(SpatialQuery::distanceSquared(point, m_nodes[0].looseBounds), 0u));
+	while (!m_queue.empty())
 	{
-		if (m_children.empty())
-			_split();
+		std::pop_heap(m_queue.begin(), m_queue.end(), farther);
+		std::pair<float, uint32> next = m_queue.back();
+		m_queue.pop_back();
+
+		// objects of the remaining nodes can not be closer
+		if (m_hits.size() == count && next.first > m_hits.front().first)
+			break;
 
-		sf::Uint16 i = 0;
-		while (i < m_objects.size())
+		const Node& node = m_nodes[next.second];
+		node.retrieved = true;
+		for (MapObject* object : node.objects)
 		{
-			sf::Int16 index = _getIndex(m_objects[i]->getAABB());
-			if (index != -1)
-			{
-				m_children[index]->insert(*m_objects[i]);
-				m_objects.erase(m_objects.begin() + i);
-			}
-			else
+			float distance = SpatialQuery::distanceSquared(point, object->getAABB());
+			if (m_hits.size() == count)
 			{
-				i++;
-				// we only increment i when not erasing, brcause erasing moves
-				// everything up one inside the vector
+				if (distance >= m_hits.front().first)
+					continue;
+
+				std::pop_heap(m_hits.begin(), m_hits.end());
+				m_hits.pop_back();
 			}
+
+			m_hits.push_back(std::make_pair(distance, object));
+			std::push_heap(m_hits.begin(), m_hits.end());
+		}
+
+		if (node.firstChild == NONE)
+			continue;
+
+		for (uint32 child = node.firstChild; child < node.firstChild + 4u; ++child)
+		{
+			m_queue.push_back(std::make_pair(SpatialQuery::distanceSquared(point, m_nodes[child].looseBounds), child));
+			std::push_heap(m_queue.begin(), m_queue.end(), farther);
 		}
 	}
+
+	std::sort_heap(m_hits.begin(), m_hits.end());
+	for (const auto& hit : m_hits)
+		results.push_back(hit.second);
 }
 
-void QuadTreeNode::draw(sf::RenderTarget& target, sf::RenderStates states) const
+void QuadTreeRoot::draw(sf::RenderTarget& target, sf::RenderStates states) const
 {
-	// recursively draw children
-	for (auto& child : m_children)
-		target.draw(*child);
+	// walks down from the root so freed children are skipped, outlines are
+	// only built when the tree is drawn for debugging
+	std::vector<uint32> stack(1, 0u);
+	while (!stack.empty())
+	{
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.firstChild != NONE)
+			for (uint32 child = node.firstChild; child < node.firstChild + 4u; ++child)
+				stack.push_back(child);
+
+		sf::RectangleShape debugShape(sf::Vector2f(node.bounds.width, node.bounds.height));
+		debugShape.setPosition(node.bounds.left, node.bounds.top);
+		debugShape.setFillColor(sf::Color::Transparent);
+		debugShape.setOutlineColor(node.retrieved ? sf::Color::Red : sf::Color::Green);
+		debugShape.setOutlineThickness(-2.f);
+		target.draw(debugShape, states);
 
-	target.draw(m_debugShape);
+		node.retrieved = false;
+	}
 }
 
-void QuadTreeNode::_split()
+void QuadTreeRoot::_resetNode(uint32 index, const sf::FloatRect& bounds, uint32 parent, uint32 depth)
 {
-	const float halfWidth = m_bounds.width / 2.f;
-	const float halfHeight = m_bounds.height / 2.f;
-	const float x = m_bounds.left;
-	const float y = m_bounds.top;
+	Node& node = m_nodes[index];
+	node.bounds = bounds;
+	node.looseBounds = bounds;
+	node.parent = parent;
+	node.depth = depth;
+	node.firstChild = NONE;
+	node.objects.clear();
+	node.retrieved = false;
 
-	m_children.push_back(std::make_shared<QuadTreeNode>(m_level + 1, sf::FloatRect(x + halfWidth, y, halfWidth, halfHeight)));
-	m_children.push_back(std::make_shared<QuadTreeNode>(m_level + 1, sf::FloatRect(x, y, halfWidth, halfHeight)));
-	m_children.push_back(std::make_shared<QuadTreeNode>(m_level + 1, sf::FloatRect(x, y + halfHeight, halfWidth, halfHeight)));
-	m_children.push_back(std::make_shared<QuadTreeNode>(m_level + 1, sf::FloatRect(x+ halfWidth, y + halfHeight, halfWidth, halfHeight)));
+	// the root is not grown, objects outside the map area are not inserted
+	if (parent != NONE)
+	{
+		float growX = bounds.width * (m_settings.looseness - 1.f) / 2.f;
+		float growY = bounds.height * (m_settings.looseness - 1.f) / 2.f;
+		node.looseBounds = sf::FloatRect(bounds.left - growX, bounds.top - growY, bounds.width + growX * 2.f, bounds.height + growY * 2.f);
+	}
 }
 
-sf::Int16 QuadTreeNode::_getIndex(const sf::FloatRect& bounds)
+void QuadTreeRoot::_addToNode(uint32 index, MapObject* object, Location& location)
 {
-	sf::Int16 index = -1;
-	float verticalMidpoint = m_bounds.left + (m_bounds.width / 2.f);
-	float horizontalMidpoint = m_bounds.top + (m_bounds.height / 2.f);
+	m_nodes[index].objects.push_back(object);
+	location.node = index;
 
-	bool topQuadrant = (bounds.top < horizontalMidpoint && bounds.top + bounds.height < horizontalMidpoint);
-	bool bottomQuadrant = (bounds.top > horizontalMidpoint);
+	const Node& node = m_nodes[index];
+	if (node.firstChild == NONE && node.objects.size() > m_settings.capacity && node.depth < m_settings.maxDepth)
+		_split(index);
+}
 
-	if (bounds.left < verticalMidpoint && bounds.left + bounds.width < verticalMidpoint)
+void QuadTreeRoot::_split(uint32 index)
+{
+	// freed children are reused before the pool grows
+	uint32 first;
+	if (!m_freeChildren.empty())
 	{
-		if (topQuadrant)
-			index = 1;
-		else if (bottomQuadrant)
-			index = 2;
+		first = m_freeChildren.back();
+		m_freeChildren.pop_back();
+	}
+	else
+	{
+		first = m_nodes.size();
+		m_nodes.resize(m_nodes.size() + 4u);
+	}
+
+	const sf::FloatRect bounds = m_nodes[index].bounds;
+	const uint32 depth = m_nodes[index].depth + 1u;
+	const float halfWidth = bounds.width / 2.f;
+	const float halfHeight = bounds.height / 2.f;
+
+	// top left, top right, bottom left, bottom right, the order _childFor expects
+	_resetNode(first, sf::FloatRect(bounds.left, bounds.top, halfWidth, halfHeight), index, depth);
+	_resetNode(first + 1u, sf::FloatRect(bounds.left + halfWidth, bounds.top, halfWidth, halfHeight), index, depth);
+	_resetNode(first + 2u, sf::FloatRect(bounds.left, bounds.top + halfHeight, halfWidth, halfHeight), index, depth);
+	_resetNode(first + 3u, sf::FloatRect(bounds.left + halfWidth, bounds.top + halfHeight, halfWidth, halfHeight), index, depth);
+	m_nodes[index].firstChild = first;
+
+	// nodes are fetched by index again, splitting a child can grow the pool
+	std::size_t i = 0;
+	while (i < m_nodes[index].objects.size())
+	{
+		std::vector<MapObject*>& objects = m_nodes[index].objects;
+		MapObject* object = objects[i];
+		Location& location = m_locations[object];
+		uint32 child = _childFor(index, location.aabb);
+		if (child == NONE)
+		{
+			i++;
+			continue;
+		}
+
+		// the last object takes the place of the moved one
+		objects[i] = objects.back();
+		objects.pop_back();
+		_addToNode(child, object, location);
 	}
-	// object can completely fit within the right quadrants
-	else if (bounds.left > verticalMidpoint)
+}
+
+void QuadTreeRoot::_collapse(uint32 index)
+{
+	for (; index != NONE; index = m_nodes[index].parent)
 	{
-		if (topQuadrant)
-			index  = 0;
-		else if (bottomQuadrant)
-			index = 3;
+		Node& node = m_nodes[index];
+		if (node.firstChild == NONE)
+			continue;
+
+		std::size_t count = node.objects.size();
+		for (uint32 child = node.firstChild; child < node.firstChild + 4u; ++child)
+		{
+			if (m_nodes[child].firstChild != NONE)
+				return;
+
+			count += m_nodes[child].objects.size();
+		}
+
+		if (count > m_settings.capacity)
+			return;
+
+		for (uint32 child = node.firstChild; child < node.firstChild + 4u; ++child)
+		{
+			for (MapObject* object : m_nodes[child].objects)
+			{
+				node.objects.push_back(object);
+				m_locations[object].node = index;
+			}
+
+			m_nodes[child].objects.clear();
+		}
+
+		m_freeChildren.push_back(node.firstChild);
+		node.firstChild = NONE;
 	}
+}
+
+void QuadTreeRoot::_raycast(uint32 index, const sf::Vector2f& origin, const sf::Vector2f& direction, float length)
+{
+	const Node& node = m_nodes[index];
+	node.retrieved = true;
+
+	float distance;
+	for (MapObject* object : node.objects)
+		if (SpatialQuery::raycast(origin, direction, length, object->getAABB(), distance))
+			m_hits.push_back(std::make_pair(distance, object));
+
+	if (node.firstChild == NONE)
+		return;
+
+	for (uint32 child = node.firstChild; child < node.firstChild + 4u; ++child)
+		if (SpatialQuery::raycast(origin, direction, length, m_nodes[child].looseBounds, distance))
+			_raycast(child, origin, direction, length);
+}
+
+uint32 QuadTreeRoot::_childFor(uint32 index, const sf::FloatRect& aabb) const
+{
+	const Node& node = m_nodes[index];
+	if (node.firstChild == NONE)
+		return NONE;
+
+	// only the quadrant holding the centre of the object can take it
+	uint32 child = node.firstChild;
+	if (aabb.left + aabb.width / 2.f >= node.bounds.left + node.bounds.width / 2.f)
+		child += 1u;
+	if (aabb.top + aabb.height / 2.f >= node.bounds.top + node.bounds.height / 2.f)
+		child += 2u;
 
-	return index;
+	return containsRect(m_nodes[child].looseBounds, aabb) ? child : NONE;
 }
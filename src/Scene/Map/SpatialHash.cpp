@@ -0,0 +1,431 @@
+#include <Scene/Map/SpatialHash.h>
+
+#include <algorithm>
+#include <limits>
+
+std::vector<SpatialHash*> SpatialHash::s_hashes;
+
+SpatialHash::SpatialHash() :
+	m_cellSize(64.f),
+	m_mapObjectCount(0),
+	m_queryStamp(0)
+{
+	s_hashes.push_back(this);
+}
+
+SpatialHash::~SpatialHash()
+{
+	s_hashes.erase(std::remove(s_hashes.begin(), s_hashes.end(), this), s_hashes.end());
+}
+
+void SpatialHash::removeFromAll(const GameObject& object)
+{
+	for (auto hash : s_hashes)
+		hash->_remove(&object);
+}
+
+void SpatialHash::clear()
+{
+	m_entries.clear();
+	m_freeEntries.clear();
+	m_indices.clear();
+	m_mapObjectCount = 0;
+	m_cells.clear();
+	m_cellRange = sf::IntRect();
+}
+
+void SpatialHash::clearMapObjects()
+{
+	for (const auto& entry : m_entries)
+		if (entry.mapObject)
+			_remove(entry.mapObject);
+}
+
+void SpatialHash::setCellSize(float size)
+{
+	if (size <= 0.f || size == m_cellSize)
+		return;
+
+	m_cellSize = size;
+	m_cells.clear();
+	m_cellRange = sf::IntRect();
+	for (uint32 i = 0; i < m_entries.size(); ++i)
+	{
+		Entry& entry = m_entries[i];
+		if (!entry.mapObject && !entry.gameObject)
+			continue;
+
+		_getCellRange(entry.aabb, entry.cells);
+		_addToCells(i);
+	}
+}
+
+void SpatialHash::insert(const MapObject& object)
+{
+	_insert(&object, const_cast<MapObject*>(&object), 0, object.getAABB());
+}
+
+void SpatialHash::remove(const MapObject& object)
+{
+	_remove(&object);
+}
+
+void SpatialHash::update(const MapObject& object)
+{
+	_insert(&object, const_cast<MapObject*>(&object), 0, object.getAABB());
+}
+
+void SpatialHash::insert(GameObject& object, const sf::FloatRect& bounds)
+{
+	_insert(&object, 0, &object, bounds);
+}
+
+void SpatialHash::remove(const GameObject& object)
+{
+	_remove(&object);
+}
+
+void SpatialHash::update(GameObject& object, const sf::FloatRect& bounds)
+{
+	_insert(&object, 0, &object, bounds);
+}
+
+std::vector<MapObject*> SpatialHash::retrieve(const sf::FloatRect& bounds)
+{
+	std::vector<MapObject*> results;
+	retrieve(bounds, results);
+	return results;
+}
+
+void SpatialHash::retrieve(const sf::FloatRect& bounds, std::vector<MapObject*>& results)
+{
+	visit(bounds, [&results](MapObject& object) { results.push_back(&object); });
+}
+
+void SpatialHash::retrieve(const sf::FloatRect& bounds, std::vector<GameObject*>& results)
+{
+	visitGameObjects(bounds, [&results](GameObject& object) { results.push_back(&object); });
+}
+
+void SpatialHash::retrieve(const sf::Vector2f& point, std::vector<MapObject*>& results)
+{
+	retrieve(sf::FloatRect(point.x, point.y, 0.f, 0.f), results);
+}
+
+void SpatialHash::retrieve(const sf::Vector2f& point, std::vector<GameObject*>& results)
+{
+	retrieve(sf::FloatRect(point.x, point.y, 0.f, 0.f), results);
+}
+
+void SpatialHash::raycast(const sf::Vector2f& origin, const sf::Vector2f& direction, float length, std::vector<MapObject*>& results)
+{
+	_raycast(origin, SpatialQuery::normalize(direction), length, false);
+	for (const auto& hit : m_hits)
+		results.push_back(m_entries[hit.second].mapObject);
+}
+
+void SpatialHash::raycast(const sf::Vector2f& origin, const sf::Vector2f& direction, float length, std::vector<GameObject*>& results)
+{
+	_raycast(origin, SpatialQuery::normalize(direction), length, true);
+	for (const auto& hit : m_hits)
+		results.push_back(m_entries[hit.second].gameObject);
+}
+
+void SpatialHash::nearest(const sf::Vector2f& point, uint32 count, std::vector<MapObject*>& results)
+{
+	_nearest(point, count, false);
+	for (const auto& hit : m_hits)
+		results.push_back(m_entries[hit.second].mapObject);
+}
+
+void SpatialHash::nearest(const sf::Vector2f& point, uint32 count, std::vector<GameObject*>& results)
+{
+	_nearest(point, count, true);
+	for (const auto& hit : m_hits)
+		results.push_back(m_entries[hit.second].gameObject);
+}
+
+void SpatialHash::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+	// outlines are only built when the hash is drawn for debugging
+	for (const auto& cell : m_cells)
+	{
+		if (cell.second.entries.empty())
+			continue;
+
+		int32 x = (int32)(cell.first >> 32);
+		int32 y = (int32)(cell.first & 0xffffffff);
+		sf::RectangleShape debugShape(sf::Vector2f(m_cellSize, m_cellSize));
+		debugShape.setPosition(x * m_cellSize, y * m_cellSize);
+		debugShape.setFillColor(sf::Color::Transparent);
+		debugShape.setOutlineColor(cell.second.retrieved ? sf::Color::Red : sf::Color::Green);
+		debugShape.setOutlineThickness(-2.f);
+		target.draw(debugShape, states);
+
+		cell.second.retrieved = false;
+	}
+}
+
+void SpatialHash::_insert(const void* key, MapObject* mapObject, GameObject* gameObject, const sf::FloatRect& aabb)
+{
+	auto it = m_indices.find(key);
+	if (it != m_indices.end())
+	{
+		_move(it->second, aabb);
+		return;
+	}
+
+	uint32 index;
+	if (!m_freeEntries.empty())
+	{
+		index = m_freeEntries.back();
+		m_freeEntries.pop_back();
+	}
+	else
+	{
+		index = m_entries.size();
+		m_entries.push_back(Entry());
+	}
+
+	Entry& entry = m_entries[index];
+	entry.aabb = aabb;
+	entry.mapObject = mapObject;
+	entry.gameObject = gameObject;
+	entry.queryStamp = m_queryStamp;
+	_getCellRange(aabb, entry.cells);
+	_addToCells(index);
+
+	m_indices[key] = index;
+	if (mapObject)
+		m_mapObjectCount++;
+}
+
+void SpatialHash::_remove(const void* key)
+{
+	auto it = m_indices.find(key);
+	if (it == m_indices.end())
+		return;
+
+	uint32 index = it->second;
+	m_indices.erase(it);
+	_removeFromCells(index);
+
+	Entry& entry = m_entries[index];
+	if (entry.mapObject)
+		m_mapObjectCount--;
+
+	entry.mapObject = 0;
+	entry.gameObject = 0;
+	m_freeEntries.push_back(index);
+}
+
+void SpatialHash::_move(uint32 index, const sf::FloatRect& aabb)
+{
+	Entry& entry = m_entries[index];
+	entry.aabb = aabb;
+
+	// most moves stay inside the same cells
+	sf::IntRect range;
+	_getCellRange(aabb, range);
+	if (range == entry.cells)
+		return;
+
+	_removeFromCells(index);
+	entry.cells = range;
+	_addToCells(index);
+}
+
+void SpatialHash::_addToCells(uint32 index)
+{
+	const sf::IntRect& range = m_entries[index].cells;
+	for (int32 y = range.top; y < range.top + range.height; y++)
+		for (int32 x = range.left; x < range.left + range.width; x++)
+			m_cells[_getCellKey(x, y)].entries.push_back(index);
+
+	if (m_cellRange.width == 0)
+	{
+		m_cellRange = range;
+		return;
+	}
+
+	int32 right = std::max(m_cellRange.left + m_cellRange.width, range.left + range.width);
+	int32 bottom = std::max(m_cellRange.top + m_cellRange.height, range.top + range.height);
+	m_cellRange.left = std::min(m_cellRange.left, range.left);
+	m_cellRange.top = std::min(m_cellRange.top, range.top);
+	m_cellRange.width = right - m_cellRange.left;
+	m_cellRange.height = bottom - m_cellRange.top;
+}
+
+void SpatialHash::_removeFromCells(uint32 index)
+{
+	const sf::IntRect& range = m_entries[index].cells;
+	for (int32 y = range.top; y < range.top + range.height; y++)
+	{
+		for (int32 x = range.left; x < range.left + range.width; x++)
+		{
+			auto it = m_cells.find(_getCellKey(x, y));
+			if (it == m_cells.end())
+				continue;
+
+			// order of entries in a cell does not matter, the last one takes the place
+			std::vector<uint32>& entries = it->second.entries;
+			auto e = std::find(entries.begin(), entries.end(), index);
+			if (e != entries.end())
+			{
+				*e = entries.back();
+				entries.pop_back();
+			}
+		}
+	}
+}
+
+void SpatialHash::_getCellRange(const sf::FloatRect& rect, sf::IntRect& range) const
+{
+	range.left = (int32)(std::floor(rect.left / m_cellSize));
+	range.top = (int32)(std::floor(rect.top / m_cellSize));
+	range.width = (int32)(std::floor((rect.left + rect.width) / m_cellSize)) - range.left + 1;
+	range.height = (int32)(std::floor((rect.top + rect.height) / m_cellSize)) - range.top + 1;
+}
+
+uint64_t SpatialHash::_getCellKey(int32 x, int32 y)
+{
+	return ((uint64_t)((uint32)(x)) << 32) | (uint32)(y);
+}
+
+void SpatialHash::_raycast(const sf::Vector2f& origin, const sf::Vector2f& direction, float length, bool gameObjects)
+{
+	m_hits.clear();
+	if (m_cellRange.width == 0)
+		return;
+
+	// walks the cells along the ray, distances are where it crosses the next cell border
+	const float infinity = std::numeric_limits<float>::infinity();
+	int32 x = (int32)(std::floor(origin.x / m_cellSize));
+	int32 y = (int32)(std::floor(origin.y / m_cellSize));
+	int32 stepX = direction.x > 0.f ? 1 : (direction.x < 0.f ? -1 : 0);
+	int32 stepY = direction.y > 0.f ? 1 : (direction.y < 0.f ? -1 : 0);
+	float nextX = stepX ? ((x + (stepX > 0 ? 1 : 0)) * m_cellSize - origin.x) / direction.x : infinity;
+	float nextY = stepY ? ((y + (stepY > 0 ? 1 : 0)) * m_cellSize - origin.y) / direction.y : infinity;
+	float deltaX = stepX ? m_cellSize / std::abs(direction.x) : infinity;
+	float deltaY = stepY ? m_cellSize / std::abs(direction.y) : infinity;
+
+	const int32 right = m_cellRange.left + m_cellRange.width;
+	const int32 bottom = m_cellRange.top + m_cellRange.height;
+
+	m_queryStamp++;
+	float distance = 0.f;
+	while (distance <= length)
+	{
+		// the ray left the used cells and does not come back
+		if ((x < m_cellRange.left && stepX <= 0) || (x >= right && stepX >= 0) ||
+			(y < m_cellRange.top && stepY <= 0) || (y >= bottom && stepY >= 0))
+			break;
+
+		auto it = m_cells.find(_getCellKey(x, y));
+		if (it != m_cells.end())
+		{
+			it->second.retrieved = true;
+			for (uint32 index : it->second.entries)
+			{
+				Entry& entry = m_entries[index];
+				if (entry.queryStamp == m_queryStamp)
+					continue;
+
+				entry.queryStamp = m_queryStamp;
+				float hit;
+				if ((gameObjects ? entry.gameObject != 0 : entry.mapObject != 0) &&
+					SpatialQuery::raycast(origin, direction, length, entry.aabb, hit))
+					m_hits.push_back(std::make_pair(hit, index));
+			}
+		}
+
+		if (nextX < nextY)
+		{
+			distance = nextX;
+			nextX += deltaX;
+			x += stepX;
+		}
+		else
+		{
+			distance = nextY;
+			nextY += deltaY;
+			y += stepY;
+		}
+	}
+
+	std::sort(m_hits.begin(), m_hits.end());
+}
+
+void SpatialHash::_nearest(const sf::Vector2f& point, uint32 count, bool gameObjects)
+{
+	m_hits.clear();
+	if (count == 0 || m_cellRange.width == 0)
+		return;
+
+	// searches rings of cells around the cell of the point, starting at the
+	// first ring touching the used cells and ending at the last one
+	const int32 right = m_cellRange.left + m_cellRange.width - 1;
+	const int32 bottom = m_cellRange.top + m_cellRange.height - 1;
+	int32 cx = (int32)(std::floor(point.x / m_cellSize));
+	int32 cy = (int32)(std::floor(point.y / m_cellSize));
+	int32 firstRing = std::max(std::max(0, std::max(m_cellRange.left - cx, cx - right)), std::max(m_cellRange.top - cy, cy - bottom));
+	int32 lastRing = std::max(std::max(cx - m_cellRange.left, right - cx), std::max(cy - m_cellRange.top, bottom - cy));
+
+	m_queryStamp++;
+	for (int32 ring = firstRing; ring <= lastRing; ++ring)
+	{
+		// only the part of the ring inside the used cells is visited
+		int32 left = std::max(cx - ring, m_cellRange.left);
+		int32 top = std::max(cy - ring + 1, m_cellRange.top);
+		int32 rowEnd = std::min(cx + ring, right);
+		int32 columnEnd = std::min(cy + ring - 1, bottom);
+		for (int32 x = left; x <= rowEnd; ++x)
+		{
+			_addNearest(x, cy - ring, point, count, gameObjects);
+			if (ring)
+				_addNearest(x, cy + ring, point, count, gameObjects);
+		}
+
+		for (int32 y = top; ring && y <= columnEnd; ++y)
+		{
+			_addNearest(cx - ring, y, point, count, gameObjects);
+			_addNearest(cx + ring, y, point, count, gameObjects);
+		}
+
+		// every object closer than the ring has been seen
+		float reach = ring * m_cellSize;
+		if (m_hits.size() == count && m_hits.front().first <= reach * reach)
+			break;
+	}
+
+	std::sort_heap(m_hits.begin(), m_hits.end());
+}
+
+void SpatialHash::_addNearest(int32 x, int32 y, const sf::Vector2f& point, uint32 count, bool gameObjects)
+{
+	auto it = m_cells.find(_getCellKey(x, y));
+	if (it == m_cells.end())
+		return;
+
+	it->second.retrieved = true;
+	for (uint32 index : it->second.entries)
+	{
+		Entry& entry = m_entries[index];
+		if (entry.queryStamp == m_queryStamp || (gameObjects ? !entry.gameObject : !entry.mapObject))
+			continue;
+
+		entry.queryStamp = m_queryStamp;
+		float distance = SpatialQuery::distanceSquared(point, entry.aabb);
+		if (m_hits.size() == count)
+		{
+			if (distance >= m_hits.front().first)
+				continue;
+
+			std::pop_heap(m_hits.begin(), m_hits.end());
+			m_hits.pop_back();
+		}
+
+		m_hits.push_back(std::make_pair(distance, index));
+		std::push_heap(m_hits.begin(), m_hits.end());
+	}
+}
@@ -0,0 +1,134 @@
+#include <Scene/Map/TextScanner.h>
+
+// powers of ten exactly representable as double
+static const double POWERS_OF_TEN[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+TextScanner::TextScanner(const char* text) :
+	m_pos(text ? text : ""),
+	m_failed(false)
+{
+}
+
+bool TextScanner::read(sf::Uint32& value)
+{
+	if (!skipSeparators())
+		return false;
+
+	if (!isDigit(*m_pos))
+	{
+		m_failed = true;
+		return false;
+	}
+
+	uint64_t result = 0;
+	while (isDigit(*m_pos))
+	{
+		result = result * 10 + (*m_pos++ - '0');
+		if (result > 0xffffffffu)
+		{
+			m_failed = true;
+			return false;
+		}
+	}
+
+	value = static_cast<sf::Uint32>(result);
+	return true;
+}
+
+bool TextScanner::read(float& value)
+{
+	if (!skipSeparators())
+		return false;
+
+	const char* start = m_pos;
+	bool negative = *m_pos == '-';
+	if (*m_pos == '-' || *m_pos == '+')
+		m_pos++;
+
+	// digits past the 19th do not fit the mantissa and only scale it
+	uint64_t mantissa = 0;
+	int32 digits = 0;
+	int32 exponent = 0;
+	bool anyDigit = false;
+	for (; isDigit(*m_pos); m_pos++, anyDigit = true)
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*m_pos - '0');
+			if (mantissa)
+				digits++;
+		}
+		else
+		{
+			exponent++;
+		}
+	}
+
+	if (*m_pos == '.')
+	{
+		for (m_pos++; isDigit(*m_pos); m_pos++, anyDigit = true)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*m_pos - '0');
+				if (mantissa)
+					digits++;
+				exponent--;
+			}
+		}
+	}
+
+	if (!anyDigit)
+	{
+		m_pos = start;
+		m_failed = true;
+		return false;
+	}
+
+	if (*m_pos == 'e' || *m_pos == 'E')
+	{
+		const char* e = m_pos + 1;
+		bool negativeExponent = *e == '-';
+		if (*e == '-' || *e == '+')
+			e++;
+
+		if (isDigit(*e))
+		{
+			int32 power = 0;
+			for (; isDigit(*e); e++)
+				power = std::min(power * 10 + (*e - '0'), 9999);
+
+			exponent += negativeExponent ? -power : power;
+			m_pos = e;
+		}
+	}
+
+	double result = static_cast<double>(mantissa);
+	if (exponent > 0)
+		result *= exponent <= 22 ? POWERS_OF_TEN[exponent] : std::pow(10.0, exponent);
+	else if (exponent < 0)
+		result /= -exponent <= 22 ? POWERS_OF_TEN[-exponent] : std::pow(10.0, -exponent);
+
+	value = static_cast<float>(negative ? -result : result);
+	return true;
+}
+
+bool TextScanner::skipSeparators()
+{
+	if (m_failed)
+		return false;
+
+	while (*m_pos == ',' || *m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t')
+		m_pos++;
+
+	return *m_pos != '\0';
+}
@@ -0,0 +1,231 @@
+#include <Scene/Map/TileDecoder.h>
+
+#include <zlib.h>
+
+#if defined(USE_ZSTD)
+#include <zstd.h>
+#endif
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+static const int8 WS = -1;
+static const int8 PAD = -2;
+static const int8 BAD = -3;
+
+// value of every base64 character, negative for whitespace, padding and invalid characters
+static const int8 BASE64_VALUES[256] =
+{
+	BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, WS, WS, BAD, BAD, WS, BAD, BAD,
+	BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+	WS, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, 62, BAD, BAD, BAD, 63,
+	52, 53, 54, 55, 56, 57, 58, 59, 60, 61, BAD, BAD, BAD, PAD, BAD, BAD,
+	BAD, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+	15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, BAD, BAD, BAD, BAD, BAD,
+	BAD, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+	41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, BAD, BAD, BAD, BAD, BAD,
+	BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+	BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+	BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+	BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+	BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+	BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+	BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+	BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+};
+
+#if defined(__SSSE3__)
+// decodes 16 characters to 12 bytes, fails if any of them is not a base64 digit
+static inline bool decodeBase64Block(const uint8* in, uint8* out)
+{
+	const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+	const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), _mm_set1_epi8(0x0f));
+	const __m128i loNibbles = _mm_and_si128(chars, _mm_set1_epi8(0x0f));
+
+	// a character is valid when the bits looked up by its two nibbles do not overlap
+	const __m128i loBits = _mm_shuffle_epi8(_mm_setr_epi8(
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+		0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a), loNibbles);
+	const __m128i hiBits = _mm_shuffle_epi8(_mm_setr_epi8(
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+		0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10), hiNibbles);
+	if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(loBits, hiBits), _mm_setzero_si128())))
+		return false;
+
+	// offset from character to value by the high nibble, '/' shares its nibble with '+'
+	const __m128i slash = _mm_cmpeq_epi8(chars, _mm_set1_epi8(0x2f));
+	const __m128i offsets = _mm_shuffle_epi8(_mm_setr_epi8(
+		0, 16, 19, 4, -65, -65, -71, -71,
+		0, 0, 0, 0, 0, 0, 0, 0), _mm_add_epi8(slash, hiNibbles));
+	const __m128i values = _mm_add_epi8(chars, offsets);
+
+	// pack four 6 bit values into three bytes
+	const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+	const __m128i words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+	const __m128i bytes = _mm_shuffle_epi8(words, _mm_setr_epi8(
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+	// only 12 bytes are valid, the out buffer may end right after them
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(out), bytes);
+	uint32 tail = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+	std::memcpy(out + 8, &tail, sizeof(tail));
+
+	return true;
+}
+#endif
+
+TileDecoder::Compression TileDecoder::compressionFromString(const std::string& name)
+{
+	if (name.empty())
+		return None;
+	if (name == "zlib" || name == "gzip")
+		return Zlib;
+	if (name == "zstd")
+		return Zstd;
+
+	return Unknown;
+}
+
+bool TileDecoder::decodeBase64(const char* text, std::size_t length, uint8* out, std::size_t& written)
+{
+	const uint8* in = reinterpret_cast<const uint8*>(text);
+	const uint8* end = in + length;
+	uint8* dst = out;
+
+	uint32 bits = 0;
+	uint32 count = 0;
+	while (in < end)
+	{
+#if defined(__SSSE3__)
+		// whole blocks go through the vector path, whitespace and padding through the table
+		if (count == 0)
+		{
+			while (end - in >= 16 && decodeBase64Block(in, dst))
+			{
+				in += 16;
+				dst += 12;
+			}
+
+			if (in == end)
+				break;
+		}
+#endif
+
+		int8 value = BASE64_VALUES[*in++];
+		if (value >= 0)
+		{
+			bits = (bits << 6) | value;
+			if (++count == 4)
+			{
+				dst[0] = static_cast<uint8>(bits >> 16);
+				dst[1] = static_cast<uint8>(bits >> 8);
+				dst[2] = static_cast<uint8>(bits);
+				dst += 3;
+				bits = 0;
+				count = 0;
+			}
+		}
+		else if (value == PAD)
+		{
+			break;
+		}
+		else if (value == BAD)
+		{
+			PRINT_ERROR << "Invalid character in base64 data" << std::endl;
+			return false;
+		}
+	}
+
+	// trailing group without padding
+	if (count == 1)
+	{
+		PRINT_ERROR << "Truncated base64 data" << std::endl;
+		return false;
+	}
+	else if (count == 2)
+	{
+		*dst++ = static_cast<uint8>(bits >> 4);
+	}
+	else if (count == 3)
+	{
+		*dst++ = static_cast<uint8>(bits >> 10);
+		*dst++ = static_cast<uint8>(bits >> 2);
+	}
+
+	written = dst - out;
+	return true;
+}
+
+bool TileDecoder::decompress(Compression compression, const uint8* data, std::size_t dataSize, uint8* out, std::size_t size)
+{
+	switch (compression)
+	{
+	case None:
+		if (dataSize != size)
+		{
+			PRINT_ERROR << "Layer data has " << dataSize << " bytes, expected " << size << std::endl;
+			return false;
+		}
+
+		std::memcpy(out, data, size);
+		return true;
+	case Zlib:
+		return inflateZlib(data, dataSize, out, size);
+	case Zstd:
+		return decompressZstd(data, dataSize, out, size);
+	default:
+		PRINT_ERROR << "Unsupported layer compression" << std::endl;
+		return false;
+	}
+}
+
+bool TileDecoder::inflateZlib(const uint8* data, std::size_t dataSize, uint8* out, std::size_t size)
+{
+	z_stream stream;
+	stream.zalloc = Z_NULL;
+	stream.zfree = Z_NULL;
+	stream.opaque = Z_NULL;
+	stream.next_in = const_cast<Bytef*>(data);
+	stream.avail_in = static_cast<uInt>(dataSize);
+	stream.next_out = out;
+	stream.avail_out = static_cast<uInt>(size);
+
+	// 15 + 32 accepts zlib and gzip headers
+	if (inflateInit2(&stream, 15 + 32) != Z_OK)
+	{
+		PRINT_ERROR << "Failed to initialise zlib: " << (stream.msg ? stream.msg : "") << std::endl;
+		return false;
+	}
+
+	// the size is known, so the whole stream is inflated in one call
+	int result = inflate(&stream, Z_FINISH);
+	uLong total = stream.total_out;
+	inflateEnd(&stream);
+
+	// a stream still going after size bytes means the layer is bigger than the map
+	if (result != Z_STREAM_END || total != size)
+	{
+		PRINT_ERROR << "Failed to inflate " << size << " bytes of layer data, zlib result " << result << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool TileDecoder::decompressZstd(const uint8* data, std::size_t dataSize, uint8* out, std::size_t size)
+{
+#if defined(USE_ZSTD)
+	std::size_t result = ZSTD_decompress(out, size, data, dataSize);
+	if (ZSTD_isError(result) || result != size)
+	{
+		PRINT_ERROR << "Failed to decompress zstd layer data: " << (ZSTD_isError(result) ? ZSTD_getErrorName(result) : "wrong size") << std::endl;
+		return false;
+	}
+
+	return true;
+#else
+	PRINT_ERROR << "zstd compressed layers need a build with zstd support" << std::endl;
+	return false;
+#endif
+}
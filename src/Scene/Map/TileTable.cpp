@@ -0,0 +1,269 @@
+#include <Scene/Map/TileTable.h>
+#include <Scene/Map/MapObject.h>
+#include <Scene/Map/TextScanner.h>
+
+const char* TileTable::SOLID_PROPERTY = "solid";
+
+// copies an array read by BinaryReader::readArray, whose elements may be unaligned
+template <typename T>
+static bool readVector(BinaryReader& reader, std::vector<T>& values)
+{
+	uint32 count;
+	const uint8* data = reader.readArray<T>(count);
+	values.resize(count);
+	if (count)
+		std::memcpy(&values[0], data, count * sizeof(T));
+
+	return !reader.failed();
+}
+
+void TileTable::clear()
+{
+	m_tiles.clear();
+	m_solid.clear();
+	m_properties.clear();
+	m_shapes.clear();
+	m_points.clear();
+	m_keys.clear();
+	m_keyIndices.clear();
+	m_strings.clear();
+}
+
+void TileTable::resize(uint32 count)
+{
+	Tile empty = { 0, 0, 0, 0 };
+	m_tiles.resize(count, empty);
+	m_solid.resize(count, 0);
+}
+
+bool TileTable::parseTile(sf::Uint32 gid, const pugi::xml_node& tileNode)
+{
+	gid &= GID_MASK;
+	if (gid >= m_tiles.size())
+		return false;
+
+	Tile& tile = m_tiles[gid];
+
+	// the properties of a tile are next to each other in the flat array
+	tile.firstProperty = m_properties.size();
+	tile.propertyCount = 0;
+	for (pugi::xml_node propertyNode : tileNode.child("properties").children("property"))
+	{
+		std::string type = propertyNode.attribute("type").as_string();
+		pugi::xml_attribute valueAttribute = propertyNode.attribute("value");
+
+		Property property;
+		property.key = _internKey(propertyNode.attribute("name").as_string());
+		if (type == "int")
+		{
+			property.type = Property::Int;
+			property.intValue = valueAttribute.as_int();
+		}
+		else if (type == "float")
+		{
+			property.type = Property::Float;
+			property.floatValue = valueAttribute.as_float();
+		}
+		else if (type == "bool")
+		{
+			property.type = Property::Bool;
+			property.intValue = valueAttribute.as_bool() ? 1 : 0;
+		}
+		else
+		{
+			// colors and files are kept as text like strings
+			property.type = Property::String;
+			property.stringIndex = _addString(valueAttribute ? valueAttribute.as_string() : propertyNode.text().as_string());
+		}
+
+		// maps written without property types store the solid flag as text
+		if (m_keys[property.key] == SOLID_PROPERTY &&
+			((property.type == Property::Bool && property.intValue) || (property.type == Property::String && m_strings[property.stringIndex] == "true")))
+			m_solid[gid] = 1;
+
+		m_properties.push_back(property);
+		tile.propertyCount++;
+	}
+
+	tile.firstShape = m_shapes.size();
+	tile.shapeCount = 0;
+	for (pugi::xml_node objectNode : tileNode.child("objectgroup").children("object"))
+	{
+		if (!_parseShape(objectNode))
+		{
+			PRINT_WARNING << "Invalid collision shape of tile " << gid << ", skipping..." << std::endl;
+			continue;
+		}
+
+		tile.shapeCount++;
+	}
+
+	if (tile.shapeCount)
+		m_solid[gid] = 1;
+
+	return true;
+}
+
+int32 TileTable::findKey(const std::string& name) const
+{
+	auto it = m_keyIndices.find(name);
+	return it != m_keyIndices.end() ? (int32)(it->second) : -1;
+}
+
+const TileTable::Property* TileTable::getProperty(sf::Uint32 gid, uint32 key) const
+{
+	gid &= GID_MASK;
+	if (gid >= m_tiles.size())
+		return 0;
+
+	const Tile& tile = m_tiles[gid];
+	for (uint32 i = tile.firstProperty; i < tile.firstProperty + tile.propertyCount; ++i)
+		if (m_properties[i].key == key)
+			return &m_properties[i];
+
+	return 0;
+}
+
+const std::string& TileTable::getString(const Property& property) const
+{
+	static const std::string empty;
+	return property.type == Property::String ? m_strings[property.stringIndex] : empty;
+}
+
+void TileTable::write(BinaryWriter& writer) const
+{
+	writer.write((uint32)(m_keys.size()));
+	for (const auto& key : m_keys)
+		writer.writeString(key);
+
+	writer.write((uint32)(m_strings.size()));
+	for (const auto& value : m_strings)
+		writer.writeString(value);
+
+	writer.writeArray(m_tiles.data(), m_tiles.size());
+	writer.writeArray(m_solid.data(), m_solid.size());
+	writer.writeArray(m_properties.data(), m_properties.size());
+	writer.writeArray(m_shapes.data(), m_shapes.size());
+	writer.writeArray(m_points.data(), m_points.size());
+}
+
+bool TileTable::read(BinaryReader& reader)
+{
+	clear();
+
+	uint32 count = 0;
+	reader.read(count);
+	for (uint32 i = 0; i < count && !reader.failed(); ++i)
+	{
+		std::string key;
+		reader.readString(key);
+		_internKey(key);
+	}
+
+	count = 0;
+	reader.read(count);
+	m_strings.resize(count);
+	for (uint32 i = 0; i < count && !reader.failed(); ++i)
+		reader.readString(m_strings[i]);
+
+	if (!readVector(reader, m_tiles) || !readVector(reader, m_solid) || !readVector(reader, m_properties) ||
+		!readVector(reader, m_shapes) || !readVector(reader, m_points) || m_solid.size() != m_tiles.size())
+		return false;
+
+	// ranges are checked once so lookups never have to
+	for (const auto& tile : m_tiles)
+		if (tile.firstProperty + tile.propertyCount > m_properties.size() || tile.firstShape + tile.shapeCount > m_shapes.size())
+			return false;
+
+	for (const auto& property : m_properties)
+		if (property.key >= m_keys.size() || (property.type == Property::String && property.stringIndex >= m_strings.size()))
+			return false;
+
+	for (const auto& shape : m_shapes)
+		if (shape.firstPoint + shape.pointCount > m_points.size())
+			return false;
+
+	return true;
+}
+
+uint32 TileTable::_internKey(const std::string& name)
+{
+	auto it = m_keyIndices.find(name);
+	if (it != m_keyIndices.end())
+		return it->second;
+
+	m_keyIndices[name] = m_keys.size();
+	m_keys.push_back(name);
+	return m_keys.size() - 1;
+}
+
+uint32 TileTable::_addString(const std::string& value)
+{
+	m_strings.push_back(value);
+	return m_strings.size() - 1;
+}
+
+bool TileTable::_parseShape(const pugi::xml_node& objectNode)
+{
+	Shape shape;
+	shape.type = Rectangle;
+	shape.bounds = sf::FloatRect(objectNode.attribute("x").as_float(), objectNode.attribute("y").as_float(),
+		objectNode.attribute("width").as_float(), objectNode.attribute("height").as_float());
+	shape.firstPoint = m_points.size();
+	shape.pointCount = 0;
+
+	if (objectNode.child("ellipse"))
+	{
+		shape.type = Ellipse;
+	}
+	else if (objectNode.child("polygon") || objectNode.child("polyline"))
+	{
+		pugi::xml_node pointsNode = objectNode.child("polygon");
+		shape.type = Polygon;
+		if (!pointsNode)
+		{
+			pointsNode = objectNode.child("polyline");
+			shape.type = Polyline;
+		}
+
+		TextScanner scanner(pointsNode.attribute("points").value());
+		sf::Vector2f point;
+		while (scanner.read(point.x) && scanner.read(point.y))
+		{
+			m_points.push_back(point);
+			shape.pointCount++;
+		}
+
+		if (scanner.failed() || shape.pointCount == 0)
+		{
+			m_points.resize(shape.firstPoint);
+			return false;
+		}
+	}
+	else if (shape.bounds.width <= 0.f || shape.bounds.height <= 0.f)
+	{
+		return false;
+	}
+
+	m_shapes.push_back(shape);
+	return true;
+}
+
+CollisionMap::CollisionMap() :
+	m_width(0),
+	m_height(0)
+{
+}
+
+void CollisionMap::create(uint32 width, uint32 height)
+{
+	m_width = width;
+	m_height = height;
+	m_words.assign((width * height + 31u) / 32u, 0u);
+}
+
+void CollisionMap::setWords(const uint8* data, uint32 count)
+{
+	if (count == m_words.size() && count)
+		std::memcpy(&m_words[0], data, count * sizeof(uint32));
+}
@@ -1,14 +1,34 @@
 #include "Scene/Scene.h"
+#include "Scene/Systems/PhysicsSyncSystem.h"
+#include "Scene/Systems/ComponentUpdateSystem.h"
+#include "Scene/Systems/TransformSystem.h"
+#include "Scene/Systems/CameraSystem.h"
+#include "Scene/Systems/RenderCollectSystem.h"
+#include "Scene/SpriteGrid.h"
+#include "Video/RenderQueue.h"
+#include "Jobs/JobSystem.h"
 #include "Core.h"
 
+#include <limits>
+
 bool SCENE_DEBUG = true;
 
 std::map<std::string, Scene::ComponentFactoryData> Scene::s_componentFactory;
 
-GameObject::List Scene::s_prefabs;
-GameObject::List Scene::s_gameObjects;
-GameObject::List Scene::s_gameObjectsToCreate;
-GameObject::List Scene::s_gameObjectsToDestroy;
+Scene::GameObjectSlots Scene::s_prefabs;
+Scene::GameObjectSlots Scene::s_gameObjects;
+Scene::GameObjectIndex Scene::s_prefabIds;
+Scene::GameObjectIndex Scene::s_gameObjectIds;
+
+std::vector<GameObject*> Scene::s_gameObjectsToCreate;
+std::vector<GameObject*> Scene::s_gameObjectsToDestroy;
+std::unordered_set<std::string> Scene::s_idsToCreate;
+std::unordered_set<GameObject*> Scene::s_pendingDestroy;
+
+std::vector<GameObject*> Scene::s_changedGameObjects;
+
+std::vector<System*> Scene::s_systems;
+std::vector<SpriteRenderer*> Scene::s_visibleSprites;
 
 std::string Scene::s_sceneFileExtension = ".scn";
 
@@ -141,6 +161,48 @@ Component* Scene::buildComponent(std::type_index type)
 	return 0;
 }
 
+void Scene::registerSystem(System* system)
+{
+	if (!system || std::find(s_systems.begin(), s_systems.end(), system) != s_systems.end())
+		return;
+
+	// systems with the same order run in the order of registration
+	std::vector<System*>::iterator it = std::upper_bound(s_systems.begin(), s_systems.end(), system,
+		[](System* a, System* b)->bool { return a->getOrder() < b->getOrder(); });
+	s_systems.insert(it, system);
+}
+
+void Scene::unregisterSystem(System* system)
+{
+	std::vector<System*>::iterator it = std::find(s_systems.begin(), s_systems.end(), system);
+	if (it == s_systems.end())
+		return;
+
+	s_systems.erase(it);
+	DELETE_OBJECT(system);
+}
+
+void Scene::unregisterAllSystems()
+{
+	System* system;
+	for (std::vector<System*>::iterator it = s_systems.begin(); it != s_systems.end(); ++it)
+	{
+		system = *it;
+		DELETE_OBJECT(system);
+	}
+
+	s_systems.clear();
+}
+
+bool Scene::isComponentTypeHandled(std::type_index type)
+{
+	for (std::vector<System*>::iterator it = s_systems.begin(); it != s_systems.end(); ++it)
+		if ((*it)->handlesType(type))
+			return true;
+
+	return false;
+}
+
 bool Scene::init()
 {
 	registerComponentFactory("Transform", typeid(Transform), Transform::onBuildComponent);
@@ -153,6 +215,12 @@ bool Scene::init()
 	registerComponentFactory("DistanceJoint", typeid(DistanceJoint), DistanceJoint::onBuildComponent);
 	registerComponentFactory("Tilemap", typeid(Tilemap), Tilemap::onBuildComponent);
 */
+	registerSystem(new PhysicsSyncSystem());
+	registerSystem(new ComponentUpdateSystem());
+	registerSystem(new TransformSystem());
+	registerSystem(new CameraSystem());
+	registerSystem(new RenderCollectSystem());
+
 	return true;
 }
 
@@ -162,14 +230,19 @@ void Scene::shutdown()
 	processRemoving();
 
 	GameObject* obj;
-	for (GameObject::List::iterator it = s_gameObjectsToCreate.begin(); it != s_gameObjectsToCreate.end(); ++it)
+	for (std::vector<GameObject*>::iterator it = s_gameObjectsToCreate.begin(); it != s_gameObjectsToCreate.end(); ++it)
 	{
 		obj = *it;
 		DELETE_OBJECT(obj);
 	}
 
 	s_gameObjectsToCreate.clear();
-	
+	s_idsToCreate.clear();
+	s_changedGameObjects.clear();
+	s_visibleSprites.clear();
+	SpriteGrid::clear();
+
+	unregisterAllSystems();
 	unregisterAllComponentFactories();
 }
 
@@ -205,7 +278,7 @@ bool Scene::saveScene(const std::string& path)
 		ar << prefabsCount;
 
 		GameObject* go;
-		for (GameObject::List::iterator it = s_prefabs.begin(); it != s_prefabs.end(); it++)
+		for (GameObjectSlots::iterator it = s_prefabs.begin(); it != s_prefabs.end(); it++)
 		{
 			go = (*it);
 			ar << go;
@@ -214,12 +287,12 @@ bool Scene::saveScene(const std::string& path)
 		// save gameobjects to the archive
 		uint32 goCount = s_gameObjects.size() + s_gameObjectsToCreate.size();
 		ar << goCount;
-		for (GameObject::List::iterator it = s_gameObjects.begin(); it != s_gameObjects.end(); it++)
+		for (GameObjectSlots::iterator it = s_gameObjects.begin(); it != s_gameObjects.end(); it++)
 		{
 			go = (*it);
 			ar << go;
 		}
-		for (GameObject::List::iterator it = s_gameObjectsToCreate.begin(); it != s_gameObjectsToCreate.end(); it++)
+		for (std::vector<GameObject*>::iterator it = s_gameObjectsToCreate.begin(); it != s_gameObjectsToCreate.end(); it++)
 		{
 			go = (*it);
 			ar << go;
@@ -312,8 +385,13 @@ bool Scene::addGameObject(GameObject* obj, bool prefab)
 	if (!obj || (typeid(obj) != typeid(GameObject*)) || hasGameObject(obj, prefab) || isWaitingToAdd(obj))
 		return false;
 
-	GameObject::List& cgo = prefab ? s_prefabs : s_gameObjectsToCreate;
-	cgo.push_back(obj);
+	if (prefab)
+		storeGameObject(obj, true);
+	else
+	{
+		s_gameObjectsToCreate.push_back(obj);
+		s_idsToCreate.insert(obj->getId());
+	}
 
 	obj->setPrefab(prefab);
 	obj->setDestroying(false);
@@ -325,7 +403,7 @@ void Scene::removeGameObject(GameObject* obj, bool prefab)
 {
 	if (!obj)
 	{
-		IF_PRINT_WARNING(SCENE_DEBUG) << "attempt to remove null game object: " << obj->getId() << std::endl;
+		IF_PRINT_WARNING(SCENE_DEBUG) << "attempt to remove null game object" << std::endl;
 		return;
 	}
 
@@ -337,18 +415,15 @@ void Scene::removeGameObject(GameObject* obj, bool prefab)
 
 	if (prefab)
 	{
-		s_prefabs.remove(obj);
+		if (!releaseGameObject(obj, true))
+			return;
+
 		obj->setPrefab(false);
 		DELETE_OBJECT(obj);
 	}
 	else
 	{
-		s_gameObjectsToDestroy.push_back(obj);
-		if (!prefab)
-		{
-			obj->setDestroying(true);
-			obj->onDestroy();
-		}
+		queueDestroy(obj);
 	}
 }
 
@@ -357,24 +432,19 @@ void Scene::removeGameObject(const std::string& id, bool prefab)
 	GameObject* o = getGameObject(id, prefab);
 	if (!o)
 	{
-		IF_PRINT_WARNING(SCENE_DEBUG) << "attempt to remove null game object: " << o->getId() << std::endl;
+		IF_PRINT_WARNING(SCENE_DEBUG) << "attempt to remove null game object: " << id << std::endl;
 		return;
 	}
 
 	if (prefab)
 	{
-		s_prefabs.remove(o);
+		releaseGameObject(o, true);
 		o->setPrefab(false);
 		DELETE_OBJECT(o);
 	}
 	else
 	{
-		s_gameObjectsToDestroy.push_back(o);
-		if (!prefab)
-		{
-			o->setDestroying(true);
-			o->onDestroy();
-		}
+		queueDestroy(o);
 	}
 }
 
@@ -383,24 +453,24 @@ void Scene::removeAllGameObjects(bool prefab)
 	GameObject* obj;
 	if (prefab)
 	{
-		for (GameObject::List::iterator it = s_prefabs.begin(); it != s_prefabs.end(); it++)
+		for (GameObjectSlots::iterator it = s_prefabs.begin(); it != s_prefabs.end(); it++)
 		{
 			obj = *it;
+			IF_PRINT_DEBUG(SCENE_DEBUG) << "Removed game object: " << obj->getId() << std::endl;
+			obj->m_handle = SlotHandle();
 			obj->setPrefab(false);
 			DELETE_OBJECT(obj);
-			IF_PRINT_DEBUG(SCENE_DEBUG) << "Removed game object: " << obj->getId() << std::endl;
 		}
 
 		s_prefabs.clear();
+		s_prefabIds.clear();
 	}
 	else
 	{
-		for (GameObject::List::iterator it = s_gameObjects.begin(); it != s_gameObjects.end(); it++)
+		for (GameObjectSlots::iterator it = s_gameObjects.begin(); it != s_gameObjects.end(); it++)
 		{
 			obj = *it;
-			s_gameObjectsToDestroy.push_back(obj);
-			obj->setDestroying(true);
-			obj->onDestroy();
+			queueDestroy(obj);
 			IF_PRINT_DEBUG(SCENE_DEBUG) << "Removed game object: " << obj->getId() << std::endl;
 		}
 	}
@@ -408,68 +478,27 @@ void Scene::removeAllGameObjects(bool prefab)
 
 bool Scene::hasGameObject(GameObject* obj, bool prefab)
 {
-	if (prefab)
-	{
-		for (GameObject::List::iterator it = s_prefabs.begin(); it != s_prefabs.end(); it++)
-		{
-			if ((*it)->getId() == obj->getId())
-				return true;
-		}
-	}
-	else
-	{
-		for (GameObject::List::iterator it = s_gameObjects.begin(); it != s_gameObjects.end(); it++)
-		{
-			if ((*it)->getId() == obj->getId())
-				return true;
-		}
-	}
+	if (!obj)
+		return false;
 
-	return false;
+	return hasGameObject(obj->getId(), prefab);
 }
 
 bool Scene::hasGameObject(const std::string& id, bool prefab)
 {
-	if (prefab)
-	{
-		for (GameObject::List::iterator it = s_prefabs.begin(); it != s_prefabs.end(); it++)
-		{
-			if ((*it)->getId() == id)
-				return true;
-		}
-	}
-	else
-	{
-		for (GameObject::List::iterator it = s_gameObjects.begin(); it != s_gameObjects.end(); it++)
-		{
-			if ((*it)->getId() == id)
-				return true;
-		}
-	}
-
-	return false;
+	GameObjectIndex& ids = prefab ? s_prefabIds : s_gameObjectIds;
+	return ids.count(id) != 0;
 }
 
 GameObject* Scene::getGameObject(const std::string& id, bool prefab)
 {
-	if (prefab)
-	{
-		for (GameObject::List::iterator it = s_prefabs.begin(); it != s_prefabs.end(); it++)
-		{
-			if ((*it)->getId() == id)
-				return *it;
-		}
-	}
-	else
-	{
-		for (GameObject::List::iterator it = s_gameObjects.begin(); it != s_gameObjects.end(); it++)
-		{
-			if ((*it)->getId() == id)
-				return *it;
-		}
-	}
+	GameObjectIndex& ids = prefab ? s_prefabIds : s_gameObjectIds;
+	GameObjectIndex::iterator it = ids.find(id);
+	if (it == ids.end())
+		return 0;
 
-	return 0;
+	GameObject** o = (prefab ? s_prefabs : s_gameObjects).get(it->second);
+	return o ? *o : 0;
 }
 
 GameObject* Scene::findGameObject(const std::string& path)
@@ -504,6 +533,12 @@ uint32 Scene::getGameObjectCount(bool prefab)
 	return prefab ? s_prefabs.size() : s_gameObjects.size();
 }
 
+GameObject* Scene::getGameObjectAt(uint32 index, bool prefab)
+{
+	GameObjectSlots& slots = prefab ? s_prefabs : s_gameObjects;
+	return index < slots.size() ? slots[index] : 0;
+}
+
 GameObject* Scene::instantiatePrefab(const std::string& id)
 {
 	GameObject* obj = getGameObject(id, true);
@@ -523,8 +558,10 @@ void Scene::processUpdate(const sf::Time& dt, bool sort)
 	if (sort)
 		s_gameObjects.sort([](GameObject* a, GameObject* b)->bool { return a->getOrder() < b->getOrder(); });
 
-	for (GameObject::List::iterator it = s_gameObjects.begin(); it != s_gameObjects.end(); it++)
-		(*it)->onUpdate(dt, sf::Transform::Identity, sort);
+	processPendingChanges(sort);
+
+	for (std::vector<System*>::iterator it = s_systems.begin(); it != s_systems.end(); ++it)
+		(*it)->onUpdate(dt);
 }
 
 void Scene::processRender(sf::RenderTarget* target)
@@ -538,22 +575,118 @@ void Scene::processRender(sf::RenderTarget* target)
 		return;
 	}
 
-	target->setView(target->getDefaultView());
-	sf::RenderTarget*& currentTarget = target;
+	// every active camera is a pass, drawn by the order of their game objects
+	std::vector<Camera*> cameras;
+	const ComponentRegistry::ComponentArray& cameraComponents = ComponentRegistry::getComponents<Camera>();
+	for (uint32 i = 0; i < cameraComponents.size(); i++)
+	{
+		Camera* c = (Camera*)(cameraComponents[i]);
+		if (c->isActive() && c->getOwner()->isUpdating())
+			cameras.push_back(c);
+	}
+
+	std::stable_sort(cameras.begin(), cameras.end(),
+		[](Camera* a, Camera* b)->bool { return a->getOwner()->getOrder() < b->getOwner()->getOrder(); });
+
+	// a camera draws the objects from its own order up to the order of the next camera,
+	// objects ordered before the first camera are drawn with the default view
+	std::vector<RenderQueue::Pass> passes;
+	std::vector<uint32> passOrders;
+	RenderQueue::Pass pass;
+	if (cameras.empty() || cameras.front()->getOwner()->getOrder() > 0)
+	{
+		pass.target = target;
+		pass.texture = 0;
+		pass.view = target->getDefaultView();
+		passes.push_back(pass);
+		passOrders.push_back(0);
+	}
+
+	for (std::vector<Camera*>::iterator it = cameras.begin(); it != cameras.end(); ++it)
+	{
+		if (passes.size() == RenderQueue::MAX_PASSES)
+		{
+			IF_PRINT_WARNING(SCENE_DEBUG) << "too many cameras, skipping camera of: " << (*it)->getOwner()->getId() << std::endl;
+			continue;
+		}
+
+		(*it)->setupPass(target, pass);
+		passes.push_back(pass);
+		passOrders.push_back((*it)->getOwner()->getOrder());
+	}
+
+	// only sprites inside the view of their pass are submitted, each with the mask of its passes
+	s_visibleSprites.clear();
+	SpriteGrid::beginQueries();
+	for (uint32 p = 0; p < passes.size(); p++)
+	{
+		uint32 lastOrder = std::numeric_limits<uint32>::max();
+		if (p + 1 < passes.size())
+		{
+			// cameras of the same order leave the objects to the last one
+			if (passOrders[p + 1] == passOrders[p])
+				continue;
+			lastOrder = passOrders[p + 1] - 1;
+		}
+
+		SpriteGrid::query(getViewBounds(passes[p].view), passOrders[p], lastOrder, 1 << p, s_visibleSprites);
+	}
+
+	RenderQueue::begin(s_visibleSprites.size());
+	for (uint32 p = 0; p < passes.size(); p++)
+		RenderQueue::addPass(passes[p]);
+
+	// inactive sprites stay in the grid, only active ones outside every view are culled
+	uint32 activeSprites = RenderCollectSystem::getActiveCount();
+	RenderQueue::setCulledCount(activeSprites > s_visibleSprites.size() ? activeSprites - s_visibleSprites.size() : 0);
+
+	// sprites write only their own slot, so submission does not depend on the hierarchy walk
+	std::vector<SpriteRenderer*>& visible = s_visibleSprites;
+	JobSystem::parallelFor(visible.size(), SPRITES_PER_JOB, [&visible](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; i++)
+			visible[i]->submit(i);
+	});
 
-	for (GameObject::List::iterator it = s_gameObjects.begin(); it != s_gameObjects.end(); it++)
-		(*it)->onRender(currentTarget);
+	RenderQueue::render(renderComponents);
 
 	target->setView(target->getDefaultView());
+}
+
+sf::FloatRect Scene::getViewBounds(const sf::View& view)
+{
+	// bounds of the rotated view rectangle
+	float angle = view.getRotation() * PI / 180.f;
+	float c = std::abs(std::cos(angle));
+	float s = std::abs(std::sin(angle));
+	sf::Vector2f size = view.getSize();
+	sf::Vector2f bounds(size.x * c + size.y * s, size.x * s + size.y * c);
+
+	return sf::FloatRect(view.getCenter() - bounds / 2.f, bounds);
+}
+
+void Scene::renderComponents(sf::RenderTarget* target)
+{
+	// components drawing by themselves are called after the queued sprites of each pass
+	for (uint32 id = 0; id < ComponentRegistry::getTypeCount(); id++)
+	{
+		std::type_index type = ComponentRegistry::getType(id);
+		if (type == typeid(SpriteRenderer) || type == typeid(Camera))
+			continue;
 
-	// here we need Camera component which is also missing ;)
-	//if (Camera::s_currentRT)
-	//	Camera::s_currentRT->display();
+		const ComponentRegistry::ComponentArray& components = ComponentRegistry::getComponents(id);
+		for (uint32 i = 0; i < components.size(); i++)
+		{
+			Component* c = components[i];
+			if (c->isActive() && c->getOwner()->isUpdating())
+				c->onRender(target);
+		}
+	}
 }
 
 void Scene::processEvents(const sf::Event& event)
 {
-	for (GameObject::List::iterator it = s_gameObjects.begin(); it != s_gameObjects.end(); it++)
+	for (GameObjectSlots::iterator it = s_gameObjects.begin(); it != s_gameObjects.end(); it++)
 		(*it)->onEvent(event);
 }
 
@@ -561,20 +694,28 @@ void Scene::processAdding()
 {
 	GameObject* o;
 
-	for (GameObject::List::iterator it = s_gameObjectsToCreate.begin(); it != s_gameObjectsToCreate.end(); it++)
+	// objects added from onCreate callbacks are appended and handled in the same pass
+	for (uint32 i = 0; i < s_gameObjectsToCreate.size(); i++)
 	{
-		if ((*it))
+		o = s_gameObjectsToCreate[i];
+		if (!o)
+			continue;
+
+		if (!storeGameObject(o, false))
 		{
-			o = *it;
-			s_gameObjects.push_back(o);
-			o->onCreate();
+			IF_PRINT_WARNING(SCENE_DEBUG) << "game object with id " << o->getId() << " already exists" << std::endl;
+			DELETE_OBJECT(o);
+			continue;
 		}
+
+		o->onCreate();
 	}
 
 	if (s_gameObjectsToCreate.size() != 0)
 	{
 		IF_PRINT_DEBUG(SCENE_DEBUG) << "added " << s_gameObjectsToCreate.size() << " objects to scene" << std::endl;
 		s_gameObjectsToCreate.clear();
+		s_idsToCreate.clear();
 	}
 }
 
@@ -582,44 +723,152 @@ void Scene::processRemoving()
 {
 	GameObject* o;
 
-	for (GameObject::List::iterator it = s_gameObjectsToDestroy.begin(); it != s_gameObjectsToDestroy.end(); it++)
+	for (std::vector<GameObject*>::iterator it = s_gameObjectsToDestroy.begin(); it != s_gameObjectsToDestroy.end(); it++)
 	{
-		if ((*it))
-		{
-			o = *it;
-			if (std::find(s_gameObjects.begin(), s_gameObjects.end(), o) == s_gameObjects.end())
-				continue;
-			s_gameObjects.remove(o);
-			o->setPrefab(false);
-			DELETE_OBJECT(o);
-		}
+		o = *it;
+		if (!o || !releaseGameObject(o, false))
+			continue;
+
+		o->setPrefab(false);
+		DELETE_OBJECT(o);
 	}
 
 	if (s_gameObjectsToDestroy.size() != 0)
 	{
 		IF_PRINT_DEBUG(SCENE_DEBUG) << "removed " << s_gameObjectsToDestroy.size() << " objects from scene" << std::endl;
 		s_gameObjectsToDestroy.clear();
+		s_pendingDestroy.clear();
 	}
 }
 
 bool Scene::isWaitingToAdd(GameObject* obj)
 {
-	for (GameObject::List::iterator it = s_gameObjectsToCreate.begin(); it != s_gameObjectsToCreate.end(); it++)
+	return obj && s_idsToCreate.count(obj->getId()) != 0;
+}
+
+bool Scene::isWaitingToRemove(GameObject* obj)
+{
+	return s_pendingDestroy.count(obj) != 0;
+}
+
+bool Scene::storeGameObject(GameObject* obj, bool prefab)
+{
+	GameObjectIndex& ids = prefab ? s_prefabIds : s_gameObjectIds;
+	if (ids.count(obj->getId()))
+		return false;
+
+	obj->m_handle = (prefab ? s_prefabs : s_gameObjects).insert(obj);
+	ids[obj->getId()] = obj->m_handle;
+
+	return true;
+}
+
+bool Scene::releaseGameObject(GameObject* obj, bool prefab)
+{
+	GameObjectSlots& slots = prefab ? s_prefabs : s_gameObjects;
+
+	// handle could come from the other storage, so make sure it points at this object
+	GameObject** stored = slots.get(obj->m_handle);
+	if (!stored || *stored != obj)
+		return false;
+
+	GameObjectIndex& ids = prefab ? s_prefabIds : s_gameObjectIds;
+	GameObjectIndex::iterator it = ids.find(obj->getId());
+	if (it != ids.end() && it->second == obj->m_handle)
+		ids.erase(it);
+
+	slots.remove(obj->m_handle);
+	obj->m_handle = SlotHandle();
+
+	return true;
+}
+
+bool Scene::reindexGameObject(GameObject* obj, const std::string& newId)
+{
+	if (obj->m_handle.isValid())
 	{
-		if ((*it)->getId() == obj->getId())
+		GameObjectIndex& ids = obj->isPrefab() ? s_prefabIds : s_gameObjectIds;
+		GameObjectIndex::iterator it = ids.find(obj->getId());
+		if (it == ids.end() || it->second != obj->m_handle)
 			return true;
+
+		if (ids.count(newId))
+		{
+			IF_PRINT_WARNING(SCENE_DEBUG) << "cannot rename game object " << obj->getId() << " to existing id: " << newId << std::endl;
+			return false;
+		}
+
+		ids.erase(it);
+		ids[newId] = obj->m_handle;
+		return true;
 	}
 
-	return false;
+	// objects waiting for processAdding are created under the id they have then
+	if (s_idsToCreate.count(obj->getId()) &&
+		std::find(s_gameObjectsToCreate.begin(), s_gameObjectsToCreate.end(), obj) != s_gameObjectsToCreate.end())
+	{
+		if (s_idsToCreate.count(newId) || s_gameObjectIds.count(newId))
+		{
+			IF_PRINT_WARNING(SCENE_DEBUG) << "cannot rename game object " << obj->getId() << " to existing id: " << newId << std::endl;
+			return false;
+		}
+
+		s_idsToCreate.erase(obj->getId());
+		s_idsToCreate.insert(newId);
+	}
+
+	return true;
 }
 
-bool Scene::isWaitingToRemove(GameObject* obj)
+void Scene::queueDestroy(GameObject* obj)
+{
+	// skip objects that are already waiting so onDestroy is called only once
+	if (!s_pendingDestroy.insert(obj).second)
+		return;
+
+	s_gameObjectsToDestroy.push_back(obj);
+	obj->setDestroying(true);
+	obj->onDestroy();
+}
+
+void Scene::queueChanges(GameObject* obj)
 {
-	for (GameObject::List::iterator it = s_gameObjectsToDestroy.begin(); it != s_gameObjectsToDestroy.end(); it++)
+	// objects outside of the scene or inactive ones are queued when they start updating
+	if (!obj || obj->m_pendingIndex != INVALID_PENDING_INDEX || !obj->isUpdating())
+		return;
+
+	obj->m_pendingIndex = s_changedGameObjects.size();
+	s_changedGameObjects.push_back(obj);
+}
+
+void Scene::dequeueChanges(GameObject* obj)
+{
+	if (!obj || obj->m_pendingIndex == INVALID_PENDING_INDEX)
+		return;
+
+	if (obj->m_pendingIndex < s_changedGameObjects.size() && s_changedGameObjects[obj->m_pendingIndex] == obj)
+		s_changedGameObjects[obj->m_pendingIndex] = 0;
+
+	obj->m_pendingIndex = INVALID_PENDING_INDEX;
+}
+
+void Scene::processPendingChanges(bool sort)
+{
+	GameObject* o;
+
+	// objects queued by the processed ones are appended and handled in the same pass
+	for (uint32 i = 0; i < s_changedGameObjects.size(); i++)
 	{
-		if ((*it)->getId() == obj->getId())
-			return true;
+		o = s_changedGameObjects[i];
+		if (!o)
+			continue;
+
+		s_changedGameObjects[i] = 0;
+		o->m_pendingIndex = INVALID_PENDING_INDEX;
+
+		if (o->isUpdating())
+			o->processPendingChanges(sort);
 	}
 
-	return false;
+	s_changedGameObjects.clear();
 }
@@ -0,0 +1,151 @@
+#include "Scene/SpriteGrid.h"
+#include "Scene/Components/Rendering/SpriteRenderer.h"
+#include "Scene/GameObject.h"
+
+const float SpriteGrid::CELL_SIZE = 256.f;
+
+std::unordered_map<uint64_t, SpriteGrid::Cell> SpriteGrid::s_cells;
+
+uint32 SpriteGrid::s_count = 0;
+uint32 SpriteGrid::s_queryStamp = 0;
+
+void SpriteGrid::update(SpriteRenderer* sprite)
+{
+	if (!sprite)
+		return;
+
+	sf::IntRect range;
+	getCellRange(sprite->m_bounds, range);
+
+	if (sprite->m_inGrid)
+	{
+		if (range == sprite->m_cells)
+			return;
+
+		removeFromCells(sprite, sprite->m_cells);
+	}
+	else
+	{
+		sprite->m_inGrid = true;
+		s_count++;
+	}
+
+	sprite->m_cells = range;
+	insertToCells(sprite, range);
+}
+
+void SpriteGrid::remove(SpriteRenderer* sprite)
+{
+	if (!sprite || !sprite->m_inGrid)
+		return;
+
+	removeFromCells(sprite, sprite->m_cells);
+	sprite->m_inGrid = false;
+	s_count--;
+}
+
+void SpriteGrid::clear()
+{
+	for (std::unordered_map<uint64_t, Cell>::iterator it = s_cells.begin(); it != s_cells.end(); ++it)
+	{
+		for (Cell::iterator s = it->second.begin(); s != it->second.end(); ++s)
+			(*s)->m_inGrid = false;
+	}
+
+	s_cells.clear();
+	s_count = 0;
+}
+
+uint32 SpriteGrid::getCount()
+{
+	return s_count;
+}
+
+void SpriteGrid::beginQueries()
+{
+	s_queryStamp++;
+}
+
+void SpriteGrid::query(const sf::FloatRect& rect, uint32 firstOrder, uint32 lastOrder, uint32 passBit,
+	std::vector<SpriteRenderer*>& out)
+{
+	sf::IntRect range;
+	getCellRange(rect, range);
+
+	for (int32 y = range.top; y < range.top + range.height; y++)
+	{
+		for (int32 x = range.left; x < range.left + range.width; x++)
+		{
+			std::unordered_map<uint64_t, Cell>::iterator it = s_cells.find(getCellKey(x, y));
+			if (it == s_cells.end())
+				continue;
+
+			for (Cell::iterator s = it->second.begin(); s != it->second.end(); ++s)
+			{
+				SpriteRenderer* sprite = *s;
+				if (sprite->m_queryStamp != s_queryStamp)
+				{
+					sprite->m_queryStamp = s_queryStamp;
+					sprite->m_passMask = 0;
+				}
+
+				if ((sprite->m_passMask & passBit) || !sprite->m_bounds.intersects(rect))
+					continue;
+				if (!sprite->isActive() || !sprite->getOwner() || !sprite->getOwner()->isUpdating())
+					continue;
+
+				uint32 order = sprite->getOwner()->getOrder();
+				if (order < firstOrder || order > lastOrder)
+					continue;
+
+				if (!sprite->m_passMask)
+					out.push_back(sprite);
+				sprite->m_passMask |= passBit;
+			}
+		}
+	}
+}
+
+uint64_t SpriteGrid::getCellKey(int32 x, int32 y)
+{
+	return ((uint64_t)((uint32)(x)) << 32) | (uint32)(y);
+}
+
+void SpriteGrid::getCellRange(const sf::FloatRect& rect, sf::IntRect& range)
+{
+	range.left = (int32)(std::floor(rect.left / CELL_SIZE));
+	range.top = (int32)(std::floor(rect.top / CELL_SIZE));
+	range.width = (int32)(std::floor((rect.left + rect.width) / CELL_SIZE)) - range.left + 1;
+	range.height = (int32)(std::floor((rect.top + rect.height) / CELL_SIZE)) - range.top + 1;
+}
+
+void SpriteGrid::insertToCells(SpriteRenderer* sprite, const sf::IntRect& range)
+{
+	for (int32 y = range.top; y < range.top + range.height; y++)
+		for (int32 x = range.left; x < range.left + range.width; x++)
+			s_cells[getCellKey(x, y)].push_back(sprite);
+}
+
+void SpriteGrid::removeFromCells(SpriteRenderer* sprite, const sf::IntRect& range)
+{
+	for (int32 y = range.top; y < range.top + range.height; y++)
+	{
+		for (int32 x = range.left; x < range.left + range.width; x++)
+		{
+			std::unordered_map<uint64_t, Cell>::iterator it = s_cells.find(getCellKey(x, y));
+			if (it == s_cells.end())
+				continue;
+
+			Cell& cell = it->second;
+			Cell::iterator s = std::find(cell.begin(), cell.end(), sprite);
+			if (s != cell.end())
+			{
+				*s = cell.back();
+				cell.pop_back();
+			}
+
+			if (cell.empty())
+				s_cells.erase(it);
+		}
+	}
+}
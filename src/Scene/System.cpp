@@ -0,0 +1,20 @@
+#include "Scene/System.h"
+#include "Scene/GameObject.h"
+
+System::System(int32 order) :
+	m_order(order)
+{
+}
+
+System::~System()
+{
+}
+
+bool System::isUpdated(Component* c)
+{
+	if (!c || !c->isActive())
+		return false;
+
+	GameObject* owner = c->getOwner();
+	return owner && owner->isUpdating();
+}
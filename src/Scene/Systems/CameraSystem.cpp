@@ -0,0 +1,26 @@
+#include "Scene/Systems/CameraSystem.h"
+#include "Scene/Components/Rendering/Camera.h"
+
+CameraSystem::CameraSystem() :
+	System(ORDER)
+{
+}
+
+CameraSystem::~CameraSystem()
+{
+}
+
+bool CameraSystem::handlesType(std::type_index type) const
+{
+	return type == typeid(Camera);
+}
+
+void CameraSystem::onUpdate(const sf::Time& dt)
+{
+	const ComponentRegistry::ComponentArray& cameras = ComponentRegistry::getComponents<Camera>();
+	for (uint32 i = 0; i < cameras.size(); i++)
+	{
+		if (isUpdated(cameras[i]))
+			((Camera*)(cameras[i]))->updateView();
+	}
+}
@@ -0,0 +1,35 @@
+#include "Scene/Systems/ComponentUpdateSystem.h"
+#include "Scene/Systems/TransformSystem.h"
+#include "Scene/Scene.h"
+
+ComponentUpdateSystem::ComponentUpdateSystem() :
+	System(ORDER)
+{
+}
+
+ComponentUpdateSystem::~ComponentUpdateSystem()
+{
+}
+
+void ComponentUpdateSystem::onUpdate(const sf::Time& dt)
+{
+	for (uint32 id = 0; id < ComponentRegistry::getTypeCount(); id++)
+	{
+		if (Scene::isComponentTypeHandled(ComponentRegistry::getType(id)))
+			continue;
+
+		// the array may change while callbacks run, so it is indexed on every step
+		const ComponentRegistry::ComponentArray& components = ComponentRegistry::getComponents(id);
+		for (uint32 i = 0; i < components.size(); i++)
+		{
+			Component* c = components[i];
+			if (!isUpdated(c))
+				continue;
+
+			c->onUpdate(dt);
+
+			sf::Transform t = TransformSystem::getGlobalTransform(c->getOwner());
+			c->onTransform(t, t);
+		}
+	}
+}
@@ -0,0 +1,31 @@
+#include "Scene/Systems/PhysicsSyncSystem.h"
+#include "Scene/Components/Physics/Body.h"
+#include "Jobs/JobSystem.h"
+
+PhysicsSyncSystem::PhysicsSyncSystem() :
+	System(ORDER)
+{
+}
+
+PhysicsSyncSystem::~PhysicsSyncSystem()
+{
+}
+
+bool PhysicsSyncSystem::handlesType(std::type_index type) const
+{
+	return type == typeid(Body);
+}
+
+void PhysicsSyncSystem::onUpdate(const sf::Time& dt)
+{
+	// every body writes only the Transform of its own game object
+	const ComponentRegistry::ComponentArray& bodies = ComponentRegistry::getComponents<Body>();
+	JobSystem::parallelFor(bodies.size(), JOB_BATCH_SIZE, [&bodies](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; i++)
+		{
+			if (isUpdated(bodies[i]))
+				((Body*)(bodies[i]))->syncTransform();
+		}
+	});
+}
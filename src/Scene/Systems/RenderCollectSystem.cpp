@@ -0,0 +1,49 @@
+#include "Scene/Systems/RenderCollectSystem.h"
+#include "Scene/Systems/TransformSystem.h"
+#include "Scene/Components/Rendering/SpriteRenderer.h"
+#include "Scene/GameObject.h"
+#include "Scene/SpriteGrid.h"
+#include "Jobs/JobSystem.h"
+
+uint32 RenderCollectSystem::s_activeCount = 0;
+
+RenderCollectSystem::RenderCollectSystem() :
+	System(ORDER)
+{
+}
+
+RenderCollectSystem::~RenderCollectSystem()
+{
+}
+
+bool RenderCollectSystem::handlesType(std::type_index type) const
+{
+	return type == typeid(SpriteRenderer);
+}
+
+void RenderCollectSystem::onUpdate(const sf::Time& dt)
+{
+	const ComponentRegistry::ComponentArray& sprites = ComponentRegistry::getComponents<SpriteRenderer>();
+	m_moved.assign(sprites.size(), 0);
+
+	std::vector<uint8>& moved = m_moved;
+	JobSystem::parallelFor(sprites.size(), JOB_BATCH_SIZE, [&sprites, &moved](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; i++)
+		{
+			SpriteRenderer* sprite = (SpriteRenderer*)(sprites[i]);
+			if (isUpdated(sprite))
+				moved[i] = sprite->updateQuad() ? MOVED : UPDATED;
+		}
+	});
+
+	// the grid is shared, so it is updated after the jobs
+	s_activeCount = 0;
+	for (uint32 i = 0; i < sprites.size(); i++)
+	{
+		if (m_moved[i])
+			s_activeCount++;
+		if (m_moved[i] == MOVED)
+			SpriteGrid::update((SpriteRenderer*)(sprites[i]));
+	}
+}
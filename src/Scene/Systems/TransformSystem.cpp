@@ -0,0 +1,355 @@
+#include "Scene/Systems/TransformSystem.h"
+#include "Scene/Components/Transform.h"
+#include "Scene/Scene.h"
+#include "Jobs/JobSystem.h"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+std::vector<GameObject*> TransformSystem::s_invalidated;
+std::unordered_set<GameObject*> TransformSystem::s_pending;
+std::vector<std::pair<uint32, uint32> > TransformSystem::s_released;
+std::mutex TransformSystem::s_mutex;
+
+TransformSystem::TransformSystem() :
+	System(ORDER)
+{
+}
+
+TransformSystem::~TransformSystem()
+{
+}
+
+bool TransformSystem::handlesType(std::type_index type) const
+{
+	return type == typeid(Transform);
+}
+
+void TransformSystem::onUpdate(const sf::Time& dt)
+{
+	updateHierarchy();
+
+	for (uint32 l = 0; l < m_levels.size(); l++)
+	{
+		Level& level = m_levels[l];
+		const Level* parentLevel = l > 0 ? &m_levels[l - 1] : 0;
+
+		// parents are in earlier levels, so their flags are final here,
+		// spliced in nodes are dirty until their first update
+		m_dirty.clear();
+		for (uint32 i = 0; i < level.nodes.size(); i++)
+		{
+			int32 parent = level.parents[i];
+			bool dirty = level.nodes[i]->isDirty() || (parent >= 0 && parentLevel->changed[parent]);
+
+			level.changed[i] = dirty;
+			if (dirty)
+				m_dirty.push_back(i);
+		}
+
+		JobSystem::parallelFor(m_dirty.size(), NODES_PER_JOB, [this, parentLevel, &level](uint32 begin, uint32 end)
+		{
+			updateNodes(parentLevel, level, begin, end);
+		});
+	}
+}
+
+void TransformSystem::invalidateHierarchy(GameObject* obj)
+{
+	if (!obj)
+		return;
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	if (s_pending.insert(obj).second)
+		s_invalidated.push_back(obj);
+}
+
+void TransformSystem::releaseTransform(Transform* trans)
+{
+	if (!trans || trans->m_nodeLevel < 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_released.push_back(std::make_pair((uint32)(trans->m_nodeLevel), trans->m_nodeIndex));
+	trans->m_nodeLevel = -1;
+}
+
+void TransformSystem::dequeue(GameObject* obj)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_pending.erase(obj);
+}
+
+Transform* TransformSystem::findTransform(GameObject* obj)
+{
+	while (obj)
+	{
+		Transform* trans = obj->getComponent<Transform>();
+		if (trans && trans->isActive())
+			return trans;
+
+		// removed objects point at themselves
+		if (obj->getParent() == obj)
+			break;
+		obj = obj->getParent();
+	}
+
+	return 0;
+}
+
+const sf::Transform& TransformSystem::getGlobalTransform(GameObject* obj)
+{
+	Transform* trans = findTransform(obj);
+	return trans ? trans->getGlobalTransform() : sf::Transform::Identity;
+}
+
+void TransformSystem::updateHierarchy()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	if (s_released.empty() && s_pending.empty())
+		return;
+
+	// released transforms may be deleted already, their slots are cleared first
+	for (uint32 i = 0; i < s_released.size(); i++)
+	{
+		uint32 l = s_released[i].first;
+		uint32 index = s_released[i].second;
+		if (l < m_levels.size() && index < m_levels[l].nodes.size())
+		{
+			m_levels[l].nodes[index] = 0;
+			m_levels[l].holes = true;
+		}
+	}
+
+	s_released.clear();
+
+	for (uint32 i = 0; i < s_invalidated.size(); i++)
+	{
+		GameObject* obj = s_invalidated[i];
+		if (!s_pending.count(obj))
+			continue;
+
+		// objects below another invalidated object are spliced with it
+		bool covered = false;
+		for (GameObject* o = obj; o->getParent() && o->getParent() != o && !covered; o = o->getParent())
+			covered = s_pending.count(o->getParent()) != 0;
+		if (covered)
+			continue;
+
+		removeSubtree(obj);
+		if (!obj->isUpdating())
+			continue;
+
+		GameObject* parentObject = obj->getParent();
+		Transform* parent = parentObject && parentObject != obj ? findTransform(parentObject) : 0;
+		if (!parent)
+			insertSubtree(obj, -1, -1);
+		else if (parent->m_nodeLevel >= 0)
+			insertSubtree(obj, parent->m_nodeLevel, parent->m_nodeIndex);
+	}
+
+	s_invalidated.clear();
+	s_pending.clear();
+
+	for (uint32 l = 0; l < m_levels.size(); l++)
+		if (m_levels[l].holes)
+			compactLevel(l);
+
+	while (!m_levels.empty() && m_levels.back().nodes.empty())
+		m_levels.pop_back();
+}
+
+void TransformSystem::removeSubtree(GameObject* obj)
+{
+	Transform* trans = obj->getComponent<Transform>();
+	if (trans && trans->m_nodeLevel >= 0)
+	{
+		Level& level = m_levels[trans->m_nodeLevel];
+		level.nodes[trans->m_nodeIndex] = 0;
+		level.holes = true;
+		trans->m_nodeLevel = -1;
+	}
+
+	const GameObject::List& childrens = obj->getChildrenList();
+	for (GameObject::List::const_iterator it = childrens.begin(); it != childrens.end(); it++)
+		removeSubtree(*it);
+}
+
+void TransformSystem::insertSubtree(GameObject* obj, int32 parentLevel, int32 parentIndex)
+{
+	if (!obj || !obj->isUpdating())
+		return;
+
+	// objects without a transform pass their parent on to their children
+	Transform* trans = obj->getComponent<Transform>();
+	if (trans && trans->isActive())
+	{
+		uint32 l = parentLevel + 1;
+		if (l == m_levels.size())
+			m_levels.push_back(Level());
+
+		Level& level = m_levels[l];
+		trans->m_nodeLevel = l;
+		trans->m_nodeIndex = level.nodes.size();
+		level.nodes.push_back(trans);
+		level.parents.push_back(parentIndex);
+		level.world.push_back(Affine());
+		level.changed.push_back(0);
+
+		// the parent may differ from the one the global transform was computed with
+		trans->m_globalDirty = true;
+
+		parentLevel = l;
+		parentIndex = trans->m_nodeIndex;
+	}
+
+	const GameObject::List& childrens = obj->getChildrenList();
+	for (GameObject::List::const_iterator it = childrens.begin(); it != childrens.end(); it++)
+		insertSubtree(*it, parentLevel, parentIndex);
+}
+
+void TransformSystem::compactLevel(uint32 l)
+{
+	Level& level = m_levels[l];
+	m_remap.assign(level.nodes.size(), -1);
+
+	uint32 count = 0;
+	for (uint32 i = 0; i < level.nodes.size(); i++)
+	{
+		Transform* trans = level.nodes[i];
+		if (!trans)
+			continue;
+
+		m_remap[i] = count;
+		trans->m_nodeIndex = count;
+		level.nodes[count] = trans;
+		level.parents[count] = level.parents[i];
+		level.world[count] = level.world[i];
+		count++;
+	}
+
+	level.nodes.resize(count);
+	level.parents.resize(count);
+	level.world.resize(count);
+	level.changed.assign(count, 0);
+	level.holes = false;
+
+	if (l + 1 == m_levels.size())
+		return;
+
+	// children of released nodes are spliced in again under their new parent,
+	// any left behind become roots of their level until then
+	Level& next = m_levels[l + 1];
+	for (uint32 i = 0; i < next.parents.size(); i++)
+	{
+		int32& parent = next.parents[i];
+		if (parent < 0)
+			continue;
+
+		parent = m_remap[parent];
+		if (parent < 0 && next.nodes[i])
+			next.nodes[i]->m_globalDirty = true;
+	}
+}
+
+void TransformSystem::updateNodes(const Level* parentLevel, Level& level, uint32 begin, uint32 end)
+{
+	AffineBatch parent;
+	AffineBatch local;
+	AffineBatch world;
+
+	for (uint32 first = begin; first < end; first += BATCH_WIDTH)
+	{
+		uint32 count = std::min(end - first, BATCH_WIDTH);
+
+		// gather, unused lanes stay identity
+		for (uint32 lane = 0; lane < BATCH_WIDTH; lane++)
+		{
+			parent.a[lane] = local.a[lane] = 1.f;
+			parent.b[lane] = local.b[lane] = 0.f;
+			parent.c[lane] = local.c[lane] = 0.f;
+			parent.d[lane] = local.d[lane] = 1.f;
+			parent.tx[lane] = local.tx[lane] = 0.f;
+			parent.ty[lane] = local.ty[lane] = 0.f;
+
+			if (lane >= count)
+				continue;
+
+			uint32 i = m_dirty[first + lane];
+			Transform* trans = level.nodes[i];
+
+			const float* m = trans->getTransform().getMatrix();
+			local.a[lane] = m[0];
+			local.b[lane] = m[1];
+			local.c[lane] = m[4];
+			local.d[lane] = m[5];
+			local.tx[lane] = m[12];
+			local.ty[lane] = m[13];
+
+			int32 p = level.parents[i];
+			if (p >= 0 && trans->getMode() != Transform::Global)
+			{
+				const Affine& pw = parentLevel->world[p];
+				parent.a[lane] = pw.a;
+				parent.b[lane] = pw.b;
+				parent.c[lane] = pw.c;
+				parent.d[lane] = pw.d;
+				parent.tx[lane] = pw.tx;
+				parent.ty[lane] = pw.ty;
+			}
+		}
+
+		multiply(parent, local, world);
+
+		// scatter to the level and back to the components
+		for (uint32 lane = 0; lane < count; lane++)
+		{
+			uint32 i = m_dirty[first + lane];
+			Affine& w = level.world[i];
+			w.a = world.a[lane];
+			w.b = world.b[lane];
+			w.c = world.c[lane];
+			w.d = world.d[lane];
+			w.tx = world.tx[lane];
+			w.ty = world.ty[lane];
+
+			int32 p = level.parents[i];
+			level.nodes[i]->applyGlobalTransform(sf::Transform(w.a, w.c, w.tx, w.b, w.d, w.ty, 0.f, 0.f, 1.f),
+				p >= 0 ? parentLevel->nodes[p] : 0);
+		}
+	}
+}
+
+void TransformSystem::multiply(const AffineBatch& parent, const AffineBatch& local, AffineBatch& out)
+{
+#if defined(__SSE__)
+	__m128 pa = _mm_load_ps(parent.a);
+	__m128 pb = _mm_load_ps(parent.b);
+	__m128 pc = _mm_load_ps(parent.c);
+	__m128 pd = _mm_load_ps(parent.d);
+	__m128 la = _mm_load_ps(local.a);
+	__m128 lb = _mm_load_ps(local.b);
+	__m128 lc = _mm_load_ps(local.c);
+	__m128 ld = _mm_load_ps(local.d);
+	__m128 ltx = _mm_load_ps(local.tx);
+	__m128 lty = _mm_load_ps(local.ty);
+
+	_mm_store_ps(out.a, _mm_add_ps(_mm_mul_ps(pa, la), _mm_mul_ps(pc, lb)));
+	_mm_store_ps(out.b, _mm_add_ps(_mm_mul_ps(pb, la), _mm_mul_ps(pd, lb)));
+	_mm_store_ps(out.c, _mm_add_ps(_mm_mul_ps(pa, lc), _mm_mul_ps(pc, ld)));
+	_mm_store_ps(out.d, _mm_add_ps(_mm_mul_ps(pb, lc), _mm_mul_ps(pd, ld)));
+	_mm_store_ps(out.tx, _mm_add_ps(_mm_add_ps(_mm_mul_ps(pa, ltx), _mm_mul_ps(pc, lty)), _mm_load_ps(parent.tx)));
+	_mm_store_ps(out.ty, _mm_add_ps(_mm_add_ps(_mm_mul_ps(pb, ltx), _mm_mul_ps(pd, lty)), _mm_load_ps(parent.ty)));
+#else
+	for (uint32 i = 0; i < BATCH_WIDTH; i++)
+	{
+		out.a[i] = parent.a[i] * local.a[i] + parent.c[i] * local.b[i];
+		out.b[i] = parent.b[i] * local.a[i] + parent.d[i] * local.b[i];
+		out.c[i] = parent.a[i] * local.c[i] + parent.c[i] * local.d[i];
+		out.d[i] = parent.b[i] * local.c[i] + parent.d[i] * local.d[i];
+		out.tx[i] = parent.a[i] * local.tx[i] + parent.c[i] * local.ty[i] + parent.tx[i];
+		out.ty[i] = parent.b[i] * local.tx[i] + parent.d[i] * local.ty[i] + parent.ty[i];
+	}
+#endif
+}
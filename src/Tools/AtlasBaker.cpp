@@ -0,0 +1,87 @@
+#include "Utils.h"
+
+#include "Filesystem/Assets/AssetManager.h"
+#include "Filesystem/Configuration.h"
+
+// packs the images of a directory into atlas pages read back by AssetManager::loadAtlas,
+// set Atlas.File to the written xml to use them. Entries are named by the image path
+// relative to the directory, the ids sprites pass to loadTextureRegion.
+// usage: AtlasBaker <image directory> <atlas.xml> [<page size> [<max image size>]]
+
+static bool isImage(const boost::filesystem::path& path)
+{
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp" || extension == ".tga";
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "usage: " << argv[0] << " <image directory> <atlas.xml> [<page size> [<max image size>]]" << std::endl;
+		return 1;
+	}
+
+	boost::filesystem::path directory(argv[1]);
+	if (!boost::filesystem::is_directory(directory))
+	{
+		PRINT_ERROR << directory.string() << " is not a directory" << std::endl;
+		return 1;
+	}
+
+	Configuration::Atlas::PageSize = argc > 3 ? std::atoi(argv[3]) : 1024;
+	Configuration::Atlas::MaxImageSize = argc > 4 ? std::atoi(argv[4]) : 256;
+	Configuration::Atlas::Padding = 2;
+	Configuration::Atlas::Bleed = 1;
+	Configuration::Atlas::File = "";
+	AssetManager::init();
+
+	// sorted so the same directory always bakes the same pages
+	std::vector<boost::filesystem::path> images;
+	for (boost::filesystem::recursive_directory_iterator it(directory), end; it != end; ++it)
+		if (boost::filesystem::is_regular_file(it->path()) && isImage(it->path()))
+			images.push_back(it->path());
+
+	std::sort(images.begin(), images.end());
+
+	const std::string prefix = directory.generic_string();
+	uint32 packed = 0;
+	int failed = 0;
+	for (const auto& image : images)
+	{
+		std::string id = image.generic_string().substr(prefix.size());
+		while (!id.empty() && id[0] == '/')
+			id.erase(0, 1);
+
+		TextureRegion region;
+		if (!AssetManager::loadTextureRegion(id, image.string(), region))
+		{
+			PRINT_ERROR << "Failed to load " << image.string() << std::endl;
+			failed++;
+			continue;
+		}
+
+		// big images keep their own texture at runtime too
+		if (AssetManager::getAtlas()->contains(region.texture))
+			packed++;
+		else
+			PRINT_WARNING << id << " is bigger than " << Configuration::Atlas::MaxImageSize << " pixels, not packed" << std::endl;
+	}
+
+	if (!AssetManager::saveAtlas(argv[2]))
+	{
+		PRINT_ERROR << "Failed to save atlas " << argv[2] << std::endl;
+		failed++;
+	}
+	else
+	{
+		std::cout << packed << " of " << images.size() << " images packed into "
+			<< AssetManager::getAtlas()->getPageCount() << " pages of " << argv[2] << std::endl;
+	}
+
+	AssetManager::releaseAll();
+	AssetManager::shutdown();
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+#include "Utils.h"
+
+#include <Scene/Map/TileDecoder.h>
+
+#include <zlib.h>
+
+// compares decoding of base64 zlib layer data through TileDecoder with the
+// previous MapLoader path, usage: MapDecodeBench [<width> <height> <runs>]
+
+static const std::string base64_chars =
+				"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+				"abcdefghijklmnopqrstuvwxyz"
+				"0123456789+/";
+
+// previous decoder, one find per character and appending to a string
+static std::string legacyBase64Decode(const std::string& encoded)
+{
+	std::string data = encoded;
+	std::stringstream ss;
+	ss << data;
+	ss >> data;
+
+	std::string ret;
+	unsigned char quad[4];
+	int i = 0;
+	for (std::size_t in = 0; in < data.size() && data[in] != '='; in++)
+	{
+		quad[i++] = data[in];
+		if (i == 4)
+		{
+			for (i = 0; i < 4; i++)
+				quad[i] = base64_chars.find(quad[i]);
+
+			ret += (quad[0] << 2) + ((quad[1] & 0x30) >> 4);
+			ret += ((quad[1] & 0xf) << 4) + ((quad[2] & 0x3c) >> 2);
+			ret += ((quad[2] & 0x3) << 6) + quad[3];
+			i = 0;
+		}
+	}
+
+	if (i)
+	{
+		for (int j = i; j < 4; j++)
+			quad[j] = 0;
+
+		for (int j = 0; j < 4; j++)
+			quad[j] = base64_chars.find(quad[j]);
+
+		unsigned char bytes[3];
+		bytes[0] = (quad[0] << 2) + ((quad[1] & 0x30) >> 4);
+		bytes[1] = ((quad[1] & 0xf) << 4) + ((quad[2] & 0x3c) >> 2);
+		bytes[2] = ((quad[2] & 0x3) << 6) + quad[3];
+
+		for (int j = 0; j < i - 1; j++)
+			ret += bytes[j];
+	}
+
+	return ret;
+}
+
+// previous inflate, doubling the buffer until the stream ends and copying into a vector
+static bool legacyDecompress(const char* source, std::vector<unsigned char>& dest, int inSize, int expectedSize)
+{
+	int currentSize = expectedSize;
+	std::unique_ptr<unsigned char[]> byteArray(new unsigned char[expectedSize]);
+	z_stream stream;
+	stream.zalloc = Z_NULL;
+	stream.zfree = Z_NULL;
+	stream.opaque = Z_NULL;
+	stream.next_in = (Bytef*)source;
+	stream.avail_in = inSize;
+	stream.next_out = (Bytef*)byteArray.get();
+	stream.avail_out = expectedSize;
+
+	if (inflateInit2(&stream, 15 + 32) != Z_OK)
+		return false;
+
+	int result = 0;
+	do
+	{
+		result = inflate(&stream, Z_SYNC_FLUSH);
+		if (result == Z_NEED_DICT || result == Z_STREAM_ERROR || result == Z_DATA_ERROR || result == Z_MEM_ERROR)
+		{
+			inflateEnd(&stream);
+			return false;
+		}
+
+		if (result != Z_STREAM_END)
+		{
+			int oldSize = currentSize;
+			currentSize *= 2;
+			std::unique_ptr<unsigned char[]> newArray(new unsigned char[currentSize]);
+			std::memcpy(newArray.get(), byteArray.get(), oldSize);
+			byteArray = std::move(newArray);
+
+			stream.next_out = (Bytef*)(byteArray.get() + oldSize);
+			stream.avail_out = oldSize;
+		}
+	} while (result != Z_STREAM_END);
+
+	const int outSize = currentSize - stream.avail_out;
+	inflateEnd(&stream);
+
+	std::unique_ptr<unsigned char[]> newArray(new unsigned char[outSize]);
+	std::memcpy(newArray.get(), byteArray.get(), outSize);
+	dest.insert(dest.begin(), &newArray[0], &newArray[outSize]);
+
+	return true;
+}
+
+static std::string base64Encode(const std::vector<uint8>& data)
+{
+	std::string ret;
+	ret.reserve((data.size() + 2) / 3 * 4);
+
+	std::size_t i = 0;
+	for (; i + 2 < data.size(); i += 3)
+	{
+		uint32 v = data[i] << 16 | data[i + 1] << 8 | data[i + 2];
+		ret += base64_chars[v >> 18];
+		ret += base64_chars[(v >> 12) & 63];
+		ret += base64_chars[(v >> 6) & 63];
+		ret += base64_chars[v & 63];
+	}
+
+	if (i < data.size())
+	{
+		uint32 v = data[i] << 16 | (i + 1 < data.size() ? data[i + 1] << 8 : 0);
+		ret += base64_chars[v >> 18];
+		ret += base64_chars[(v >> 12) & 63];
+		ret += i + 1 < data.size() ? base64_chars[(v >> 6) & 63] : '=';
+		ret += '=';
+	}
+
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	uint32 width = argc > 3 ? std::atoi(argv[1]) : 1000;
+	uint32 height = argc > 3 ? std::atoi(argv[2]) : 1000;
+	uint32 runs = argc > 3 ? std::atoi(argv[3]) : 10;
+	if (width == 0 || height == 0 || runs == 0)
+	{
+		std::cerr << "usage: " << argv[0] << " [<width> <height> <runs>]" << std::endl;
+		return 1;
+	}
+
+	// tile ids in short runs like painted ground, written like Tiled writes layer data
+	std::size_t size = width * height * 4;
+	std::vector<uint8> tiles(size);
+	for (std::size_t i = 0; i < width * height; ++i)
+	{
+		uint32 gid = 1 + (i / 5 + i / width) % 48;
+		std::memcpy(&tiles[i * 4], &gid, 4);
+	}
+
+	uLongf compressedSize = compressBound(size);
+	std::vector<uint8> compressed(compressedSize);
+	compress2(compressed.data(), &compressedSize, tiles.data(), size, Z_DEFAULT_COMPRESSION);
+	compressed.resize(compressedSize);
+
+	std::string text = "\n   " + base64Encode(compressed) + "\n  ";
+
+	sf::Clock clock;
+	std::vector<unsigned char> legacyResult;
+	for (uint32 i = 0; i < runs; ++i)
+	{
+		std::string data = legacyBase64Decode(text);
+		legacyResult.clear();
+		legacyResult.reserve(size);
+		if (!legacyDecompress(data.c_str(), legacyResult, data.length(), size))
+		{
+			PRINT_ERROR << "Previous path failed to decode" << std::endl;
+			return 1;
+		}
+	}
+
+	sf::Time legacyTime = clock.restart();
+
+	std::vector<uint8> result;
+	for (uint32 i = 0; i < runs; ++i)
+	{
+		std::vector<uint8> bytes(TileDecoder::base64Size(text.size()));
+		std::size_t byteCount = 0;
+		result.assign(size, 0);
+		if (!TileDecoder::decodeBase64(text.c_str(), text.size(), bytes.data(), byteCount) ||
+			!TileDecoder::decompress(TileDecoder::Zlib, bytes.data(), byteCount, result.data(), size))
+		{
+			PRINT_ERROR << "TileDecoder failed to decode" << std::endl;
+			return 1;
+		}
+	}
+
+	sf::Time decoderTime = clock.restart();
+
+	// base64 on its own, the part the decoder changes most
+	clock.restart();
+	for (uint32 i = 0; i < runs; ++i)
+		legacyBase64Decode(text);
+	sf::Time legacyBase64Time = clock.restart();
+
+	std::vector<uint8> bytes(TileDecoder::base64Size(text.size()));
+	for (uint32 i = 0; i < runs; ++i)
+	{
+		std::size_t byteCount = 0;
+		TileDecoder::decodeBase64(text.c_str(), text.size(), bytes.data(), byteCount);
+	}
+	sf::Time decoderBase64Time = clock.restart();
+
+	if (legacyResult.size() < size || std::memcmp(legacyResult.data(), result.data(), size) != 0 || result != tiles)
+	{
+		PRINT_ERROR << "Decoded layer data differs" << std::endl;
+		return 1;
+	}
+
+	std::cout << width << "x" << height << " layer, " << text.size() << " base64 characters, " << runs << " runs" << std::endl;
+	std::cout << "previous: " << legacyTime.asMicroseconds() / runs << "us per layer, base64 "
+		<< legacyBase64Time.asMicroseconds() / runs << "us" << std::endl;
+	std::cout << "decoder:  " << decoderTime.asMicroseconds() / runs << "us per layer, base64 "
+		<< decoderBase64Time.asMicroseconds() / runs << "us" << std::endl;
+
+	return 0;
+}
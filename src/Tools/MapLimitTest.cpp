@@ -0,0 +1,244 @@
+#include "Utils.h"
+
+#include <Scene/Map/MapLoader.h>
+
+#include <SFML/Graphics/RenderTexture.hpp>
+
+// checks maps at the size limits of quad indices, collision bitmaps, chunked
+// layers and MapLoader::MAX_TILES, returns the number of failed checks,
+// usage: MapLimitTest
+
+static int s_failed = 0;
+
+static bool check(bool passed, const char* what)
+{
+	if (passed)
+		return true;
+
+	PRINT_ERROR << "Failed: " << what << std::endl;
+	s_failed++;
+	return false;
+}
+
+// more quads than a 16 bit index can address, moving the last one only changes its vertices
+static void checkLayerSet()
+{
+	const uint32 side = 160;
+	const float tileSize = 32.f;
+	sf::Texture texture;
+	LayerSet set(texture);
+	TileQuad last;
+	for (uint32 y = 0; y < side; ++y)
+	{
+		for (uint32 x = 0; x < side; ++x)
+		{
+			sf::Vector2f p(x * tileSize, y * tileSize);
+			last = set.addTile(sf::Vertex(p), sf::Vertex(p + sf::Vector2f(tileSize, 0.f)),
+				sf::Vertex(p + sf::Vector2f(tileSize, tileSize)), sf::Vertex(p + sf::Vector2f(0.f, tileSize)));
+		}
+	}
+
+	check(last.getIndex() == side * side - 1u && last.getIndex() > 16384u, "layer set indexes more than 16384 quads");
+
+	// vertices are in cell order once built, so the copy is taken after the first build
+	std::vector<sf::Vertex> before = set.getVertices();
+	int32 position = set.findQuad(last);
+	check(position >= 0 && set.getQuad(position).getIndex() == last.getIndex(), "last quad is found by its position");
+	if (position < 0)
+		return;
+
+	const sf::Vector2f distance(5.f, -3.f);
+	last.move(distance);
+	const std::vector<sf::Vertex>& after = set.getVertices();
+	check(after.size() == before.size(), "moving a quad keeps the vertex count");
+	if (after.size() != before.size())
+		return;
+
+	uint32 changed = 0;
+	bool moved = true;
+	for (uint32 i = 0; i < after.size(); ++i)
+	{
+		if (after[i].position == before[i].position)
+			continue;
+
+		changed++;
+		moved = moved && i / 4u == (uint32)(position) && after[i].position == before[i].position + distance;
+	}
+
+	check(changed == 4u && moved, "moving the last quad only changes its four vertices");
+}
+
+// the last tile of the largest layers used by the streaming maps
+static void checkLargeLayers()
+{
+	const uint32 size = 4096;
+
+	CollisionMap collision;
+	collision.create(size, size);
+	collision.set(size - 1u, size - 1u);
+	check(collision.isSolid(size - 1u, size - 1u), "collision map sets the last tile");
+	check(!collision.isSolid(size - 2u, size - 1u) && !collision.isSolid(size - 1u, size - 2u), "collision map leaves the neighbours of the last tile");
+	check(!collision.isSolid(size, size - 1u) && !collision.isSolid(size - 1u, size), "collision map rejects tiles outside the layer");
+	check(collision.getWords().size() == size * size / 32u, "collision map uses one bit per tile");
+
+	// a chunk size that does not divide the layer leaves a partial last chunk
+	const uint32 chunkSize = 48;
+	std::vector<sf::Texture> textures;
+	ChunkedLayer chunks(size, size, chunkSize, textures);
+	chunks.setTile(size - 1u, size - 1u, 7u);
+	check(chunks.getTile(size - 1u, size - 1u) == 7u, "chunked layer stores the last tile");
+	check(chunks.getChunksX() * chunkSize >= size && (chunks.getChunksX() - 1u) * chunkSize < size, "chunks cover the layer width");
+	check(chunks.getChunksY() * chunkSize >= size && (chunks.getChunksY() - 1u) * chunkSize < size, "chunks cover the layer height");
+
+	uint32 lastChunk = (size - 1u) / chunkSize * chunks.getChunksX() + (size - 1u) / chunkSize;
+	check(lastChunk == chunks.getChunkCount() - 1u, "last tile is in the last chunk");
+}
+
+// writes a tileset image of two 32x32 tiles next to the maps
+static bool writeTileset(const boost::filesystem::path& directory)
+{
+	sf::Image image;
+	image.create(64u, 32u, sf::Color::White);
+	return image.saveToFile((directory / "limit.png").string());
+}
+
+// writes the map header and the tileset of a width x height map, the caller adds the layers
+static void writeMapStart(std::ofstream& file, uint64_t width, uint64_t height)
+{
+	file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		<< "<map version=\"1.0\" orientation=\"orthogonal\" width=\"" << width << "\" height=\"" << height
+		<< "\" tilewidth=\"32\" tileheight=\"32\">\n"
+		<< " <tileset firstgid=\"1\" name=\"limit\" tilewidth=\"32\" tileheight=\"32\">\n"
+		<< "  <image source=\"limit.png\" width=\"64\" height=\"32\"/>\n"
+		<< " </tileset>\n";
+}
+
+// writes a map of width x height tiles without layers and tries to load it
+static bool loadEmptyMap(const boost::filesystem::path& directory, uint64_t width, uint64_t height)
+{
+	boost::filesystem::path path = directory / "limit.tmx";
+	std::ofstream file(path.string().c_str());
+	writeMapStart(file, width, height);
+	file << "</map>\n";
+	file.close();
+
+	MapLoader ml(directory.string());
+	return ml.load(path.filename().string(), false);
+}
+
+static void checkMaxTiles(const boost::filesystem::path& directory)
+{
+	check(MapLoader::fitsTileLimit(16384u, 16384u) && MapLoader::fitsTileLimit(1u, MapLoader::MAX_TILES), "maps of MAX_TILES tiles fit");
+	check(!MapLoader::fitsTileLimit(16385u, 16384u) && !MapLoader::fitsTileLimit(65536u, 65536u), "maps above MAX_TILES do not fit");
+
+	// the same map loads at the limit, so failing one row above it comes from the limit
+	uint64_t side = (uint64_t)(std::sqrt((double)(MapLoader::MAX_TILES)));
+	check(side * side == MapLoader::MAX_TILES, "MAX_TILES is a square");
+	check(loadEmptyMap(directory, side, side), "maps of MAX_TILES tiles are loaded");
+	check(!loadEmptyMap(directory, side, side + 1u), "maps above MAX_TILES are rejected");
+	check(!loadEmptyMap(directory, 65536u, 65536u), "maps of 2^32 tiles are rejected");
+}
+
+// loads a 4096x4096 layer with every fourth tile in both directions set and
+// draws it, which builds the cells and uploads the vertex buffer
+static void checkLargeMap(const boost::filesystem::path& directory)
+{
+	const uint32 size = 4096;
+	const uint32 step = 4;
+	const uint32 tileSize = 32;
+	const uint32 quadCount = (size / step) * (size / step);
+
+	// rows are either empty or have a tile in every step-th column, the last tile is set
+	std::string emptyRow, tileRow;
+	for (uint32 x = 0; x < size; ++x)
+	{
+		emptyRow += "0,";
+		tileRow += x % step == step - 1u ? "1," : "0,";
+	}
+
+	boost::filesystem::path path = directory / "large.tmx";
+	std::ofstream file(path.string().c_str());
+	writeMapStart(file, size, size);
+	file << " <layer name=\"large\" width=\"" << size << "\" height=\"" << size << "\">\n"
+		<< "  <data encoding=\"csv\">\n";
+	for (uint32 y = 0; y < size; ++y)
+	{
+		const std::string& row = y % step == step - 1u ? tileRow : emptyRow;
+		// no separator after the last tile
+		file << (y + 1u < size ? row : row.substr(0, row.size() - 1u)) << "\n";
+	}
+	file << "  </data>\n </layer>\n</map>\n";
+	file.close();
+
+	MapLoader ml(directory.string());
+	if (!check(ml.load(path.filename().string(), false), "4096x4096 layer is loaded"))
+		return;
+
+	MapLayer* layer = 0;
+	for (auto& l : ml.getLayers())
+		if (l.type == Layer)
+			layer = &l;
+
+	if (!check(layer && layer->layerSets.size() == 1u, "4096x4096 layer has one layer set"))
+		return;
+
+	LayerSet& set = *layer->layerSets.begin()->second;
+	const std::vector<sf::Vertex>& vertices = set.getVertices();
+	check(vertices.size() == quadCount * 4u, "4096x4096 layer has a quad per set tile");
+
+	// every quad index is used once, the highest ones need more than 16 bits
+	std::vector<uint8> used(quadCount, 0u);
+	bool indicesValid = true;
+	bool lastTile = false;
+	const sf::Vector2f lastPosition(static_cast<float>((size - 1u) * tileSize), static_cast<float>((size - 1u) * tileSize));
+	for (uint32 i = 0; i < vertices.size() / 4u; ++i)
+	{
+		uint32 index = set.getQuad(i).getIndex();
+		indicesValid = indicesValid && index < quadCount && !used[index];
+		if (index < quadCount)
+			used[index] = 1u;
+
+		lastTile = lastTile || vertices[i * 4u].position == lastPosition;
+	}
+
+	check(indicesValid, "4096x4096 layer uses each quad index once");
+	check(lastTile, "4096x4096 layer has a quad for the last tile");
+	check(layer->collision.getWords().size() == size * size / 32u, "4096x4096 layer has a collision bit per tile");
+
+	sf::RenderTexture target;
+	if (!check(target.create(64u, 64u), "render texture is created"))
+		return;
+
+	float worldSize = static_cast<float>(size * tileSize);
+	target.setView(sf::View(sf::FloatRect(0.f, 0.f, worldSize, worldSize)));
+	LayerSet::resetDrawnVertexCount();
+	target.draw(*layer);
+	check(LayerSet::getDrawnVertexCount() == quadCount * 4u, "a view of the whole 4096x4096 layer draws every quad");
+}
+
+int main(int argc, char** argv)
+{
+	JobSystem::init();
+
+	checkLayerSet();
+	checkLargeLayers();
+
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+	boost::filesystem::create_directories(directory);
+
+	if (check(writeTileset(directory), "tileset image is written"))
+	{
+		checkMaxTiles(directory);
+		checkLargeMap(directory);
+	}
+
+	boost::system::error_code error;
+	boost::filesystem::remove_all(directory, error);
+
+	JobSystem::shutdown();
+
+	if (s_failed == 0)
+		std::cout << "all map limit checks passed" << std::endl;
+
+	return s_failed;
+}
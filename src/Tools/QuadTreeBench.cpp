@@ -0,0 +1,171 @@
+#include "Utils.h"
+
+#include <Scene/Map/QuadTreeNode.h>
+#include <Scene/Map/SpatialHash.h>
+
+#include <cmath>
+#include <new>
+
+// builds, updates and queries quad trees of 1k to 1M objects with the default
+// settings, deeper nodes and loose nodes, and a spatial hash of the same objects,
+// and counts heap allocations of queries,
+// usage: QuadTreeBench [<objects> [<queries>]]
+
+static std::size_t s_allocations = 0;
+
+void* operator new(std::size_t size)
+{
+	s_allocations++;
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+struct BenchConfig
+{
+	const char* name;
+	QuadTreeSettings settings;
+};
+
+// runs one index, which is empty and set up by the caller, returns false if
+// queries found different objects or allocated
+template <typename Index>
+static bool runBench(Index& index, std::vector<MapObject>& objects, const std::vector<sf::FloatRect>& queries)
+{
+	sf::Clock clock;
+	for (const auto& object : objects)
+		index.insert(object);
+
+	sf::Time buildTime = clock.restart();
+
+	// a tenth of the objects moves a few pixels each frame, like walking characters
+	const uint32 frames = 10;
+	std::size_t moved = 0;
+	clock.restart();
+	for (uint32 frame = 0; frame < frames; ++frame)
+	{
+		for (std::size_t i = frame; i < objects.size(); i += 10)
+		{
+			objects[i].move(static_cast<float>(std::rand() % 17) - 8.f, static_cast<float>(std::rand() % 17) - 8.f);
+			index.update(objects[i]);
+			moved++;
+		}
+	}
+
+	sf::Time updateTime = clock.restart();
+
+	std::vector<MapObject*> results;
+	results.reserve(objects.size());
+	std::size_t found = 0;
+	std::size_t allocations = s_allocations;
+	clock.restart();
+	for (const auto& query : queries)
+	{
+		results.clear();
+		index.retrieve(query, results);
+		found += results.size();
+	}
+
+	sf::Time appendTime = clock.restart();
+	std::size_t appendAllocations = s_allocations - allocations;
+
+	std::size_t visited = 0;
+	allocations = s_allocations;
+	clock.restart();
+	for (const auto& query : queries)
+		index.visit(query, [&visited](MapObject&) { visited++; });
+
+	sf::Time visitTime = clock.restart();
+	std::size_t visitAllocations = s_allocations - allocations;
+
+	std::cout << "    build:   " << buildTime.asMicroseconds() / 1000.f << "ms" << std::endl;
+	std::cout << "    update:  " << updateTime.asMicroseconds() * 1000 / std::max<std::size_t>(moved, 1) << "ns per moved object" << std::endl;
+	std::cout << "    append:  " << appendTime.asMicroseconds() * 1000 / queries.size() << "ns, "
+		<< (float)(appendAllocations) / queries.size() << " allocations per query" << std::endl;
+	std::cout << "    visitor: " << visitTime.asMicroseconds() * 1000 / queries.size() << "ns, "
+		<< (float)(found) / queries.size() << " objects per query" << std::endl;
+
+	if (found != visited)
+	{
+		PRINT_ERROR << "Queries found different objects" << std::endl;
+		return false;
+	}
+
+	return appendAllocations == 0 && visitAllocations == 0;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<uint32> objectCounts;
+	if (argc > 1)
+		objectCounts.push_back(std::atoi(argv[1]));
+	else
+		objectCounts = { 1000, 10000, 100000, 1000000 };
+
+	uint32 queryCount = argc > 2 ? std::atoi(argv[2]) : 100000;
+	if (objectCounts[0] == 0 || queryCount == 0)
+	{
+		std::cerr << "usage: " << argv[0] << " [<objects> [<queries>]]" << std::endl;
+		return 1;
+	}
+
+	bool passed = true;
+	for (uint32 objectCount : objectCounts)
+	{
+		// the area grows with the objects so their density stays the same
+		const float areaSize = std::sqrt(static_cast<float>(objectCount)) * 64.f;
+		const int range = static_cast<int>(areaSize) - 64;
+		std::vector<MapObject> objects(objectCount);
+		std::srand(1);
+		for (auto& object : objects)
+		{
+			sf::Vector2f size(8.f + std::rand() % 56, 8.f + std::rand() % 56);
+			object.addPoint(sf::Vector2f());
+			object.addPoint(sf::Vector2f(size.x, 0.f));
+			object.addPoint(size);
+			object.addPoint(sf::Vector2f(0.f, size.y));
+			object.setPosition(static_cast<float>(std::rand() % range), static_cast<float>(std::rand() % range));
+			object.createDebugShape(sf::Color::White);
+		}
+
+		std::vector<sf::FloatRect> queries(queryCount);
+		for (auto& query : queries)
+			query = sf::FloatRect(static_cast<float>(std::rand() % range), static_cast<float>(std::rand() % range), 64.f, 64.f);
+
+		// deep trees get about capacity objects per leaf
+		BenchConfig configs[3];
+		configs[0].name = "default";
+		configs[1].name = "deep";
+		configs[1].settings.capacity = 8;
+		configs[1].settings.maxDepth = std::max(1, static_cast<int>(std::ceil(std::log(objectCount / 8.f) / std::log(4.f))));
+		configs[2] = configs[1];
+		configs[2].name = "deep loose";
+		configs[2].settings.looseness = 2.f;
+
+		std::cout << objectCount << " objects, " << queryCount << " queries" << std::endl;
+		for (const auto& config : configs)
+		{
+			QuadTreeRoot tree;
+			tree.setSettings(config.settings);
+			tree.clear(sf::FloatRect(0.f, 0.f, areaSize, areaSize));
+			std::cout << "  " << config.name << " (capacity " << config.settings.capacity << ", depth " << config.settings.maxDepth
+				<< ", looseness " << config.settings.looseness << ")" << std::endl;
+			passed = runBench(tree, objects, queries) && passed;
+			std::cout << "    " << tree.getNodeCount() << " nodes" << std::endl;
+		}
+
+		// cells of two 64 pixel tiles, as maps using the hash get by default
+		SpatialHash hash;
+		hash.setCellSize(128.f);
+		std::cout << "  spatial hash (cell size " << hash.getCellSize() << ")" << std::endl;
+		passed = runBench(hash, objects, queries) && passed;
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+#include "Utils.h"
+
+#include <Scene/Map/MapLoader.h>
+
+// converts tmx maps to precompiled .tmxb maps written next to them,
+// usage: TmxConverter <map.tmx> [<map.tmx> ...]
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: " << argv[0] << " <map.tmx> [<map.tmx> ...]" << std::endl;
+		return 1;
+	}
+
+	// tilesets and layers of a map are decoded in parallel
+	JobSystem::init();
+
+	int failed = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		boost::filesystem::path path(argv[i]);
+		boost::filesystem::path output = path;
+		output.replace_extension(MapBinary::EXTENSION);
+
+		// always parse the tmx, an existing .tmxb may be outdated
+		MapLoader ml(path.parent_path().string());
+		if (!ml.load(path.filename().string(), false) || !ml.saveBinary(output.string()))
+		{
+			PRINT_ERROR << "Failed to convert " << path.string() << std::endl;
+			failed++;
+			continue;
+		}
+
+		std::cout << path.string() << " -> " << output.string() << std::endl;
+	}
+
+	JobSystem::shutdown();
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,215 @@
+#include "Video/RenderQueue.h"
+#include "Scene/Material.h"
+
+std::vector<RenderQueue::Pass> RenderQueue::s_passes;
+
+std::vector<RenderQueue::Item> RenderQueue::s_items;
+std::vector<sf::Vertex> RenderQueue::s_quads;
+
+std::vector<RenderQueue::Command> RenderQueue::s_commands;
+std::vector<RenderQueue::Command> RenderQueue::s_sortBuffer;
+
+std::vector<sf::Vertex> RenderQueue::s_vertices;
+
+RenderQueue::Stats RenderQueue::s_stats = { 0, 0, 0, 0 };
+
+void RenderQueue::begin(uint32 slotCount)
+{
+	s_passes.clear();
+
+	s_items.resize(slotCount);
+	s_quads.resize(slotCount * 4);
+	s_commands.clear();
+
+	s_stats.sprites = 0;
+	s_stats.commands = 0;
+	s_stats.culled = 0;
+	s_stats.drawCalls = 0;
+}
+
+bool RenderQueue::addPass(const Pass& pass)
+{
+	if (!pass.target || s_passes.size() >= MAX_PASSES)
+		return false;
+
+	s_passes.push_back(pass);
+
+	Command unused = { INVALID_KEY, 0 };
+	s_commands.assign(s_items.size() * s_passes.size(), unused);
+
+	return true;
+}
+
+uint32 RenderQueue::getPassCount()
+{
+	return s_passes.size();
+}
+
+void RenderQueue::submit(uint32 slot, const sf::Vertex* quad, const sf::RenderStates& states,
+	int32 layer, uint32 order, uint32 depth, uint32 passMask, Material* material, bool materialValidation)
+{
+	if (!quad || slot >= s_items.size())
+		return;
+
+	// nothing is drawn without a pass
+	if (s_passes.empty())
+		return;
+
+	Item& item = s_items[slot];
+	item.shader = states.shader;
+	item.texture = states.texture;
+	item.blendMode = states.blendMode;
+	item.material = states.shader ? material : 0;
+	item.materialValidation = materialValidation;
+
+	std::copy(quad, quad + 4, &s_quads[slot * 4]);
+
+	// batching id, collisions only cost a split batch since merging compares the real states
+	std::size_t hash = std::hash<const void*>()(item.texture) ^ (std::hash<const void*>()(item.shader) * 31);
+	uint32 materialId = (uint32)(hash ^ (hash >> 20) ^ (hash >> 40));
+
+	uint32 passCount = s_passes.size();
+	for (uint32 p = 0; p < passCount; p++)
+	{
+		if (!(passMask & (1 << p)))
+			continue;
+
+		Command& c = s_commands[slot * passCount + p];
+		c.key = makeKey(p, layer, order, depth, materialId);
+		c.slot = slot;
+	}
+}
+
+void RenderQueue::render(const std::function<void(sf::RenderTarget*)>& onPass)
+{
+	// sprites are counted here instead of in submit, which can run from several jobs
+	uint32 passCount = s_passes.size();
+	for (uint32 slot = 0; passCount && slot < s_items.size(); slot++)
+	{
+		for (uint32 p = 0; p < passCount; p++)
+		{
+			if (s_commands[slot * passCount + p].key != INVALID_KEY)
+			{
+				s_stats.sprites++;
+				break;
+			}
+		}
+	}
+
+	sortCommands();
+
+	// skip unused slots, they are sorted to the end
+	uint32 count = 0;
+	while (count < s_commands.size() && s_commands[count].key != INVALID_KEY)
+		count++;
+
+	s_vertices.resize(count * 4);
+	for (uint32 i = 0; i < count; i++)
+		std::copy(&s_quads[s_commands[i].slot * 4], &s_quads[s_commands[i].slot * 4] + 4, &s_vertices[i * 4]);
+
+	uint32 first = 0;
+	for (uint32 p = 0; p < s_passes.size(); p++)
+	{
+		Pass& pass = s_passes[p];
+		pass.target->setView(pass.view);
+
+		uint32 end = first;
+		while (end < count && getPass(s_commands[end].key) == p)
+			end++;
+
+		uint32 batch = first;
+		for (uint32 i = first + 1; i <= end; i++)
+		{
+			if (i < end && canMerge(s_items[s_commands[batch].slot], s_items[s_commands[i].slot]))
+				continue;
+
+			if (i > batch)
+				drawBatch(pass.target, s_items[s_commands[batch].slot], batch, i - batch);
+			batch = i;
+		}
+
+		s_stats.commands += end - first;
+		first = end;
+
+		if (onPass)
+			onPass(pass.target);
+
+		if (pass.texture)
+			pass.texture->display();
+	}
+
+	s_commands.clear();
+}
+
+void RenderQueue::setCulledCount(uint32 count)
+{
+	s_stats.culled = count;
+}
+
+const RenderQueue::Stats& RenderQueue::getStats()
+{
+	return s_stats;
+}
+
+uint64_t RenderQueue::makeKey(uint32 pass, int32 layer, uint32 order, uint32 depth, uint32 material)
+{
+	// layer is biased so negative layers sort first
+	uint64_t l = (uint64_t)(std::min(std::max(layer + 2048, 0), 4095));
+	uint64_t o = std::min(order, (uint32)(0xffff));
+	uint64_t d = std::min(depth, (uint32)(0xfff));
+
+	return ((uint64_t)(pass & 0xf) << 60) | (l << 48) | (o << 32) | (d << 20) | (material & 0xfffff);
+}
+
+uint32 RenderQueue::getPass(uint64_t key)
+{
+	return (uint32)(key >> 60);
+}
+
+void RenderQueue::sortCommands()
+{
+	// least significant digit radix sort with 8 bit digits, stable so equal keys keep slot order
+	s_sortBuffer.resize(s_commands.size());
+
+	uint32 histogram[256];
+	for (uint32 shift = 0; shift < 64; shift += 8)
+	{
+		std::fill(histogram, histogram + 256, 0);
+		for (uint32 i = 0; i < s_commands.size(); i++)
+			histogram[(s_commands[i].key >> shift) & 0xff]++;
+
+		// every key has the same digit, the pass would not move anything
+		if (histogram[(s_commands.empty() ? 0 : s_commands[0].key >> shift) & 0xff] == s_commands.size())
+			continue;
+
+		uint32 offset = 0;
+		for (uint32 i = 0; i < 256; i++)
+		{
+			uint32 n = histogram[i];
+			histogram[i] = offset;
+			offset += n;
+		}
+
+		for (uint32 i = 0; i < s_commands.size(); i++)
+			s_sortBuffer[histogram[(s_commands[i].key >> shift) & 0xff]++] = s_commands[i];
+
+		s_commands.swap(s_sortBuffer);
+	}
+}
+
+bool RenderQueue::canMerge(const Item& a, const Item& b)
+{
+	return a.texture == b.texture && a.shader == b.shader && a.blendMode == b.blendMode && a.material == b.material;
+}
+
+void RenderQueue::drawBatch(sf::RenderTarget* target, const Item& item, uint32 first, uint32 count)
+{
+	if (item.shader && item.material)
+		item.material->apply((sf::Shader*)(item.shader), item.materialValidation);
+
+	// vertices are already in world space
+	sf::RenderStates states(item.blendMode, sf::Transform::Identity, item.texture, item.shader);
+	target->draw(&s_vertices[first * 4], count * 4, sf::Quads, states);
+
+	s_stats.drawCalls++;
+}
@@ -4,6 +4,7 @@
 #include <cstdio>
 
 #include <Scene/Map/MapLoader.h>
+#include <Video/RenderQueue.h>
 
 int main()
 {
@@ -19,19 +20,28 @@ int main()
     MapLoader ml("maps/");
     ml.load("desert.tmx");
 
+    sf::Clock frameClock;
+    std::vector<MapObject*> objects;
     while (!Core::shouldQuit())
     {
         Core::handleEvent();
 
+        ml.updateStreaming(VideoManager::getWindowHandle()->getView());
+        ml.updateAnimations(frameClock.restart());
         ml.updateQuadTree(sf::FloatRect(0.f, 0.f, 800.f, 600.f));
         sf::Vector2f mousePos = VideoManager::getWindowHandle()->mapPixelToCoords(sf::Mouse::getPosition(*VideoManager::getWindowHandle()));
-        std::vector<MapObject*> objects = ml.queryQuadTree(sf::FloatRect(mousePos.x - 10.f, mousePos.y - 10.f, 20.f, 20.f));
+        objects.clear();
+        ml.queryQuadTree(sf::FloatRect(mousePos.x - 10.f, mousePos.y - 10.f, 20.f, 20.f), objects);
 
         std::stringstream stream;
-        stream << "Query object count: " << objects.size();
+        const RenderQueue::Stats& renderStats = RenderQueue::getStats();
+        stream << "Query object count: " << objects.size() << " Map vertices: " << LayerSet::getDrawnVertexCount()
+            << " Sprites: " << renderStats.sprites << " Commands: " << renderStats.commands
+            << " Draw calls: " << renderStats.drawCalls << " Culled: " << renderStats.culled;
         VideoManager::getWindowHandle()->setTitle(stream.str());
 
         VideoManager::clear();
+        LayerSet::resetDrawnVertexCount();
         
         VideoManager::getWindowHandle()->draw(ml);
         ml.draw(*VideoManager::getWindowHandle(), MapLayer::Debug);